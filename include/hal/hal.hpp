@@ -14,11 +14,104 @@
 // If you don't have it, comment it out and change the font in init().
 #include "ESP32_SPI_9341.h" 
 
+#include "os/modules/layout.hpp"
+#include "os/modules/log.hpp"
+#include "os/modules/draw_capture.hpp"
+#include "os/modules/band_watch.hpp"
+
 // --- PIN DEFINITIONS FOR CYD ---
 #define SD_CS_PIN 5
 
+// Directed connect (cached BSSID/channel) gets this long before falling
+// back to a full scan
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000
+
+enum WifiConnectPhase {
+    WIFI_PHASE_IDLE,
+    WIFI_PHASE_FAST,   // Directed connect to the cached BSSID/channel
+    WIFI_PHASE_FULL,   // Scan + associate
+    WIFI_PHASE_UP      // Attempt done, the driver handles reconnects
+};
+
+// ILI9341 that counts the writes reaching it. A touch-latency measurement
+// closes on the first loop whose count moved (see LatencyTracker). While a
+// capture is attached every write is also recorded there (ScreenMirror).
+// A watched band (the toast's saved background) records the pixels other
+// code drew into, so the overlay can read those pixels back.
+class Panel_CYD : public lgfx::Panel_ILI9341 {
+private:
+    uint16_t winX = 0, winY = 0, winW = 0, winH = 0;   // Target of writeBlock/writePixels
+
+    // Raw colors are byte-swapped RGB565 on this panel
+    static uint16_t rgb565(uint32_t rawcolor) { return __builtin_bswap16((uint16_t)rawcolor); }
+
+public:
+    uint32_t writes = 0;
+    DrawCapture* capture = nullptr;
+    bool muted = false;        // Background app running: writes are dropped
+    uint32_t mutedWrites = 0;
+    BandWatch* band = nullptr;
+
+    void setWindow(uint_fast16_t xs, uint_fast16_t ys, uint_fast16_t xe, uint_fast16_t ye) override {
+        winX = xs; winY = ys; winW = xe - xs + 1; winH = ye - ys + 1;
+        lgfx::Panel_ILI9341::setWindow(xs, ys, xe, ye);
+    }
+    void drawPixelPreclipped(uint_fast16_t x, uint_fast16_t y, uint32_t rawcolor) override {
+        if (muted) { mutedWrites++; return; }
+        writes++;
+        if (capture) capture->mark(x, y, 1, 1);
+        if (band) band->mark(x, y, 1, 1);
+        lgfx::Panel_ILI9341::drawPixelPreclipped(x, y, rawcolor);
+    }
+    void writeFillRectPreclipped(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, uint32_t rawcolor) override {
+        if (muted) { mutedWrites++; return; }
+        writes++;
+        if (capture) capture->fill(x, y, w, h, rgb565(rawcolor));
+        if (band) band->mark(x, y, w, h);
+        lgfx::Panel_ILI9341::writeFillRectPreclipped(x, y, w, h, rawcolor);
+    }
+    void writeBlock(uint32_t rawcolor, uint32_t length) override {
+        if (muted) { mutedWrites++; return; }
+        writes++;
+        if (capture) {
+            if (length == (uint32_t)winW * winH) capture->fill(winX, winY, winW, winH, rgb565(rawcolor));
+            else capture->mark(winX, winY, winW, winH);
+        }
+        if (band) band->mark(winX, winY, winW, winH);
+        lgfx::Panel_ILI9341::writeBlock(rawcolor, length);
+    }
+    void writeImage(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, lgfx::pixelcopy_t* param, bool use_dma) override {
+        if (muted) { mutedWrites++; return; }
+        writes++;
+        if (capture) capture->mark(x, y, w, h);
+        if (band) band->mark(x, y, w, h);
+        lgfx::Panel_ILI9341::writeImage(x, y, w, h, param, use_dma);
+    }
+    void writeImageARGB(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, lgfx::pixelcopy_t* param) override {
+        if (muted) { mutedWrites++; return; }
+        writes++;
+        if (capture) capture->mark(x, y, w, h);
+        if (band) band->mark(x, y, w, h);
+        lgfx::Panel_ILI9341::writeImageARGB(x, y, w, h, param);
+    }
+    void writePixels(lgfx::pixelcopy_t* param, uint32_t len, bool use_dma) override {
+        if (muted) { mutedWrites++; return; }
+        writes++;
+        if (capture) capture->mark(winX, winY, winW, winH);
+        if (band) band->mark(winX, winY, winW, winH);
+        lgfx::Panel_ILI9341::writePixels(param, len, use_dma);
+    }
+    void copyRect(uint_fast16_t dst_x, uint_fast16_t dst_y, uint_fast16_t w, uint_fast16_t h, uint_fast16_t src_x, uint_fast16_t src_y) override {
+        if (muted) { mutedWrites++; return; }
+        writes++;
+        if (capture) capture->mark(dst_x, dst_y, w, h);
+        if (band) band->mark(dst_x, dst_y, w, h);
+        lgfx::Panel_ILI9341::copyRect(dst_x, dst_y, w, h, src_x, src_y);
+    }
+};
+
 class LGFX_CYD : public lgfx::LGFX_Device {
-    lgfx::Panel_ILI9341 _panel_instance;
+    Panel_CYD _panel_instance;
     lgfx::Bus_SPI       _bus_instance;
     lgfx::Touch_XPT2046 _touch_instance;
     lgfx::Light_PWM     _light_instance;
@@ -96,6 +189,13 @@ public:
 
         setPanel(&_panel_instance);
     }
+
+    uint32_t panelWrites() const { return _panel_instance.writes; }
+    void setCapture(DrawCapture* capture) { _panel_instance.capture = capture; }
+    void setMuted(bool on) { _panel_instance.muted = on; }
+    uint32_t mutedWrites() const { return _panel_instance.mutedWrites; }
+
+    void setBandWatch(BandWatch* watch) { _panel_instance.band = watch; }
 };
 
 // --- HARDWARE MANAGER CLASS ---
@@ -104,21 +204,47 @@ public:
     LGFX_CYD tft;
     Preferences prefs;
     bool sdAvailable = false;
+
+    // UI fonts, until the kernel swaps in the subsetted ones from the
+    // asset pack. UI_PACKED_FONTS is defined by tools/build_assets.py when
+    // it built the subset: efont is then left out of the image and the
+    // built-in ASCII fonts only cover a missing asset pack.
+#ifdef UI_PACKED_FONTS
+    const lgfx::IFont* fontRegular = &fonts::Font2;
+    const lgfx::IFont* fontLarge = &fonts::Font4;
+#else
+    const lgfx::IFont* fontRegular = &fonts::efontCN_14;   // The 14/24 px faces the layouts were tuned for
+    const lgfx::IFont* fontLarge = &fonts::efontCN_24;
+#endif
     
     // Input State
     int touchX = 0; 
     int touchY = 0;
     bool isTouching = false;
+    bool touchPressed = false;   // First frame of a touch (press edge)
+    uint32_t touchMicros = 0;    // When the current reading was sampled
+
+    // Scripted tap (Serial "tap x y"), reported instead of the panel while held
+    int injectX = 0, injectY = 0;
+    unsigned long injectUntil = 0;
+    bool injecting = false;
+
+    // Wi-Fi connection state
+    WifiConnectPhase wifiPhase = WIFI_PHASE_IDLE;
+    unsigned long wifiConnectStart = 0;
+    uint32_t wifiTimeToIP = 0;   // ms from begin() to IP, last connection
+    bool wifiFastConnected = false;
+    String wifiSSID = "";
+    String wifiPass = "";
 
     void init() {
+        Serial.setTxBufferSize(1024); // Log lines and mirror packets queue up instead of blocking
         Serial.begin(115200);
 
         // 1. Init Display
         tft.begin();
         tft.setRotation(0); // 0 = Portrait, 1 = Landscape (Adjust if touch coordinates are flipped)
-        
-        // Ensure this font exists, otherwise use &fonts::Font4
-        tft.setFont(&fonts::efontCN_14); 
+        tft.setFont(fontRegular);
 
         // 2. Init SD Card (VSPI)
         SPI.begin(18, 19, 23);
@@ -129,10 +255,10 @@ public:
 
         if (SD.begin(SD_CS_PIN, SPI, 10000000)) {
             sdAvailable = true;
-            Serial.println("SYSTEM: SD Card Mounted");
+            sysLog(LOG_SD_MOUNTED);
         } else {
             sdAvailable = false;
-            Serial.println("SYSTEM: SD Card Missing or Fail - Running Safe Mode");
+            sysLog(LOG_SD_MISSING);
         }
         
         // 3. Init WiFi / Prefs
@@ -145,7 +271,18 @@ public:
     void updateInput() {
         uint16_t rawX, rawY;
         // getTouch returns true if screen is pressed
+        bool wasTouching = isTouching;
+        touchMicros = micros();
+        if (injecting) {
+            isTouching = (long)(millis() - injectUntil) < 0;
+            injecting = isTouching;
+            touchPressed = isTouching && !wasTouching;
+            touchX = injectX;
+            touchY = injectY;
+            return;
+        }
         isTouching = tft.getTouch(&rawX, &rawY);
+        touchPressed = isTouching && !wasTouching;
         
         if (isTouching) {
             // Mapping Logic (Adjust based on Rotation 0)
@@ -160,40 +297,145 @@ public:
         }
     }
 
+    // Press at (x, y) for holdMs, as if the panel reported it. The press
+    // edge needs a released frame before it: queue taps at least holdMs apart.
+    void injectTap(int x, int y, uint32_t holdMs = 80) {
+        injectX = x;
+        injectY = y;
+        injectUntil = millis() + holdMs;
+        injecting = true;
+    }
+
     // Helper for Rect collision
     bool isTouchInRect(int x, int y, int w, int h) {
         return (isTouching && touchX >= x && touchX <= x + w && touchY >= y && touchY <= y + h);
     }
 
+    bool isTouchIn(const UiRect& r) {
+        return isTouching && r.contains(touchX, touchY);
+    }
+
     void resetScreen(uint16_t bgColor) {
         tft.fillScreen(bgColor);
+        resetTextState();
+    }
+
+    // Text defaults every app starts from
+    void resetTextState() {
         tft.setCursor(0, 0);
         tft.setTextDatum(textdatum_t::top_left);
-        tft.setFont(&fonts::efontCN_14);
+        tft.setFont(fontRegular);
         tft.setTextSize(1);
     }
 
+    // Starts a connection. With a known channel/BSSID the driver skips the
+    // scan. The address always comes from DHCP: a cached lease reused as a
+    // static IP could clash with one the router has handed out since.
+    void connectWifi(const String& ssid, const String& pass, int32_t channel = 0, const uint8_t* bssid = nullptr) {
+        wifiSSID = ssid;
+        wifiPass = pass;
+        wifiFastConnected = false;
+        wifiConnectStart = millis();
+
+        WiFi.disconnect();
+
+        WiFi.begin(ssid.c_str(), pass.c_str(), channel, bssid);
+        wifiPhase = (channel != 0 && bssid != nullptr) ? WIFI_PHASE_FAST : WIFI_PHASE_FULL;
+    }
+
+    // Drives the connection state machine, call once per loop.
+    // Only an attempt in flight is polled: once the link is up, drops and
+    // reconnects are reported by Wi-Fi events (see NetworkState).
+    void serviceWifi() {
+        if (wifiPhase != WIFI_PHASE_FAST && wifiPhase != WIFI_PHASE_FULL) return;
+
+        if (WiFi.status() == WL_CONNECTED) {
+            wifiTimeToIP = millis() - wifiConnectStart;
+            wifiFastConnected = (wifiPhase == WIFI_PHASE_FAST);
+            wifiPhase = WIFI_PHASE_UP;
+            sysLog(LOG_WIFI_UP, wifiTimeToIP, wifiFastConnected ? "fast" : "full");
+            // Refresh BSSID/channel for the next boot (written only if changed)
+            saveCurrentWifi();
+        } else if (wifiPhase == WIFI_PHASE_FAST && millis() - wifiConnectStart > WIFI_FAST_CONNECT_TIMEOUT_MS) {
+            // AP moved or changed channel... do it the slow way. The clock keeps
+            // running so the metric shows the cost of the failed attempt.
+            unsigned long start = wifiConnectStart;
+            connectWifi(wifiSSID, wifiPass);
+            wifiConnectStart = start;
+        }
+    }
+
     bool loadSavedWifi() {
         prefs.begin("wifi_conf", true); // Read-only
         String s = prefs.getString("ssid", "");
         String p = prefs.getString("pass", "");
+        uint8_t bssid[6];
+        bool haveBssid = prefs.getBytes("bssid", bssid, sizeof(bssid)) == sizeof(bssid);
+        uint8_t channel = prefs.getUChar("chan", 0);
         prefs.end();
 
         if (s.length() > 0) {
-            WiFi.begin(s.c_str(), p.c_str());
+            if (haveBssid && channel != 0) connectWifi(s, p, channel, bssid);
+            else connectWifi(s, p);
             return true;
         }
         return false;
     }
 
+    // Only the values that changed are written: NVS is not rewritten on
+    // every reconnect to the same AP
     bool saveCurrentWifi() {
-        if (WiFi.status() == WL_CONNECTED) {
-            prefs.begin("wifi_conf", false); // Read/Write
-            prefs.putString("ssid", WiFi.SSID());
-            prefs.putString("pass", WiFi.psk());
-            prefs.end();
-            return true;
+        if (WiFi.status() != WL_CONNECTED) return false;
+        prefs.begin("wifi_conf", false); // Read/Write
+        String ssid = WiFi.SSID();
+        String pass = WiFi.psk();
+        if (prefs.getString("ssid", "") != ssid) prefs.putString("ssid", ssid);
+        if (prefs.getString("pass", "") != pass) prefs.putString("pass", pass);
+
+        uint8_t saved[6];
+        const uint8_t* bssid = WiFi.BSSID();
+        if (bssid && (prefs.getBytes("bssid", saved, sizeof(saved)) != sizeof(saved) || memcmp(saved, bssid, 6) != 0)) {
+            prefs.putBytes("bssid", bssid, 6);
         }
-        return false;
+        uint8_t chan = WiFi.channel();
+        if (prefs.getUChar("chan", 0) != chan) prefs.putUChar("chan", chan);
+        prefs.end();
+        return true;
+    }
+
+    // Opt-in full font: glyphs missing from the subset are read from SD
+    bool loadFullFontPref() {
+        prefs.begin("ui_conf", true);
+        bool on = prefs.getBool("fullFont", false);
+        prefs.end();
+        return on;
+    }
+
+    void saveFullFontPref(bool on) {
+        prefs.begin("ui_conf", false);
+        prefs.putBool("fullFont", on);
+        prefs.end();
+    }
+
+    uint8_t loadShotTriggers(uint8_t fallback) {
+        prefs.begin("ui_conf", true);
+        uint8_t t = prefs.getUChar("shotTrig", fallback);
+        prefs.end();
+        return t;
+    }
+
+    void saveShotTriggers(uint8_t triggers) {
+        prefs.begin("ui_conf", false);
+        prefs.putUChar("shotTrig", triggers);
+        prefs.end();
+    }
+
+    // Screenshot file numbers keep counting across reboots
+    uint16_t nextShotNumber() {
+        prefs.begin("ui_conf", false);
+        uint16_t n = prefs.getUShort("shotNo", 0);
+        prefs.putUShort("shotNo", n + 1);
+        prefs.end();
+        return n;
     }
 };
\ No newline at end of file
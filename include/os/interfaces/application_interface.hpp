@@ -1,5 +1,6 @@
 #pragma once
 #include "hal/hal.hpp"
+#include "daas/daas_types.hpp"
 #include "../../themes/theme_structure.hpp"
 
 // Forward declaration
@@ -9,6 +10,25 @@ class Kernel;
 // ID < 64 -> System/Internal Apps
 // ID >=64 -> External/User Apps
 
+enum AppState : uint8_t {
+    APP_STOPPED,      // Never launched
+    APP_FOREGROUND,   // On screen: onUpdate every loop
+    APP_BACKGROUND,   // Off screen: onBackgroundTick at a low rate, never draws
+    APP_SUSPENDED     // Off screen, no ticks and no events (runsInBackground() is false)
+};
+
+enum AppEventType : uint8_t {
+    APP_EVENT_DDO,    // A DDO from din is waiting to be pulled
+    APP_EVENT_NODE    // din was discovered
+};
+
+// Delivered to every launched app, in front or not
+struct AppEvent {
+    AppEventType type;
+    typeset_t typeset;
+    din_t din;
+};
+
 class Application {
 protected:
     HardwareManager* hw;
@@ -18,6 +38,7 @@ protected:
     u8_t pid;
     u8_t appID;
     bool needsRedraw = true;
+    AppState appState = APP_STOPPED;
 
     Application() : pid(0), appID(255) {} // Default constructor
     Application(u8_t id) : pid(0), appID(id) {} // Constructor with App ID
@@ -31,9 +52,19 @@ public:
     void forceRedraw() {
         needsRedraw = true;
     }
+    bool redrawPending() const { return needsRedraw; }
     void setPID(u8_t id) { pid = id; }
     u8_t getPID() const { return pid; }
     u8_t getAppID() const { return appID; }
+    virtual const char* getName() const { return "App"; }
+    void setState(AppState s) { appState = s; }
+    AppState getState() const { return appState; }
+
+    // Background work: ticks while another app is in front. Nothing drawn
+    // off screen reaches the panel.
+    virtual bool runsInBackground() const { return false; }
+    virtual void onBackgroundTick() {}
+    virtual void onEvent(const AppEvent& event) {}
 
 
     virtual void onStart() = 0;   // Setup
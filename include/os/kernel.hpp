@@ -3,6 +3,25 @@
 #include "modules/application_manager.hpp"
 #include "modules/taskmanager.hpp"
 #include "modules/keyboard.hpp"
+#include "modules/node_directory.hpp"
+#include "modules/liveness.hpp"
+#include "modules/benchmark.hpp"
+#include "modules/metrics.hpp"
+#include "modules/wifi_scanner.hpp"
+#include "modules/network_state.hpp"
+#include "modules/storage.hpp"
+#include "modules/asset_pack.hpp"
+#include "modules/packed_font.hpp"
+#include "modules/animation.hpp"
+#include "modules/word_predictor.hpp"
+#include "modules/latency.hpp"
+#include "modules/console.hpp"
+#include "modules/trace.hpp"
+#include "modules/mirror.hpp"
+#include "modules/screenshot.hpp"
+#include "modules/watchdog.hpp"
+#include "modules/heap_tags.hpp"
+#include "modules/app_events.hpp"
 #include "themes/theme_structure.hpp"
 
 #include "daas/daas_interfaces.hpp"
@@ -17,8 +36,45 @@ private:
     ThemePalette *currentTheme = nullptr;
     VirtualKeyboard keyboard;
     Application* currentApp = nullptr;
+    Application* pendingApp = nullptr;   // Shown when the page transition ends
+    int pageTransition = -1;             // Tween handle
 
-    Vector<din_t> discoveredNodes;
+    // Apps behind the one in front: events and low-rate ticks, never drawn
+    AppEventQueue appEvents;
+    int backgroundSlot = 0;              // Next app slot of the current round
+    unsigned long backgroundRound = 0;
+    void runBackground();
+    void runOffscreen(Application* app, const AppEvent* event);
+
+    NodeDirectory nodeDirectory;
+    LivenessMonitor liveness;
+    BenchmarkRunner benchmark;
+    MetricsSampler metrics;
+    WifiScanner wifiScanner;
+    NetworkState network;
+    StorageService storage;
+    AssetPack assets;
+    AnimationEngine animations;
+    WordPredictor predictor;   // Keyboard suggestions: mapped lexicon + learned words
+    LatencyTracker latency;    // Touch-to-photon, per app
+    ScreenMirror mirror;       // Remote view of the screen (Serial / DDO)
+    ScreenshotService screenshots;
+    StallWatchdog watchdog;    // Loop phase budgets, stalls attributed to apps
+
+    // Subsetted UI fonts from the asset pack, with the optional SD fallback
+    PackedFont uiFont;
+    PackedFont uiFontLarge;
+    uint32_t fontDrawnVersion = 0;   // Fallback glyphs shown on screen
+    void loadFonts();
+
+    // Diagnostic shell on Serial (never blocks the loop)
+    DiagConsole console;
+    TraceRing trace;
+    void initConsole();
+    int16_t shotRow = -1, shotCol = 0;   // Screenshot being streamed
+    din_t dperfTarget = 0;               // One-shot dperf waiting for its result
+    unsigned long dperfStart = 0;
+    unsigned long lastNodeAging = 0;
     
     public:
     
@@ -33,17 +89,41 @@ private:
 
     void run();
 
-    void addNode(din_t din) {
-        // Check if already present
-        for (u32_t i = 0; i < discoveredNodes.size(); i++) {
-            if (discoveredNodes[i] == din || discoveredNodes[i]>>44 == din>>44) return; // Already present
-        }
-        discoveredNodes.push_back(din);
+    // Any event from a node refreshes its directory entry and counts as a heartbeat
+    // One record per DIN, no per-prefix dedup (see NodeDirectory)
+    void addNode(din_t din, link_t link = _LINK_NONE) {
+        nodeDirectory.touch(din, node.getSyncedTimestamp(), link);
+        liveness.heartbeat(din);
     }
 
-    Vector<din_t>& getDiscoveredNodes() {
-        return discoveredNodes;
+    NodeDirectory& getNodeDirectory() {
+        return nodeDirectory;
     }
+
+    LivenessMonitor* getLiveness() { return &liveness; }
+    BenchmarkRunner* getBenchmark() { return &benchmark; }
+    MetricsSampler* getMetrics() { return &metrics; }
+    WifiScanner* getWifiScanner() { return &wifiScanner; }
+    NetworkState* getNetwork() { return &network; }
+    StorageService* getStorage() { return &storage; }
+    const AssetPack* getAssets() const { return &assets; }
+    AnimationEngine* getAnimations() { return &animations; }
+    LatencyTracker* getLatency() { return &latency; }
+    TraceRing* getTrace() { return &trace; }
+    ScreenMirror* getMirror() { return &mirror; }
+    ScreenshotService* getScreenshots() { return &screenshots; }
+    StallWatchdog* getWatchdog() { return &watchdog; }
+    uint8_t currentAppID() const { return currentApp ? currentApp->getAppID() : 0xFF; }
+
+    // From the DaaS callbacks, delivered to the apps by the loop
+    void postEvent(const AppEvent& event) { appEvents.post(event); }
+
+    // Called from IDaasApiEvent::frisbeeDperfCompleted
+    void onDperfCompleted(din_t din);
+
+    // Full-font fallback from SD (persisted)
+    void setFullFont(bool on, bool persist = true);
+    bool isFullFont() const { return uiFont.hasFallback(); }
     
 
     // API Accessors
@@ -51,6 +131,7 @@ private:
     HardwareManager* getHW() { return &hardware; }
     DaasAPI* getNode() { return &node; }
     VirtualKeyboard* getKeyboard() { return &keyboard; }
+    WordPredictor* getPredictor() { return &predictor; }
     bool daasNetworkConnected = false;
 
     bool ddoPulled = false;
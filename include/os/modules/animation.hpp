@@ -0,0 +1,160 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+#define ANIM_MAX_TWEENS 8
+#define ANIM_FRAME_MS 16      // Frame clock: tweens step at most ~60 times a second
+#define ANIM_ONE 4096         // Q12 fixed point 1.0
+#define ANIM_LUT_SEGMENTS 64
+
+enum Easing : uint8_t {
+    EASE_LINEAR,
+    EASE_OUT_CUBIC,      // Decelerate: slides in
+    EASE_IN_OUT_CUBIC,   // Page transitions
+    EASE_OUT_BACK,       // Slight overshoot: press feedback
+    EASE_OUT_ELASTIC     // Magnetic snap (boot animation)
+};
+
+// Easing curves sampled at 65 points in Q12, interpolated linearly.
+// Precomputed offline: no float math on the frame path.
+static const int16_t EASE_LUT[4][ANIM_LUT_SEGMENTS + 1] = {
+    { // EASE_OUT_CUBIC
+    0, 189, 372, 549, 721, 887, 1047, 1202, 1352, 1496, 1636, 1770, 1899,
+    2023, 2143, 2258, 2368, 2474, 2575, 2672, 2765, 2854, 2938, 3019, 3096, 3169,
+    3239, 3305, 3367, 3426, 3482, 3534, 3584, 3631, 3674, 3715, 3753, 3788, 3821,
+    3852, 3880, 3906, 3930, 3951, 3971, 3989, 4005, 4019, 4032, 4043, 4053, 4062,
+    4069, 4075, 4080, 4085, 4088, 4091, 4093, 4094, 4095, 4096, 4096, 4096, 4096 },
+    { // EASE_IN_OUT_CUBIC
+    0, 0, 0, 2, 4, 8, 14, 21, 32, 46, 62, 83, 108,
+    137, 172, 211, 256, 307, 364, 429, 500, 579, 666, 760, 864, 977,
+    1098, 1230, 1372, 1524, 1688, 1862, 2048, 2234, 2408, 2572, 2724, 2866, 2998,
+    3119, 3232, 3336, 3430, 3517, 3596, 3667, 3732, 3789, 3840, 3885, 3924, 3959,
+    3988, 4013, 4034, 4050, 4064, 4075, 4082, 4088, 4092, 4094, 4096, 4096, 4096 },
+    { // EASE_OUT_BACK
+    0, 295, 577, 846, 1104, 1350, 1584, 1807, 2019, 2220, 2411, 2591, 2762,
+    2922, 3073, 3215, 3348, 3472, 3588, 3695, 3794, 3886, 3970, 4047, 4117, 4180,
+    4237, 4287, 4332, 4371, 4404, 4432, 4455, 4474, 4488, 4498, 4503, 4506, 4504,
+    4500, 4493, 4483, 4470, 4455, 4439, 4421, 4401, 4380, 4359, 4336, 4314, 4291,
+    4268, 4246, 4224, 4203, 4183, 4165, 4148, 4133, 4121, 4110, 4102, 4098, 4096 },
+    { // EASE_OUT_ELASTIC
+    0, 615, 1479, 2452, 3409, 4252, 4914, 5361, 5587, 5612, 5471, 5212, 4886,
+    4539, 4213, 3939, 3734, 3607, 3557, 3574, 3642, 3746, 3866, 3987, 4096, 4184,
+    4245, 4279, 4287, 4273, 4243, 4203, 4160, 4118, 4083, 4055, 4037, 4029, 4030,
+    4037, 4049, 4064, 4079, 4093, 4105, 4113, 4118, 4120, 4119, 4115, 4110, 4105,
+    4100, 4095, 4091, 4089, 4088, 4088, 4088, 4090, 4092, 4094, 4095, 4097, 4096 }
+};
+
+// t and the result in Q12 (0..ANIM_ONE), the result may overshoot
+inline int32_t ease(Easing easing, int32_t t) {
+    if (t <= 0) return 0;
+    if (t >= ANIM_ONE) return ANIM_ONE;
+    if (easing == EASE_LINEAR) return t;
+    const int16_t* lut = EASE_LUT[easing - 1];
+    int32_t pos = t * ANIM_LUT_SEGMENTS;             // Q12 index
+    int32_t i = pos >> 12;
+    int32_t frac = pos & (ANIM_ONE - 1);
+    return lut[i] + (((lut[i + 1] - lut[i]) * frac) >> 12);
+}
+
+// from + (to - from) * eased progress, elapsed/duration in ms
+inline int32_t tweenValue(int32_t from, int32_t to, uint32_t elapsed, uint32_t duration, Easing easing) {
+    int32_t t = duration ? (int32_t)((min(elapsed, duration) << 12) / duration) : ANIM_ONE;
+    return from + (int32_t)(((int64_t)(to - from) * ease(easing, t)) >> 12);
+}
+
+// value, previous value, last step. Steps only come when the value changed
+// (and always for the last one), so the callback redraws just the region
+// between the two values.
+typedef std::function<void(int32_t, int32_t, bool)> TweenStep;
+
+// Frame-clocked tweens, stepped from the kernel loop: animations never
+// block, so DaaS servicing and input keep running while they play.
+class AnimationEngine {
+private:
+    struct Tween {
+        bool active = false;
+        uint16_t generation = 0;   // Handles of finished tweens go stale
+        int32_t from = 0, to = 0, value = 0;
+        uint32_t start = 0;
+        uint32_t duration = 0;
+        Easing easing = EASE_LINEAR;
+        TweenStep step;
+    };
+
+    Tween tweens[ANIM_MAX_TWEENS];
+    uint32_t frameTime = 0;
+    uint32_t lastFrame = 0;
+
+    static int handle(int slot, uint16_t generation) { return (generation << 8) | slot; }
+
+    Tween* byHandle(int id) {
+        if (id < 0) return nullptr;
+        Tween& tw = tweens[id & 0xFF];
+        return (tw.active && tw.generation == (id >> 8)) ? &tw : nullptr;
+    }
+
+public:
+    // Starts a tween and returns its handle, -1 if the pool is full.
+    // The first frame is drawn on the next update().
+    int start(int32_t from, int32_t to, uint32_t durationMs, Easing easing, TweenStep step) {
+        for (int i = 0; i < ANIM_MAX_TWEENS; i++) {
+            Tween& tw = tweens[i];
+            if (tw.active) continue;
+            tw.active = true;
+            tw.generation = (tw.generation + 1) & 0x7FFF;
+            tw.from = from;
+            tw.to = to;
+            tw.value = from;
+            tw.start = millis();
+            tw.duration = durationMs;
+            tw.easing = easing;
+            tw.step = step;
+            lastFrame = 0; // Draw the first frame right away
+            return handle(i, tw.generation);
+        }
+        return -1;
+    }
+
+    // Stops without the last step; the caller owns the screen state
+    void cancel(int id) {
+        Tween* tw = byHandle(id);
+        if (tw) { tw->active = false; tw->step = nullptr; }
+    }
+
+    bool isRunning(int id) { return byHandle(id) != nullptr; }
+
+    // Current value of a running tween
+    int32_t valueOf(int id, int32_t fallback = 0) {
+        Tween* tw = byHandle(id);
+        return tw ? tw->value : fallback;
+    }
+
+    bool busy() const {
+        for (const auto& tw : tweens) if (tw.active) return true;
+        return false;
+    }
+
+    // Once per loop; every tween of a frame samples the same clock
+    void update() {
+        uint32_t now = millis();
+        if (lastFrame != 0 && now - lastFrame < ANIM_FRAME_MS) return;
+        lastFrame = now ? now : 1;
+        frameTime = now;
+
+        for (auto& tw : tweens) {
+            if (!tw.active) continue;
+            uint32_t elapsed = frameTime - tw.start;
+            bool last = elapsed >= tw.duration;
+            int32_t prev = tw.value;
+            tw.value = last ? tw.to : tweenValue(tw.from, tw.to, elapsed, tw.duration, tw.easing);
+            if (tw.value == prev && !last) continue;
+
+            // The step may start new tweens (or cancel this one): copy it out first
+            TweenStep step = tw.step;
+            if (last) { tw.active = false; tw.step = nullptr; }
+            if (step) step(tw.value, prev, last);
+        }
+    }
+
+    uint32_t getFrameTime() const { return frameTime; }
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "../interfaces/application_interface.hpp"
+
+#define APP_EVENT_SLOTS 16   // Power of two
+
+// Events for the apps, posted by the DaaS callbacks and delivered by the
+// kernel loop, so app code never runs inside the node. A full queue drops
+// the newest event: apps poll the node anyway, the event only wakes them.
+class AppEventQueue {
+private:
+    AppEvent ring[APP_EVENT_SLOTS];
+    uint32_t head = 0;   // Next to pop
+    uint32_t tail = 0;   // Next to push
+    uint32_t dropped = 0;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+public:
+    bool post(const AppEvent& e) {
+        portENTER_CRITICAL(&lock);
+        bool ok = tail - head < APP_EVENT_SLOTS;
+        if (ok) ring[tail++ & (APP_EVENT_SLOTS - 1)] = e;
+        else dropped++;
+        portEXIT_CRITICAL(&lock);
+        return ok;
+    }
+
+    bool pop(AppEvent& e) {
+        portENTER_CRITICAL(&lock);
+        bool ok = head != tail;
+        if (ok) e = ring[head++ & (APP_EVENT_SLOTS - 1)];
+        portEXIT_CRITICAL(&lock);
+        return ok;
+    }
+
+    uint32_t pending() const { return tail - head; }
+    uint32_t droppedCount() const { return dropped; }
+};
@@ -3,17 +3,50 @@
 #include <ArduinoJson.h>
 
 #include "hal/hal.hpp"
+#include "storage.hpp"
 #include "../interfaces/application_link_interface.hpp"
 
 class AppRegistry {
 private:
     std::vector<AppShortcut> apps;
     HardwareManager* hw;
+    StorageService* storage;
     const char* REGISTRY_FILE = "/apps.json";
+    uint32_t changeVersion = 0;
+    bool loading = false;        // /apps.json not read yet: saving now would drop its apps
+    bool savePending = false;    // Installed during the load, saved once it completes
+    size_t loadedAt = 0;         // Where the apps read from the file go
+
+    bool installed(const String& path) const {
+        for (const auto& a : apps) {
+            if (a.type == APP_EXTERNAL && a.execPath == path) return true;
+        }
+        return false;
+    }
+
+    // Merges the file into the list, ahead of apps installed during the load
+    void parseRegistry(const String& json) {
+        DynamicJsonDocument doc(2048);
+        DeserializationError error = deserializeJson(doc, json);
+        if (error) return;
+
+        JsonArray array = doc.as<JsonArray>();
+        for (JsonObject obj : array) {
+            AppShortcut a;
+            a.name = obj["name"].as<String>();
+            a.color = obj["color"];
+            a.type = APP_EXTERNAL;
+            a.execPath = obj["path"].as<String>();
+            if (installed(a.execPath)) continue;
+            apps.insert(apps.begin() + loadedAt++, a);
+        }
+        changeVersion++;
+    }
 
 public:
-    void init(HardwareManager* h) {
+    void init(HardwareManager* h, StorageService* s) {
         hw = h;
+        storage = s;
         loadRegistry();
     }
 
@@ -24,26 +57,19 @@ public:
         apps.push_back({"Settings", "", 0x738E, APP_INTERNAL, "SYS_SETTINGS"});
         apps.push_back({"Chat", "", 0x3333, APP_INTERNAL, "SYS_CHAT"});
 
-        // 2. Load External Apps from SD
-        if (hw->sdAvailable && SD.exists(REGISTRY_FILE)) {
-            File file = SD.open(REGISTRY_FILE, "r");
-            if (file) {
-                DynamicJsonDocument doc(2048);
-                DeserializationError error = deserializeJson(doc, file);
-                if (!error) {
-                    JsonArray array = doc.as<JsonArray>();
-                    for (JsonObject obj : array) {
-                        AppShortcut a;
-                        a.name = obj["name"].as<String>();
-                        a.color = obj["color"];
-                        a.type = APP_EXTERNAL;
-                        a.execPath = obj["path"].as<String>();
-                        apps.push_back(a);
-                    }
-                }
-                file.close();
+        changeVersion++;
+
+        // 2. Load External Apps from SD (async, they show up when the read completes)
+        loading = true;
+        loadedAt = apps.size();
+        storage->read(REGISTRY_FILE, 0, 0, [this](const StorageRequest& req) {
+            if (req.ok()) parseRegistry(req.text());
+            loading = false;
+            if (savePending) {
+                savePending = false;
+                saveRegistry();
             }
-        }
+        });
     }
 
     void installApp(String name, String path, uint16_t color) {
@@ -54,7 +80,8 @@ public:
     }
 
     void saveRegistry() {
-        if (!hw->sdAvailable) return;
+        if (!storage->isAvailable()) return;
+        if (loading) { savePending = true; return; }
 
         DynamicJsonDocument doc(2048);
         JsonArray array = doc.to<JsonArray>();
@@ -69,10 +96,13 @@ public:
             }
         }
 
-        File file = SD.open(REGISTRY_FILE, "w");
-        serializeJson(doc, file);
-        file.close();
+        String json;
+        serializeJson(doc, json);
+        storage->write(REGISTRY_FILE, json);
     }
 
     std::vector<AppShortcut>& getApps() { return apps; }
+
+    // Bumped when the app list changes (e.g. the SD registry finished loading)
+    uint32_t version() const { return changeVersion; }
 };
\ No newline at end of file
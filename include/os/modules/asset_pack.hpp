@@ -0,0 +1,215 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+#include <esp_rom_crc.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Packed read-only assets, built by tools/pack_assets.py.
+//
+//   AssetPackHeader
+//   AssetEntry[count]      sorted by name hash
+//   names                  NUL terminated, referenced by nameOffset
+//   blobs                  each 4-byte aligned
+//
+// All integers little endian. crc covers every byte after the header.
+
+#define ASSET_PACK_MAGIC 0x4B504D41   // "AMPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PARTITION_LABEL "assets"
+#define ASSET_PARTITION_SUBTYPE 0x40  // Custom data subtype, see huge_app.csv
+
+enum AssetType : uint16_t {
+    ASSET_RAW = 0,
+    ASSET_IMAGE = 1,    // AssetImage header + RGB565 pixels, panel byte order
+    ASSET_FONT = 2,     // VLW font, for LGFX loadFont(const uint8_t*)
+    ASSET_LAYOUT = 3,   // JSON
+    ASSET_GLYPHS = 4,   // PackedFont (packed_font.hpp), from tools/subset_fonts.py
+    ASSET_LEXICON = 5   // Word DAWG (word_predictor.hpp), from tools/build_lexicon.py
+};
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t totalSize;   // Header included
+    uint32_t crc;
+};
+
+struct AssetEntry {
+    uint32_t hash;        // FNV-1a of the name
+    uint32_t nameOffset;  // From the start of the pack
+    uint32_t offset;      // From the start of the pack, 4-byte aligned
+    uint32_t size;
+    uint16_t type;        // AssetType
+    uint16_t flags;
+};
+
+struct AssetImage {
+    uint16_t width;
+    uint16_t height;
+    uint32_t reserved;
+    uint16_t pixels[];    // width * height, big endian RGB565 (lgfx::swap565_t)
+};
+
+static_assert(sizeof(AssetPackHeader) == 16, "pack header layout");
+static_assert(sizeof(AssetEntry) == 20, "pack entry layout");
+static_assert(sizeof(AssetImage) == 8, "image header layout");
+
+// Zero-copy view of an asset pack.
+// On the device the "assets" partition is mapped into the data address
+// space with esp_partition_mmap, on a host build the pack file is mmap'd:
+// either way lookups return pointers straight into the mapping, with no
+// heap use and no file I/O on the draw path.
+class AssetPack {
+private:
+    const uint8_t* base = nullptr;
+    const AssetPackHeader* header = nullptr;
+    const AssetEntry* entries = nullptr;
+
+#if defined(ARDUINO)
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_partition_mmap_handle_t mapping = 0;
+#else
+    spi_flash_mmap_handle_t mapping = 0;
+#endif
+#else
+    size_t mappedSize = 0;
+#endif
+
+    static uint32_t crc32(const uint8_t* data, size_t len) {
+#if defined(ARDUINO)
+        return esp_rom_crc32_le(0, data, len);
+#else
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < len; i++) {
+            crc ^= data[i];
+            for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+        return ~crc;
+#endif
+    }
+
+    bool validate(size_t available) {
+        header = (const AssetPackHeader*)base;
+        if (available < sizeof(AssetPackHeader)) return false;
+        if (header->magic != ASSET_PACK_MAGIC || header->version != ASSET_PACK_VERSION) return false;
+        if (header->totalSize > available) return false;
+        if ((size_t)header->count * sizeof(AssetEntry) > header->totalSize - sizeof(AssetPackHeader)) return false;
+        if (crc32(base + sizeof(AssetPackHeader), header->totalSize - sizeof(AssetPackHeader)) != header->crc) return false;
+
+        entries = (const AssetEntry*)(base + sizeof(AssetPackHeader));
+        for (uint16_t i = 0; i < header->count; i++) {
+            const AssetEntry& e = entries[i];
+            if (e.offset > header->totalSize || e.size > header->totalSize - e.offset) return false;
+            if (e.nameOffset >= header->totalSize) return false;
+        }
+        return true;
+    }
+
+public:
+    static uint32_t hashName(const char* name) {
+        uint32_t h = 2166136261u;
+        while (*name) { h ^= (uint8_t)*name++; h *= 16777619u; }
+        return h;
+    }
+
+    // source: partition label on the device, pack file path on a host build
+    bool open(const char* source = ASSET_PARTITION_LABEL) {
+        close();
+#if defined(ARDUINO)
+        const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                              (esp_partition_subtype_t)ASSET_PARTITION_SUBTYPE, source);
+        if (!part) return false;
+        const void* ptr = nullptr;
+#if ESP_IDF_VERSION_MAJOR >= 5
+        if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &mapping) != ESP_OK) return false;
+#else
+        if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &mapping) != ESP_OK) return false;
+#endif
+        base = (const uint8_t*)ptr;
+        size_t available = part->size;
+#else
+        int fd = ::open(source, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+        void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) return false;
+        base = (const uint8_t*)ptr;
+        mappedSize = st.st_size;
+        size_t available = mappedSize;
+#endif
+        if (!validate(available)) { close(); return false; }
+        return true;
+    }
+
+    void close() {
+        if (!base) return;
+#if defined(ARDUINO)
+        esp_partition_munmap(mapping);
+#else
+        munmap((void*)base, mappedSize);
+#endif
+        base = nullptr;
+        header = nullptr;
+        entries = nullptr;
+    }
+
+    bool isOpen() const { return entries != nullptr; }
+    uint16_t size() const { return isOpen() ? header->count : 0; }
+
+    // Binary search on the hash, names disambiguate collisions
+    const AssetEntry* find(const char* name) const {
+        if (!isOpen()) return nullptr;
+        uint32_t h = hashName(name);
+        int lo = 0, hi = header->count - 1;
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+            if (entries[mid].hash < h) lo = mid + 1;
+            else if (entries[mid].hash > h) hi = mid - 1;
+            else {
+                // Step back to the first entry with this hash, then scan the run
+                while (mid > 0 && entries[mid - 1].hash == h) mid--;
+                for (; mid < header->count && entries[mid].hash == h; mid++) {
+                    if (strcmp(nameOf(entries[mid]), name) == 0) return &entries[mid];
+                }
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    const char* nameOf(const AssetEntry& e) const { return (const char*)(base + e.nameOffset); }
+    const uint8_t* dataOf(const AssetEntry& e) const { return base + e.offset; }
+    const AssetEntry* entryAt(uint16_t idx) const { return idx < size() ? &entries[idx] : nullptr; }
+
+    // Pointer into the mapping, nullptr if missing or of another type
+    const uint8_t* get(const char* name, AssetType type, uint32_t* len = nullptr) const {
+        const AssetEntry* e = find(name);
+        if (!e || e->type != type) return nullptr;
+        if (len) *len = e->size;
+        return dataOf(*e);
+    }
+
+    const AssetImage* image(const char* name) const {
+        uint32_t len = 0;
+        const AssetImage* img = (const AssetImage*)get(name, ASSET_IMAGE, &len);
+        if (!img || len < sizeof(AssetImage) + (uint32_t)img->width * img->height * 2) return nullptr;
+        return img;
+    }
+
+    const uint8_t* font(const char* name) const { return get(name, ASSET_FONT); }
+    const uint8_t* glyphs(const char* name, uint32_t* len) const { return get(name, ASSET_GLYPHS, len); }
+    const uint8_t* lexicon(const char* name, uint32_t* len) const { return get(name, ASSET_LEXICON, len); }
+};
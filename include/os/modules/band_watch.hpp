@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "layout.hpp"
+
+// Pixels of a screen band that other code drew into, one bit each. Filled
+// in by Panel_CYD on the loop task; the owner reads back exactly those
+// pixels, never the area between two separate writes.
+class BandWatch {
+private:
+    std::vector<uint8_t> bits;
+    UiRect band = {0, 0, 0, 0};
+    int stride = 0;                  // Bytes per band row
+    bool any = false;
+
+    void setRun(uint8_t* row, int from, int to) {
+        for (int x = from; x < to; x++) row[x >> 3] |= 1 << (x & 7);
+    }
+
+public:
+    uint8_t paused = 0;              // The owner is drawing its own band
+
+    // Largest band, allocated once
+    void reserve(int w, int h) { bits.resize(((w + 7) / 8) * h); }
+
+    // Band to watch, w == 0 stops watching. A band larger than the
+    // reserved size is not watched.
+    void watch(const UiRect& r) {
+        band = r;
+        stride = (r.w + 7) / 8;
+        if ((size_t)stride * r.h > bits.size()) band.w = 0;
+        memset(bits.data(), 0, bits.size());
+        any = false;
+    }
+
+    void clear() {
+        if (any) memset(bits.data(), 0, bits.size());
+        any = false;
+    }
+
+    void mark(int x, int y, int w, int h) {
+        if (band.w == 0 || paused) return;
+        int l = x > band.x ? x : band.x, t = y > band.y ? y : band.y;
+        int r = x + w < band.right() ? x + w : band.right();
+        int b = y + h < band.bottom() ? y + h : band.bottom();
+        if (r <= l || b <= t) return;
+        for (int row = t; row < b; row++) setRun(bits.data() + (row - band.y) * stride, l - band.x, r - band.x);
+        any = true;
+    }
+
+    bool hit() const { return any; }
+
+    // Calls fn(x, y, w) for every horizontal run of marked pixels, then
+    // starts over
+    template <typename F>
+    void takeRuns(F fn) {
+        if (!any) return;
+        for (int row = 0; row < band.h; row++) {
+            const uint8_t* bitsRow = bits.data() + row * stride;
+            int x = 0;
+            while (x < band.w) {
+                if (!bitsRow[x >> 3] && !(x & 7)) { x += 8; continue; }
+                if (!(bitsRow[x >> 3] & (1 << (x & 7)))) { x++; continue; }
+                int start = x;
+                while (x < band.w && (bitsRow[x >> 3] & (1 << (x & 7)))) x++;
+                fn(band.x + start, band.y + row, x - start);
+            }
+        }
+        clear();
+    }
+};
@@ -0,0 +1,267 @@
+#pragma once
+#include <Arduino.h>
+#include "daas/daas.hpp"
+#include "storage.hpp"
+#include "network_state.hpp"
+
+#define BENCH_CSV_FILE "/bench.csv"
+#define BENCH_REPEATS 3              // Runs per case, jitter is computed across them
+#define BENCH_BASE_TIMEOUT_MS 5000   // Per run, plus 1 ms per KB transferred
+#define BENCH_LATE_GRACE_MS 2000     // After a timeout: completions still arriving are the lost run's
+#define BENCH_LOOPBACK_DIN 0xB0B0B0ULL
+#define BENCH_LOOPBACK_URI "127.0.0.1:9910"
+
+static const uint32_t BENCH_BLOCK_SIZES[] = {32, 128, 512, 1024};
+static const uint32_t BENCH_PACKET_COUNTS[] = {10, 100};
+
+#define BENCH_BLOCK_STEPS (sizeof(BENCH_BLOCK_SIZES) / sizeof(BENCH_BLOCK_SIZES[0]))
+#define BENCH_PACKET_STEPS (sizeof(BENCH_PACKET_COUNTS) / sizeof(BENCH_PACKET_COUNTS[0]))
+#define BENCH_CASES (BENCH_BLOCK_STEPS * BENCH_PACKET_STEPS)
+
+// Aggregated result of one (block size, packet count) case
+struct BenchResult {
+    uint32_t blockSize;
+    uint32_t packets;
+    uint32_t received;     // Packets seen by the remote, summed over the repeats
+    uint64_t bytes;        // Bytes seen by the remote, summed over the repeats
+    uint32_t goodput;      // B/s, mean over the repeats
+    int32_t latency;       // One-way latency (ms): remote first RX - local first TX, ATS synced clocks
+    uint32_t jitter;       // Mean |delta| of the one-way latency between repeats (ms)
+    uint32_t duration;     // Mean local completion time (ms)
+    uint8_t runs;          // Successful repeats
+};
+
+enum BenchState {
+    BENCH_IDLE,
+    BENCH_RUNNING,   // frisbeeDPERF issued, waiting for frisbeeDperfCompleted
+    BENCH_DONE,
+    BENCH_FAILED
+};
+
+// DaaS link qualification harness.
+// Sweeps BENCH_BLOCK_SIZES x BENCH_PACKET_COUNTS against a target DIN with
+// frisbeeDPERF, one run per loop step, and appends the results to
+// BENCH_CSV_FILE tagged with the DaaS library version, so two firmware
+// builds can be compared on the same link.
+// The loopback mode runs against a second, in-process node that stands
+// in for a real peer on 127.0.0.1; it lives only for the sweep.
+// A completion is credited to the run in flight only if its size matches
+// the case; after a timeout the next run waits BENCH_LATE_GRACE_MS, so a
+// late answer is not taken for the next run's.
+class BenchmarkRunner {
+private:
+    DaasAPI* node = nullptr;
+    StorageService* storage = nullptr;
+    const NetworkState* network = nullptr;
+    DaasAPI* loopPeer = nullptr;
+
+    BenchState state = BENCH_IDLE;
+    din_t target = 0;
+    bool loopback = false;
+    bool echoSerial = false;
+    bool dperfHeld = false;      // A one-shot dperf owns the frisbee result slot
+    const char* error = "";
+
+    uint16_t caseIdx = 0;
+    uint8_t repeat = 0;
+    bool completed = false;
+    bool runFailed = false;
+    bool lateGrace = false;      // A run timed out: waiting before the next one
+    unsigned long runStart = 0;
+    int32_t prevLatency = 0;
+
+    BenchResult results[BENCH_CASES];
+    uint32_t changeVersion = 0;
+
+    uint32_t blockOf(uint16_t c) const { return BENCH_BLOCK_SIZES[c / BENCH_PACKET_STEPS]; }
+    uint32_t packetsOf(uint16_t c) const { return BENCH_PACKET_COUNTS[c % BENCH_PACKET_STEPS]; }
+
+    uint32_t runTimeout() const {
+        return BENCH_BASE_TIMEOUT_MS + (blockOf(caseIdx) * packetsOf(caseIdx)) / 1024;
+    }
+
+    bool startLoopbackPeer() {
+        // The main node reaches the peer through its own INET4 driver
+        if (network && !network->get().daasDriver) return false;
+        if (!loopPeer) {
+            loopPeer = new DaasAPI();
+            if (loopPeer->doInit(0x0, BENCH_LOOPBACK_DIN) != ERROR_NONE ||
+                loopPeer->enableDriver(_LINK_INET4, BENCH_LOOPBACK_URI) != ERROR_NONE) {
+                delete loopPeer;
+                loopPeer = nullptr;
+                return false;
+            }
+        }
+        return node->map(BENCH_LOOPBACK_DIN, _LINK_INET4, BENCH_LOOPBACK_URI) == ERROR_NONE;
+    }
+
+    void stopLoopbackPeer() {
+        if (!loopPeer) return;
+        node->remove(BENCH_LOOPBACK_DIN);
+        loopPeer->doEnd();
+        delete loopPeer;
+        loopPeer = nullptr;
+    }
+
+    void fail(const char* why) {
+        stopLoopbackPeer();
+        error = why;
+        state = BENCH_FAILED;
+        changeVersion++;
+        if (echoSerial) Serial.printf("BENCH: failed (%s)\n", why);
+    }
+
+    void startRun() {
+        completed = false;
+        lateGrace = false;
+        runStart = millis();
+        // A failed run is counted as lost: a single bad case must not abort the sweep
+        runFailed = node->frisbeeDPERF(target, packetsOf(caseIdx), blockOf(caseIdx), 0) != ERROR_NONE;
+    }
+
+    void collect() {
+        BenchResult& r = results[caseIdx];
+        dperf_info_result d = node->getFrisbeeResultDPERF();
+
+        if (d.remote_pkt_counter == 0) return;
+
+        uint64_t span = d.remote_last_timestamp - d.remote_first_timestamp;
+        if (span == 0) span = d.local_end_timestamp - d.sender_first_timestamp;
+        uint32_t goodput = span ? (uint32_t)(d.remote_data_counter * 1000 / span) : 0;
+        int32_t latency = (int32_t)((int64_t)d.remote_first_timestamp - (int64_t)d.sender_first_timestamp);
+        uint32_t duration = (uint32_t)(d.local_end_timestamp - d.sender_first_timestamp);
+
+        // Running means over the successful repeats
+        uint8_t n = r.runs;
+        r.goodput = (r.goodput * n + goodput) / (n + 1);
+        r.duration = (r.duration * n + duration) / (n + 1);
+        r.latency = (r.latency * n + latency) / (n + 1);
+        if (n > 0) {
+            uint32_t delta = abs(latency - prevLatency);
+            r.jitter = (r.jitter * (n - 1) + delta) / n;
+        }
+        prevLatency = latency;
+
+        r.received += d.remote_pkt_counter;
+        r.bytes += d.remote_data_counter;
+        r.runs++;
+    }
+
+    void nextRun() {
+        if (++repeat < BENCH_REPEATS) { startRun(); return; }
+
+        repeat = 0;
+        changeVersion++;
+        if (++caseIdx < BENCH_CASES) { startRun(); return; }
+
+        state = BENCH_DONE;
+        stopLoopbackPeer();
+        persist();
+    }
+
+    static constexpr const char* CSV_HEADER =
+        "version,din,block,packets,repeats,runs,received,bytes,goodput_Bps,latency_ms,jitter_ms,duration_ms,loss_pct\n";
+
+    String csvRows() {
+        String out = "";
+        char line[160];
+        for (uint16_t c = 0; c < BENCH_CASES; c++) {
+            const BenchResult& r = results[c];
+            uint32_t sent = r.packets * BENCH_REPEATS;
+            uint32_t lost = r.received < sent ? sent - r.received : 0;
+            uint32_t loss = sent ? (100 * lost) / sent : 0;
+            snprintf(line, sizeof(line), "%s,%llu,%u,%u,%u,%u,%u,%llu,%u,%d,%u,%u,%u\n",
+                     node->getVersion(), (unsigned long long)target,
+                     r.blockSize, r.packets, BENCH_REPEATS, r.runs, r.received,
+                     (unsigned long long)r.bytes, r.goodput, r.latency, r.jitter, r.duration, loss);
+            out += line;
+        }
+        return out;
+    }
+
+    void persist() {
+        String rows = csvRows();
+        if (echoSerial) { Serial.print(CSV_HEADER); Serial.print(rows); }
+
+        // Queued: the card write happens on the storage task
+        storage->append(BENCH_CSV_FILE, rows, CSV_HEADER);
+    }
+
+public:
+    void init(DaasAPI* n, StorageService* s, const NetworkState* net) { node = n; storage = s; network = net; }
+
+    // Starts a sweep against din. With loopback the target is an
+    // in-process stand-in node. echo prints the CSV rows to Serial.
+    bool start(din_t din, bool useLoopback = false, bool echo = false) {
+        if (state == BENCH_RUNNING) return false;
+
+        echoSerial = echo;
+        loopback = useLoopback;
+        target = useLoopback ? BENCH_LOOPBACK_DIN : din;
+        error = "";
+        caseIdx = 0;
+        repeat = 0;
+        for (uint16_t c = 0; c < BENCH_CASES; c++) {
+            results[c] = {blockOf(c), packetsOf(c), 0, 0, 0, 0, 0, 0, 0};
+        }
+
+        // Both would read the node's single DPERF result
+        if (dperfHeld) { fail("dperf pending"); return false; }
+        if (loopback && !startLoopbackPeer()) {
+            fail(network && !network->get().daasDriver ? "no INET4 driver" : "loopback peer");
+            return false;
+        }
+        if (target == 0) { fail("no target"); return false; }
+
+        state = BENCH_RUNNING;
+        changeVersion++;
+        startRun();
+        return true;
+    }
+
+    void stop() {
+        if (state == BENCH_RUNNING) fail("stopped");
+    }
+
+    // A one-shot frisbeeDPERF (console dperf) is pending: no sweep starts
+    // until it completes or times out
+    void holdDperf(bool held) { dperfHeld = held; }
+
+    void update() {
+        // The stand-in peer runs in real-time mode like the main node
+        if (loopPeer) loopPeer->doPerform(PERFORM_CORE_NO_THREAD);
+
+        if (state != BENCH_RUNNING) return;
+
+        if (lateGrace) {
+            if (millis() - runStart > BENCH_LATE_GRACE_MS) nextRun();
+        } else if (completed || runFailed) {
+            if (completed) collect();
+            nextRun();
+        } else if (millis() - runStart > runTimeout()) {
+            // Lost: counted as such, its completion may still show up
+            lateGrace = true;
+            runStart = millis();
+        }
+    }
+
+    // Called from IDaasApiEvent::frisbeeDperfCompleted. Only the run in
+    // flight is credited: stale or foreign completions are dropped.
+    void onCompleted(din_t din, uint32_t packets, uint32_t blockSize) {
+        if (state != BENCH_RUNNING || lateGrace || completed || runFailed) return;
+        // packets_sent may fall short of the request, never exceed it
+        if (din != target || blockSize != blockOf(caseIdx) || packets > packetsOf(caseIdx)) return;
+        completed = true;
+    }
+
+    BenchState getState() const { return state; }
+    const char* getError() const { return error; }
+    din_t getTarget() const { return target; }
+    bool isLoopback() const { return loopback; }
+    uint16_t getCaseIndex() const { return caseIdx; }
+    uint16_t getCaseCount() const { return BENCH_CASES; }
+    const BenchResult& getResult(uint16_t c) const { return results[c]; }
+
+    // Bumped when a case completes or the run state changes
+    uint32_t version() const { return changeVersion; }
+};
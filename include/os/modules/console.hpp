@@ -0,0 +1,120 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+#define CONSOLE_COMMANDS 24
+#define CONSOLE_LINE_MAX 96
+#define CONSOLE_CHARS_PER_LOOP 32   // Input consumed per update, the rest waits in the UART buffer
+#define CONSOLE_JOB_ROOM 128        // TX space a job step may need (bytes)
+
+typedef std::function<void(const String& args, Print& out)> ConsoleHandler;
+
+// A long output (a screenshot) is produced in steps, one per update and
+// only while the TX buffer has room. Returns true when done.
+typedef std::function<bool(Print& out)> ConsoleJob;
+
+// Line i of a listing printed as a job
+typedef std::function<void(uint16_t i, Print& out)> ConsoleLine;
+
+struct ConsoleCommand {
+    const char* name;
+    const char* help;
+    ConsoleHandler handler;
+};
+
+// Line-oriented diagnostic shell on a Stream (Serial). Bytes are taken a
+// few at a time into a fixed line buffer, so update() never waits for
+// input or for a full line; a complete line runs one command.
+class DiagConsole {
+private:
+    Stream* io = nullptr;
+    ConsoleCommand commands[CONSOLE_COMMANDS];
+    uint8_t commandCount = 0;
+
+    char line[CONSOLE_LINE_MAX];
+    uint8_t lineLen = 0;
+    bool overflow = false;   // Line longer than the buffer: dropped whole
+
+    ConsoleJob job;
+
+    void execute() {
+        line[lineLen] = '\0';
+        char* name = line;
+        while (*name == ' ') name++;
+        if (*name == '\0') return;
+
+        char* rest = name;
+        while (*rest && *rest != ' ') rest++;
+        if (*rest) *rest++ = '\0';
+        String args(rest);
+        args.trim();
+
+        if (strcmp(name, "help") == 0) {
+            bool started = startLines(commandCount, [this](uint16_t i, Print& out) {
+                out.printf("  %-10s %s\n", commands[i].name, commands[i].help);
+            });
+            if (!started) io->println("ERR console busy");
+            return;
+        }
+        for (uint8_t i = 0; i < commandCount; i++) {
+            if (strcmp(name, commands[i].name) == 0) {
+                commands[i].handler(args, *io);
+                return;
+            }
+        }
+        io->printf("ERR unknown command '%s' (help)\n", name);
+    }
+
+public:
+    void init(Stream* s) { io = s; }
+
+    bool add(const char* name, const char* help, ConsoleHandler handler) {
+        if (commandCount >= CONSOLE_COMMANDS) return false;
+        commands[commandCount++] = {name, help, handler};
+        return true;
+    }
+
+    // One job at a time; false if another one is still running
+    bool startJob(ConsoleJob j) {
+        if (job) return false;
+        job = j;
+        return true;
+    }
+    // A listing of count lines, one per step: large outputs never wait
+    // for the TX buffer. false if another job is still running.
+    bool startLines(uint16_t count, ConsoleLine line) {
+        if (job) return false;
+        if (count == 0) return true;
+        uint16_t i = 0;
+        job = [i, count, line](Print& out) mutable {
+            line(i, out);
+            return ++i >= count;
+        };
+        return true;
+    }
+
+    bool jobRunning() const { return (bool)job; }
+    void cancelJob() { job = nullptr; }
+
+    void update() {
+        if (!io) return;
+
+        if (job && io->availableForWrite() >= CONSOLE_JOB_ROOM) {
+            if (job(*io)) job = nullptr;
+        }
+
+        for (int n = 0; n < CONSOLE_CHARS_PER_LOOP && io->available() > 0; n++) {
+            char c = io->read();
+            if (c == '\r') continue;
+            if (c != '\n') {
+                if (lineLen < CONSOLE_LINE_MAX - 1) line[lineLen++] = c;
+                else overflow = true;
+                continue;
+            }
+            if (overflow) io->println("ERR line too long");
+            else execute();
+            lineLen = 0;
+            overflow = false;
+        }
+    }
+};
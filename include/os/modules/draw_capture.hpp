@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include "layout.hpp"
+
+#define CAPTURE_FILLS 32   // Solid fills kept as primitives per frame, the rest become dirty area
+#define CAPTURE_RECTS 8    // Dirty rectangles, merged when full
+
+struct CaptureFill {
+    UiRect r;
+    uint16_t color;   // RGB565
+};
+
+// What reached the panel since the last take(): solid fills as primitives
+// and everything else (text, images, copies) as dirty rectangles. Filled
+// in by Panel_CYD on the loop task while enabled.
+class DrawCapture {
+private:
+    static int areaOf(const UiRect& r) { return r.w * r.h; }
+
+    static UiRect unite(const UiRect& a, const UiRect& b) {
+        int x = a.x < b.x ? a.x : b.x;
+        int y = a.y < b.y ? a.y : b.y;
+        int r = a.right() > b.right() ? a.right() : b.right();
+        int bt = a.bottom() > b.bottom() ? a.bottom() : b.bottom();
+        return uiRect(x, y, r - x, bt - y);
+    }
+
+    // Overlapping or touching
+    static bool near(const UiRect& a, const UiRect& b) {
+        return a.x <= b.right() && b.x <= a.right() && a.y <= b.bottom() && b.y <= a.bottom();
+    }
+
+public:
+    bool enabled = false;
+    CaptureFill fills[CAPTURE_FILLS];
+    uint8_t fillCount = 0;
+    UiRect dirty[CAPTURE_RECTS];
+    uint8_t dirtyCount = 0;
+
+    void mark(int x, int y, int w, int h) {
+        if (!enabled || w <= 0 || h <= 0) return;
+        UiRect r = uiRect(x, y, w, h);
+        for (uint8_t i = 0; i < dirtyCount; i++) {
+            if (near(dirty[i], r)) { dirty[i] = unite(dirty[i], r); return; }
+        }
+        if (dirtyCount < CAPTURE_RECTS) { dirty[dirtyCount++] = r; return; }
+
+        // Full: grow the rectangle that grows the least
+        uint8_t best = 0;
+        int bestGrowth = 0x7FFFFFFF;
+        for (uint8_t i = 0; i < dirtyCount; i++) {
+            int growth = areaOf(unite(dirty[i], r)) - areaOf(dirty[i]);
+            if (growth < bestGrowth) { bestGrowth = growth; best = i; }
+        }
+        dirty[best] = unite(dirty[best], r);
+    }
+
+    void fill(int x, int y, int w, int h, uint16_t color) {
+        if (!enabled) return;
+        if (fillCount < CAPTURE_FILLS) fills[fillCount++] = {uiRect(x, y, w, h), color};
+        else mark(x, y, w, h);
+    }
+
+    // The whole screen as one dirty rectangle (a keyframe)
+    void markAll() {
+        fillCount = 0;
+        dirtyCount = 1;
+        dirty[0] = uiRect(0, 0, UI_SCREEN_W, UI_SCREEN_H);
+    }
+
+    bool empty() const { return fillCount == 0 && dirtyCount == 0; }
+
+    // Moves the captured frame to `to` and starts a new one
+    void take(DrawCapture& to) {
+        to.fillCount = fillCount;
+        for (uint8_t i = 0; i < fillCount; i++) to.fills[i] = fills[i];
+        to.dirtyCount = dirtyCount;
+        for (uint8_t i = 0; i < dirtyCount; i++) to.dirty[i] = dirty[i];
+        fillCount = 0;
+        dirtyCount = 0;
+    }
+};
@@ -0,0 +1,204 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "log.hpp"
+
+#define HEAP_TAGS 12                 // Kernel, other tasks, then one per app
+#define HEAP_TAG_KERNEL 0            // Loop task outside any app
+#define HEAP_TAG_TASKS 1             // Storage, log, DaaS, Wi-Fi tasks...
+#define HEAP_MAGIC 0xA110
+#define HEAP_LEAK_CYCLES 3           // Consecutive launch cycles that kept memory: leak suspect
+
+// In front of every block from operator new (8 bytes keeps the alignment of malloc)
+struct HeapBlock {
+    uint32_t size;
+    uint8_t tag;
+    uint8_t pad;
+    uint16_t magic;
+};
+
+struct HeapTagStats {
+    bool used = false;
+    uint8_t appId = 0xFF;
+    const char* name = "";
+    int32_t liveBytes = 0;
+    int32_t liveBlocks = 0;
+    uint32_t allocs = 0;
+    uint32_t frees = 0;
+    int32_t peakBytes = 0;
+
+    // Leak check: live memory when the app came to the front
+    int32_t cycleBytes = 0;
+    int32_t cycleBlocks = 0;
+    uint32_t cycles = 0;
+    int32_t lastKeptBytes = 0;       // Live bytes left over by the last cycle
+    uint8_t growing = 0;             // Consecutive cycles that kept memory
+};
+
+// Heap use per app. operator new/delete (src/heap_tags.cpp) put a small
+// header in front of each block with its size and the tag that was
+// current on the loop task: the foreground app while the kernel runs app
+// code, the kernel otherwise. Other tasks are counted together. Arduino
+// String and plain malloc do not go through operator new and are not
+// counted.
+//
+// Leak check: the live memory of an app is compared between the moment
+// it comes to the front and the moment it leaves; an app that keeps
+// memory over HEAP_LEAK_CYCLES cycles in a row is reported.
+class HeapAccounting {
+private:
+    HeapTagStats tags[HEAP_TAGS];
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    TaskHandle_t loopTask = nullptr;
+    volatile uint8_t current = HEAP_TAG_KERNEL;
+    uint8_t foregroundTag = 0xFF;
+    bool leakCheck = false;
+    uint32_t badFrees = 0;
+
+    uint8_t tagNow() const {
+        if (loopTask && xTaskGetCurrentTaskHandle() != loopTask) return HEAP_TAG_TASKS;
+        return current;
+    }
+
+    // Loop task only. Full table: the kernel is charged.
+    uint8_t tagOf(uint8_t appId, const char* name) {
+        for (uint8_t t = HEAP_TAG_TASKS + 1; t < HEAP_TAGS; t++) {
+            if (!tags[t].used || tags[t].appId != appId) continue;
+            if (name[0] && !tags[t].name[0]) tags[t].name = name;   // Tagged before the app was known
+            return t;
+        }
+        for (uint8_t t = HEAP_TAG_TASKS + 1; t < HEAP_TAGS; t++) {
+            if (tags[t].used) continue;
+            portENTER_CRITICAL(&lock);
+            tags[t].used = true;
+            tags[t].appId = appId;
+            tags[t].name = name;
+            portEXIT_CRITICAL(&lock);
+            return t;
+        }
+        return HEAP_TAG_KERNEL;
+    }
+
+    void closeCycle(HeapTagStats& s) {
+        int32_t kept = s.liveBytes - s.cycleBytes;
+        int32_t keptBlocks = s.liveBlocks - s.cycleBlocks;
+        s.cycles++;
+        s.lastKeptBytes = kept;
+        s.growing = kept > 0 ? s.growing + 1 : 0;
+        if (!leakCheck) return;
+        sysLog(LOG_HEAP_CYCLE, s.name, s.cycles, kept, keptBlocks);
+        if (s.growing >= HEAP_LEAK_CYCLES) sysLog(LOG_HEAP_LEAK, s.name, s.growing, s.liveBytes);
+    }
+
+public:
+    // No allocation here: also used before main
+    static HeapAccounting& get() {
+        static HeapAccounting instance;
+        return instance;
+    }
+
+    // From the loop task: from now on other tasks are counted apart
+    void init() {
+        loopTask = xTaskGetCurrentTaskHandle();
+        tags[HEAP_TAG_KERNEL].used = true;
+        tags[HEAP_TAG_KERNEL].name = "kernel";
+        tags[HEAP_TAG_TASKS].used = true;
+        tags[HEAP_TAG_TASKS].name = "tasks";
+    }
+
+    void* alloc(size_t size) {
+        HeapBlock* b = (HeapBlock*)malloc(sizeof(HeapBlock) + size);
+        if (!b) return nullptr;
+        b->size = size;
+        b->tag = tagNow();
+        b->magic = HEAP_MAGIC;
+        portENTER_CRITICAL(&lock);
+        HeapTagStats& s = tags[b->tag];
+        s.liveBytes += size;
+        s.liveBlocks++;
+        s.allocs++;
+        if (s.liveBytes > s.peakBytes) s.peakBytes = s.liveBytes;
+        portEXIT_CRITICAL(&lock);
+        return b + 1;
+    }
+
+    void release(void* p) {
+        if (!p) return;
+        HeapBlock* b = (HeapBlock*)p - 1;
+        // Double free or a pointer that is not ours: leaked rather than corrupting the heap
+        if (b->magic != HEAP_MAGIC || b->tag >= HEAP_TAGS) { badFrees++; return; }
+        b->magic = 0;
+        portENTER_CRITICAL(&lock);
+        HeapTagStats& s = tags[b->tag];
+        s.liveBytes -= b->size;
+        s.liveBlocks--;
+        s.frees++;
+        portEXIT_CRITICAL(&lock);
+        free(b);
+    }
+
+    // Allocations of the loop task are charged to this app until restore()
+    uint8_t enter(uint8_t appId, const char* name) {
+        uint8_t prev = current;
+        current = tagOf(appId, name);
+        return prev;
+    }
+    void restore(uint8_t tag) { current = tag; }
+
+    // The app now in front: closes the launch cycle of the previous one
+    void foreground(uint8_t appId, const char* name) {
+        uint8_t t = tagOf(appId, name);
+        if (t == foregroundTag) return;
+        if (foregroundTag < HEAP_TAGS && foregroundTag > HEAP_TAG_TASKS) closeCycle(tags[foregroundTag]);
+        foregroundTag = t;
+        if (t == HEAP_TAG_KERNEL) return;
+        tags[t].cycleBytes = tags[t].liveBytes;
+        tags[t].cycleBlocks = tags[t].liveBlocks;
+    }
+
+    void setLeakCheck(bool on) { leakCheck = on; }
+    bool isLeakCheck() const { return leakCheck; }
+
+    void resetPeaks() {
+        portENTER_CRITICAL(&lock);
+        for (auto& s : tags) s.peakBytes = s.liveBytes;
+        portEXIT_CRITICAL(&lock);
+    }
+
+    uint8_t size() const { return HEAP_TAGS; }
+    const HeapTagStats* at(uint8_t i) const { return i < HEAP_TAGS && tags[i].used ? &tags[i] : nullptr; }
+
+    // The app holding the most memory, nullptr if none holds any
+    const HeapTagStats* largestApp() const {
+        const HeapTagStats* best = nullptr;
+        for (uint8_t t = HEAP_TAG_TASKS + 1; t < HEAP_TAGS; t++) {
+            if (tags[t].used && tags[t].liveBytes > 0 && (!best || tags[t].liveBytes > best->liveBytes)) best = &tags[t];
+        }
+        return best;
+    }
+
+    void print(Print& out) const {
+        out.println("tag        live  blocks    peak  allocs   frees  kept/cycle");
+        for (uint8_t t = 0; t < HEAP_TAGS; t++) {
+            const HeapTagStats& s = tags[t];
+            if (!s.used) continue;
+            out.printf("%-8.8s %6ld %7ld %7ld %7lu %7lu", s.name, (long)s.liveBytes, (long)s.liveBlocks, (long)s.peakBytes,
+                       (unsigned long)s.allocs, (unsigned long)s.frees);
+            if (s.cycles) out.printf("  %+ld x%u%s", (long)s.lastKeptBytes, s.growing, s.growing >= HEAP_LEAK_CYCLES ? " LEAK?" : "");
+            out.println();
+        }
+        out.printf("leak check %s, bad frees %lu\n", leakCheck ? "on" : "off", (unsigned long)badFrees);
+    }
+};
+
+// Charges the loop task's allocations to an app for the scope
+class HeapScope {
+private:
+    uint8_t prev;
+
+public:
+    HeapScope(uint8_t appId, const char* name) : prev(HeapAccounting::get().enter(appId, name)) {}
+    ~HeapScope() { HeapAccounting::get().restore(prev); }
+};
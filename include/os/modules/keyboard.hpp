@@ -1,10 +1,67 @@
 #pragma once
 #include "themes/theme_structure.hpp"
+#include "word_predictor.hpp"
+#include "layout.hpp"
 
 const char KEY_LAYOUT_LOWER[] = "qwertyuiopasdfghjklzxcvbnm";
 const char KEY_LAYOUT_UPPER[] = "QWERTYUIOPASDFGHJKLZXCVBNM";
 const char KEY_LAYOUT_NUM[]   = "1234567890-/:;()$&@\".,?!'#"; 
 
+// Key indices: 0..25 are the letter/number keys, then the function row
+#define VK_NONE -1
+#define VK_MODE 26
+#define VK_SHIFT 27
+#define VK_SPACE 28
+#define VK_BACK 29
+#define VK_OK 30
+#define VK_COUNT 31
+
+#define VK_DEBOUNCE_MS 40        // Touch chatter after a release
+#define VK_REPEAT_DELAY_MS 450   // Backspace held this long starts repeating
+#define VK_REPEAT_RATE_MS 70
+#define VK_MAX_LENGTH 30
+
+// --- PORTRAIT LAYOUT ---
+#define VK_GAP 3
+#define VK_SHADOW 3              // Keys sink by this much when pressed
+
+// Letter rows share one grid, each row shifted right to stagger it
+constexpr UiGrid VK_GRID = {4, 150, 21, 38, VK_GAP, VK_GAP, 10};
+constexpr int16_t VK_ROW_KEYS[3] = {10, 9, 7};
+constexpr int16_t VK_ROW_SHIFT[3] = {0, 11, 35};
+
+// Function row: mode, shift, space, backspace, OK
+constexpr int16_t VK_FN_W[5] = {30, 30, 85, 30, 45};
+constexpr UiRow VK_FN_ROW = {VK_GRID.x, VK_GRID.cell(0, 3).y, VK_GRID.cellH, VK_GAP, VK_FN_W};
+
+constexpr int vkRow(int key, int row = 0) {
+    return key < VK_ROW_KEYS[row] ? row : vkRow(key - VK_ROW_KEYS[row], row + 1);
+}
+constexpr int vkCol(int key, int row = 0) {
+    return key < VK_ROW_KEYS[row] ? key : vkCol(key - VK_ROW_KEYS[row], row + 1);
+}
+constexpr UiRect vkKeyRect(int key) {
+    return key >= VK_MODE ? VK_FN_ROW.at(key - VK_MODE)
+                          : uiMove(VK_GRID.cell(vkCol(key), vkRow(key)), VK_ROW_SHIFT[vkRow(key)], 0);
+}
+// Touch target: letters own the gap after them, function keys the gap before
+constexpr UiRect vkHitRect(int key) {
+    return key >= VK_MODE ? uiGrow(vkKeyRect(key), VK_GAP, 0, 0, VK_GAP)
+                          : uiGrow(vkKeyRect(key), 0, 0, VK_GAP, VK_GAP);
+}
+
+constexpr UiRect VK_KEYS[VK_COUNT] = {
+    UI_TABLE_16(vkKeyRect, 0), UI_TABLE_8(vkKeyRect, 16), UI_TABLE_4(vkKeyRect, 24), UI_TABLE_3(vkKeyRect, 28)
+};
+constexpr UiRect VK_KEYS_HIT[VK_COUNT] = {
+    UI_TABLE_16(vkHitRect, 0), UI_TABLE_8(vkHitRect, 16), UI_TABLE_4(vkHitRect, 24), UI_TABLE_3(vkHitRect, 28)
+};
+
+constexpr UiRect VK_INPUT = {5, 65, 231, 29};          // Input line, underlined below
+constexpr UiGrid VK_STRIP_GRID = {4, 104, 74, 34, 4, 0, WORD_SUGGESTIONS};
+constexpr UiRect VK_STRIP[WORD_SUGGESTIONS] = { UI_TABLE_3(VK_STRIP_GRID.at, 0) };
+constexpr UiRect VK_STRIP_AREA = VK_STRIP_GRID.cell(0, 0, WORD_SUGGESTIONS);
+
 class VirtualKeyboard {
 private:
     HardwareManager* hw;
@@ -18,24 +75,32 @@ private:
     bool numActive = false;
     bool needsRedraw = true;
 
-    // --- PORTRAIT DIMENSIONS ---
-    const int KEY_W = 21;  
-    const int KEY_H = 38;  
-    const int GAP = 3;     // Slightly more gap for the shadow
-    const int START_X = 4; 
-    const int START_Y = 150;
+    // Suggestion strip, shown when begin() asks for prediction
+    WordPredictor* predictor = nullptr;
+    bool predict = false;
+    uint32_t stripDrawnVersion = 0;
 
-    const int KEYS_PER_ROW[3] = {10, 9, 7}; 
-    const int ROW_OFFSET_X[3] = {0, 11, 35}; 
+    // Touch state: keys act on the press edge, the highlight lasts until release
+    int pressedKey = VK_NONE;
+    bool layoutDirty = false;       // Shift/numeric changed: the grid needs a repaint
+    unsigned long pressStart = 0;
+    unsigned long lastRepeat = 0;
+    unsigned long lastRelease = 0;
 
 public:
-    void init(HardwareManager* h, ThemePalette* t) { hw = h; theme = t; }
+    void init(HardwareManager* h, ThemePalette* t, WordPredictor* p = nullptr) { hw = h; theme = t; predictor = p; }
 
-    void begin(String title, String initialValue = "") {
+    // withPrediction: suggestion strip above the keys. Leave it off for
+    // passwords, whatever is typed with it on may end up suggested.
+    void begin(String title, String initialValue = "", bool withPrediction = false) {
         prompt = title;
         buffer = initialValue;
         isFinished = false; isCancelled = false;
         shiftActive = false; numActive = false;
+        pressedKey = VK_NONE;
+        layoutDirty = false;
+        predict = withPrediction && predictor != nullptr;
+        if (predict) predictor->clear();
         needsRedraw = true;
     }
 
@@ -49,10 +114,39 @@ public:
     String getResult() { return buffer; }
 
 private:
+    const char* layout() const {
+        return numActive ? KEY_LAYOUT_NUM : (shiftActive ? KEY_LAYOUT_UPPER : KEY_LAYOUT_LOWER);
+    }
+
+    // Start of the word being typed: after the last space
+    int wordStart() const {
+        int start = buffer.lastIndexOf(' ');
+        return start < 0 ? 0 : start + 1;
+    }
+
+    int suggestionAt(int tx, int ty) const {
+        if (!predict) return -1;
+        int i = UI_HIT(VK_STRIP, tx, ty);
+        return i < predictor->count() ? i : -1;
+    }
+
+    // Suggestion as it would be typed: capitalized if the word so far is.
+    // out holds WORD_MAX + 1 chars (room for the strip's ellipsis).
+    void suggestion(int i, char* out) const {
+        strncpy(out, predictor->get(i), WORD_MAX);
+        out[WORD_MAX] = 0;
+        int start = wordStart();
+        if (start < (int)buffer.length() && buffer[start] >= 'A' && buffer[start] <= 'Z' && out[0] >= 'a' && out[0] <= 'z') {
+            out[0] -= 32;
+        }
+    }
+
+    int keyAt(int tx, int ty) const { return UI_HIT(VK_KEYS_HIT, tx, ty); }
+
     // --- 3D BUTTON RENDERER ---
     void drawButton(int x, int y, int w, int h, const char* label, uint16_t bgCol, uint16_t txtCol, bool isSpecial = false) {
         int r = 5; // Radius
-        int shadowOffset = 3;
+        int shadowOffset = VK_SHADOW;
         
         // 1. Draw Shadow (Offset down-right)
         hw->tft.fillRoundRect(x, y + shadowOffset, w, h, r, theme->PANEL_SHADOW);
@@ -71,108 +165,184 @@ private:
         hw->tft.setTextDatum(textdatum_t::top_left);
     }
 
+    // One key, pressed keys sink onto their shadow
+    void drawKey(int key, bool pressed) {
+        const UiRect& k = VK_KEYS[key];
+
+        char keyStr[2] = {0, 0};
+        const char* label = keyStr;
+        uint16_t bg = theme->PANEL_BG;
+        uint16_t fg = theme->TEXT_MAIN;
+        switch (key) {
+            case VK_MODE:  label = numActive ? "Ab" : "12"; fg = theme->TEXT_MUTED; break;
+            case VK_SHIFT: label = "^";
+                            bg = shiftActive ? theme->ACCENT_PRIMARY : theme->PANEL_BG;
+                            fg = shiftActive ? theme->TEXT_MAIN : theme->TEXT_MUTED; break;
+            case VK_SPACE: label = ""; break; // Empty label for clean look
+            case VK_BACK:  label = "<"; bg = theme->ACCENT_ALERT; break;
+            case VK_OK:    label = "OK"; bg = theme->ACCENT_PRIMARY; break;
+            default:        keyStr[0] = layout()[key]; break;
+        }
+
+        hw->tft.fillRect(k.x, k.y, k.w, k.h + VK_SHADOW, theme->BG_COLOR);
+        if (pressed) {
+            uint16_t pressedBg = (bg == theme->PANEL_BG) ? theme->ACCENT_PRIMARY : theme->TEXT_MUTED;
+            hw->tft.fillRoundRect(k.x, k.y + VK_SHADOW, k.w, k.h, 5, pressedBg);
+            hw->tft.setTextColor(theme->TEXT_MAIN, pressedBg);
+            hw->tft.setTextDatum(textdatum_t::middle_center);
+            hw->tft.drawString(label, k.cx(), k.cy() + VK_SHADOW + 1);
+            hw->tft.setTextDatum(textdatum_t::top_left);
+        } else {
+            drawButton(k.x, k.y, k.w, k.h, label, bg, fg, key >= VK_MODE);
+        }
+        // Little icon on spacebar
+        if (key == VK_SPACE) hw->tft.drawFastHLine(k.cx() - 12, k.cy() + (pressed ? VK_SHADOW : 0), 25, theme->TEXT_MUTED);
+    }
+
+    // Whole grid: only on layout changes (shift / numeric)
+    void drawKeys() {
+        for (int k = 0; k < VK_COUNT; k++) drawKey(k, k == pressedKey);
+        layoutDirty = false;
+    }
+
+    // Input line only: the rest of the screen stays as it is
+    void drawInput() {
+        hw->tft.fillRect(VK_INPUT.x, VK_INPUT.y, VK_INPUT.w, VK_INPUT.h, theme->BG_COLOR);
+        hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_left);
+        String displayBuffer = buffer;
+        if(displayBuffer.length() > 18) displayBuffer = "..." + displayBuffer.substring(displayBuffer.length()-18);
+        hw->tft.drawString(displayBuffer + "_", VK_INPUT.x + 5, VK_INPUT.cy());
+        hw->tft.setTextDatum(textdatum_t::top_left);
+    }
+
+    // Redrawn only when the suggestions actually changed
+    void drawStrip() {
+        if (!predict) return;
+        stripDrawnVersion = predictor->version();
+        hw->tft.fillRect(VK_STRIP_AREA.x, VK_STRIP_AREA.y, VK_STRIP_AREA.w, VK_STRIP_AREA.h, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_center);
+        for (int i = 0; i < predictor->count(); i++) {
+            const UiRect& cell = VK_STRIP[i];
+            char label[WORD_MAX + 1];
+            suggestion(i, label);
+            size_t len = strlen(label);
+            if (hw->tft.textWidth(label) > cell.w - 6) {
+                // Shortened in place, the last char kept for the ellipsis
+                label[len] = '.';
+                label[len + 1] = 0;
+                while (len > 1 && hw->tft.textWidth(label) > cell.w - 6) {
+                    label[--len] = '.';
+                    label[len + 1] = 0;
+                }
+            }
+            hw->tft.drawRoundRect(cell.x, cell.y + 4, cell.w, cell.h - 8, 5, theme->BORDER_COLOR);
+            hw->tft.setTextColor(i == 0 ? theme->TEXT_MAIN : theme->TEXT_MUTED, theme->BG_COLOR);
+            hw->tft.drawString(label, cell.cx(), cell.cy());
+        }
+        hw->tft.setTextDatum(textdatum_t::top_left);
+    }
+
+    // Follows the last word: one predictor step per keystroke
+    void syncPrediction() {
+        if (!predict) return;
+        int start = wordStart();
+        predictor->sync(buffer.c_str() + start, buffer.length() - start);
+        if (predictor->version() != stripDrawnVersion) drawStrip();
+    }
+
+    // Replaces the word being typed with suggestion i and a space
+    void acceptSuggestion(int i) {
+        char word[WORD_MAX + 1];
+        suggestion(i, word);
+        String text = buffer.substring(0, wordStart()) + word + " ";
+        if (text.length() > VK_MAX_LENGTH) return;
+        buffer = text;
+        if (shiftActive) { shiftActive = false; drawKeys(); }
+        drawInput();
+        syncPrediction();
+    }
+
     void draw() {
-        // Clear Keyboard Area
-        //hw->tft.fillRect(0, 90, hw->tft.width(), hw->tft.height()-90, theme->BG_COLOR);
         hw->tft.fillScreen(theme->BG_COLOR);
         // --- ELEGANT INPUT BOX ---
         // A clean line with text above it, rather than a box
-        int boxY = 65;
         
         // Label
         hw->tft.setTextColor(theme->ACCENT_PRIMARY, theme->BG_COLOR);
         hw->tft.setTextDatum(textdatum_t::bottom_left);
-        hw->tft.drawString(prompt, 10, boxY - 5);
+        hw->tft.drawString(prompt, VK_INPUT.x + 5, VK_INPUT.y - 5);
         
         // Input Value
-        hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
-        hw->tft.setTextDatum(textdatum_t::middle_left);
-        String displayBuffer = buffer;
-        if(displayBuffer.length() > 18) displayBuffer = "..." + displayBuffer.substring(displayBuffer.length()-18);
-        hw->tft.drawString(displayBuffer + "_", 10, boxY + 15);
+        drawInput();
         
         // Underline (The "Textbox")
-        hw->tft.drawLine(5, boxY + 30, 235, boxY + 30, theme->BORDER_COLOR);
-        hw->tft.drawLine(5, boxY + 31, 235, boxY + 31, theme->PANEL_SHADOW); // Shadow for line
+        hw->tft.drawLine(VK_INPUT.x, VK_INPUT.bottom() + 1, VK_INPUT.right() - 1, VK_INPUT.bottom() + 1, theme->BORDER_COLOR);
+        hw->tft.drawLine(VK_INPUT.x, VK_INPUT.bottom() + 2, VK_INPUT.right() - 1, VK_INPUT.bottom() + 2, theme->PANEL_SHADOW); // Shadow for line
 
-        // --- KEYS ---
-        const char* currentLayout = numActive ? KEY_LAYOUT_NUM : (shiftActive ? KEY_LAYOUT_UPPER : KEY_LAYOUT_LOWER);
-        int charIndex = 0;
-
-        for (int row = 0; row < 3; row++) {
-            int numKeys = KEYS_PER_ROW[row];
-            int xOffset = ROW_OFFSET_X[row];
-            for (int col = 0; col < numKeys; col++) {
-                int x = START_X + xOffset + (col * (KEY_W + GAP));
-                int y = START_Y + (row * (KEY_H + GAP));
-                char keyStr[2] = {currentLayout[charIndex], 0};
-                
-                // Color Logic: Normal keys vs Action keys
-                drawButton(x, y, KEY_W, KEY_H, keyStr, theme->PANEL_BG, theme->TEXT_MAIN);
-                charIndex++;
-            }
+        if (predict) {
+            stripDrawnVersion = predictor->version() - 1; // Full repaint: the strip too
+            syncPrediction();
         }
 
-        // --- FUNCTION ROW ---
-        int yFn = START_Y + (3 * (KEY_H + GAP));
-        int xPos = START_X;
-
-        // Mode Key
-        drawButton(xPos, yFn, 30, KEY_H, numActive ? "Ab" : "12", theme->PANEL_BG, theme->TEXT_MUTED);
-        xPos += 30 + GAP;
-
-        // Shift Key (Active State changes color)
-        uint16_t shiftBg = shiftActive ? theme->ACCENT_PRIMARY : theme->PANEL_BG;
-        uint16_t shiftTxt = shiftActive ? theme->TEXT_MAIN : theme->TEXT_MUTED;
-        drawButton(xPos, yFn, 30, KEY_H, "^", shiftBg, shiftTxt, true);
-        xPos += 30 + GAP;
+        // --- KEYS ---
+        drawKeys();
+    }
 
-        // Space
-        drawButton(xPos, yFn, 85, KEY_H, "", theme->PANEL_BG, theme->TEXT_MAIN); // Empty label for clean look
-        // Little icon on spacebar
-        hw->tft.drawFastHLine(xPos-85-GAP + 30, yFn + KEY_H/2, 25, theme->TEXT_MUTED);
-        xPos += 85 + GAP;
-        
-        // Backspace (Red accent)
-        drawButton(xPos, yFn, 30, KEY_H, "<", theme->ACCENT_ALERT, theme->TEXT_MAIN, true);
-        xPos += 30 + GAP;
-        
-        // OK (Green/Blue accent)
-        drawButton(xPos, yFn, 45, KEY_H, "OK", theme->ACCENT_PRIMARY, theme->TEXT_MAIN, true);
+    // Acts on a key, on the press edge and on typematic repeats
+    void press(int key) {
+        if (key < VK_MODE) {
+            if (buffer.length() < VK_MAX_LENGTH) buffer += layout()[key];
+            if (shiftActive) { shiftActive = false; layoutDirty = true; }
+            drawInput();
+            syncPrediction();
+            return;
+        }
+        switch (key) {
+            case VK_MODE:  numActive = !numActive; shiftActive = false; layoutDirty = true; break;
+            case VK_SHIFT: if (!numActive) { shiftActive = !shiftActive; layoutDirty = true; } break;
+            case VK_SPACE: if (buffer.length() < VK_MAX_LENGTH) { buffer += " "; drawInput(); syncPrediction(); } break;
+            case VK_BACK:  if (buffer.length() > 0) { buffer.remove(buffer.length() - 1); drawInput(); syncPrediction(); } break;
+            case VK_OK:    isFinished = true; break;
+        }
     }
 
     void handleTouch() {
-        if (!hw->isTouching) return;
-        delay(150);
-        
-        int tx = hw->touchX;
-        int ty = hw->touchY;
-        
-        // Simple hit detection (Simplified for brevity, same logic as before)
-        int rowIdx = (ty - START_Y) / (KEY_H + GAP);
-
-        if (rowIdx >= 0 && rowIdx < 3) {
-            int xOffset = ROW_OFFSET_X[rowIdx];
-            if (tx < START_X + xOffset) return;
-            int colIdx = (tx - START_X - xOffset) / (KEY_W + GAP);
-            if (colIdx >= 0 && colIdx < KEYS_PER_ROW[rowIdx]) {
-                int charIndex = 0;
-                for(int r=0; r<rowIdx; r++) charIndex += KEYS_PER_ROW[r];
-                charIndex += colIdx;
-                const char* currentLayout = numActive ? KEY_LAYOUT_NUM : (shiftActive ? KEY_LAYOUT_UPPER : KEY_LAYOUT_LOWER);
-                if (charIndex < 26) { 
-                    if (buffer.length() < 30) buffer += currentLayout[charIndex];
-                    if (shiftActive) { shiftActive = false; }
-                    needsRedraw = true;
-                }
+        unsigned long now = millis();
+
+        if (!hw->isTouching) {
+            if (pressedKey != VK_NONE) {
+                // Release: a layout change repaints the grid once, now
+                int key = pressedKey;
+                pressedKey = VK_NONE;
+                if (layoutDirty) drawKeys();
+                else drawKey(key, false);
+                lastRelease = now;
+            }
+            return;
+        }
+
+        if (pressedKey != VK_NONE) {
+            // Held: backspace repeats, other keys wait for the release
+            if (pressedKey == VK_BACK && now - pressStart >= VK_REPEAT_DELAY_MS && now - lastRepeat >= VK_REPEAT_RATE_MS) {
+                press(VK_BACK);
+                lastRepeat = now;
             }
-        } else if (rowIdx == 3) {
-             // Re-map x coords based on widths in draw()
-            if (tx >= 4 && tx < 34) { numActive = !numActive; shiftActive = false; needsRedraw = true; }
-            else if (tx >= 36 && tx < 66) { if (!numActive) { shiftActive = !shiftActive; needsRedraw = true; } }
-            else if (tx >= 68 && tx < 153) { if (buffer.length() < 30) buffer += " "; needsRedraw = true; }
-            else if (tx >= 155 && tx < 185) { if (buffer.length() > 0) buffer.remove(buffer.length() - 1); needsRedraw = true; }
-            else if (tx >= 187) { isFinished = true; }
+            return;
+        }
+
+        if (!hw->touchPressed || now - lastRelease < VK_DEBOUNCE_MS) return;
+        int pick = suggestionAt(hw->touchX, hw->touchY);
+        if (pick >= 0) {
+            acceptSuggestion(pick);
+            return;
         }
+        int key = keyAt(hw->touchX, hw->touchY);
+        if (key == VK_NONE) return;
+
+        pressedKey = key;
+        pressStart = lastRepeat = now;
+        drawKey(key, true);
+        press(key);
     }
 };
\ No newline at end of file
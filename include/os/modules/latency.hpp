@@ -0,0 +1,158 @@
+#pragma once
+#include <Arduino.h>
+#include "storage.hpp"
+
+#define LATENCY_APPS 8
+#define LATENCY_BUCKETS 24
+#define LATENCY_TIMEOUT_MS 1000     // No pixel written by then: the touch had no visible effect
+#define LATENCY_CSV_FILE "/latency.csv"
+
+// Upper bound of each bucket in ms, about 25% apart past 16 ms
+static const uint16_t LATENCY_EDGES_MS[LATENCY_BUCKETS] = {
+    2, 4, 6, 8, 10, 12, 14, 16, 20, 25, 32, 40,
+    50, 64, 80, 100, 125, 160, 200, 250, 320, 500, 1000, 0xFFFF
+};
+
+struct LatencyHistogram {
+    uint8_t appId = 0xFF;          // 0xFF: free slot
+    const char* name = "";
+    uint32_t samples = 0;
+    uint32_t maxUs = 0;
+    uint16_t buckets[LATENCY_BUCKETS] = {0};
+
+    // Upper bound of the bucket holding the pct-th percentile, in ms
+    uint16_t percentile(uint8_t pct) const {
+        if (samples == 0) return 0;
+        uint32_t rank = (samples * pct + 99) / 100;
+        uint32_t seen = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= rank) return b == LATENCY_BUCKETS - 1 ? maxUs / 1000 : LATENCY_EDGES_MS[b];
+        }
+        return maxUs / 1000;
+    }
+};
+
+// Touch-to-photon latency. The touch sample time is taken in
+// HardwareManager::updateInput, the measurement stays open through app
+// dispatch and closes at the end of the first loop that wrote pixels,
+// after the SPI/DMA transfer has drained. Anything that draws counts as
+// the response, so a toast sliding at the same time can close it early.
+class LatencyTracker {
+private:
+    LatencyHistogram hist[LATENCY_APPS];
+    bool open = false;
+    uint32_t touchUs = 0;
+    uint32_t writesAtTouch = 0;
+    uint8_t touchApp = 0;
+    const char* touchName = "";
+    uint32_t dropped = 0;           // Touches with no draw within LATENCY_TIMEOUT_MS
+    uint32_t changeVersion = 0;
+
+    LatencyHistogram* slot(uint8_t appId, const char* name) {
+        for (auto& h : hist) if (h.appId == appId) return &h;
+        for (auto& h : hist) {
+            if (h.appId != 0xFF) continue;
+            h.appId = appId;
+            h.name = name;
+            return &h;
+        }
+        return nullptr;
+    }
+
+    void record(uint32_t us) {
+        LatencyHistogram* h = slot(touchApp, touchName);
+        if (!h) return;
+        uint32_t ms = us / 1000;
+        int b = 0;
+        while (b < LATENCY_BUCKETS - 1 && ms >= LATENCY_EDGES_MS[b]) b++;
+        if (h->buckets[b] < 0xFFFF) h->buckets[b]++;
+        h->samples++;
+        if (us > h->maxUs) h->maxUs = us;
+        changeVersion++;
+    }
+
+public:
+    // Press edge, with the sample time and the panel write count at that time.
+    // The app is the one the touch is dispatched to.
+    void touch(uint32_t sampleUs, uint32_t panelWrites, uint8_t appId, const char* name) {
+        if (open) dropped++;   // A second tap before the first one showed anything
+        open = true;
+        touchUs = sampleUs;
+        writesAtTouch = panelWrites;
+        touchApp = appId;
+        touchName = name;
+    }
+
+    bool isOpen() const { return open; }
+
+    // End of a kernel loop: true if the caller should wait for the flush and close
+    bool responded(uint32_t panelWrites) const { return open && panelWrites != writesAtTouch; }
+
+    // The pixels are on the panel now
+    void close(uint32_t nowUs) {
+        if (!open) return;
+        open = false;
+        record(nowUs - touchUs);
+    }
+
+    // Touches that never drew anything
+    void expire(uint32_t nowUs) {
+        if (open && nowUs - touchUs > LATENCY_TIMEOUT_MS * 1000UL) {
+            open = false;
+            dropped++;
+            changeVersion++;
+        }
+    }
+
+    void reset() {
+        for (auto& h : hist) h = LatencyHistogram();
+        open = false;
+        dropped = 0;
+        changeVersion++;
+    }
+
+    int size() const {
+        int n = 0;
+        for (const auto& h : hist) if (h.appId != 0xFF) n++;
+        return n;
+    }
+    const LatencyHistogram* get(int i) const {
+        for (const auto& h : hist) {
+            if (h.appId == 0xFF) continue;
+            if (i-- == 0) return &h;
+        }
+        return nullptr;
+    }
+    uint32_t droppedCount() const { return dropped; }
+    uint32_t version() const { return changeVersion; }
+
+    // One machine-readable line per app (parsed by tools/latency_check.py)
+    void print(Print& out) const {
+        for (const auto& h : hist) {
+            if (h.appId == 0xFF) continue;
+            out.printf("LAT app=%u name=%s n=%u p50=%u p95=%u p99=%u max=%u\n", h.appId, h.name, h.samples,
+                       h.percentile(50), h.percentile(95), h.percentile(99), h.maxUs / 1000);
+        }
+        out.printf("LAT dropped=%u\n", dropped);
+    }
+
+    // Summary rows plus the raw buckets, appended to LATENCY_CSV_FILE
+    void exportCsv(StorageService* storage) const {
+        String header = "uptime_s,app,samples,p50_ms,p95_ms,p99_ms,max_ms";
+        for (int b = 0; b < LATENCY_BUCKETS - 1; b++) header += ",lt" + String(LATENCY_EDGES_MS[b]);
+        header += ",rest\n";
+
+        String rows = "";
+        char line[96];
+        for (const auto& h : hist) {
+            if (h.appId == 0xFF) continue;
+            snprintf(line, sizeof(line), "%lu,%s,%u,%u,%u,%u,%u", millis() / 1000, h.name, h.samples,
+                     h.percentile(50), h.percentile(95), h.percentile(99), h.maxUs / 1000);
+            rows += line;
+            for (int b = 0; b < LATENCY_BUCKETS; b++) rows += "," + String(h.buckets[b]);
+            rows += "\n";
+        }
+        if (rows.length() > 0) storage->append(LATENCY_CSV_FILE, rows, header);
+    }
+};
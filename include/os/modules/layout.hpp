@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+
+// Panel size in the rotation set by HardwareManager::init (portrait)
+#define UI_SCREEN_W 240
+#define UI_SCREEN_H 320
+
+// Compile-time layout. Screens describe their geometry once, as constexpr
+// grids and rows of spans, and expand it into static UiRect tables; the
+// renderer and the hit test both read the same table, so what is drawn and
+// what reacts to a touch can never drift apart. Nothing here runs on the
+// device: the tables are built by the compiler and live in flash.
+
+struct UiRect {
+    int16_t x, y, w, h;
+
+    constexpr int right() const { return x + w; }
+    constexpr int bottom() const { return y + h; }
+    constexpr int cx() const { return x + w / 2; }
+    constexpr int cy() const { return y + h / 2; }
+    constexpr bool contains(int px, int py) const { return px >= x && px < x + w && py >= y && py < y + h; }
+};
+
+constexpr UiRect uiRect(int x, int y, int w, int h) {
+    return UiRect{(int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h};
+}
+
+constexpr UiRect uiMove(UiRect r, int dx, int dy) {
+    return uiRect(r.x + dx, r.y + dy, r.w, r.h);
+}
+
+// Grows (or shrinks, negative) each side: touch targets larger than the art
+constexpr UiRect uiGrow(UiRect r, int left, int top, int right, int bottom) {
+    return uiRect(r.x - left, r.y - top, r.w + left + right, r.h + top + bottom);
+}
+
+// Width of each of n equal spans filling total with gap between them
+constexpr int uiSplit(int total, int n, int gap) {
+    return (total - gap * (n - 1)) / n;
+}
+
+// Offset of span i in a row of widths separated by gap
+constexpr int uiSpanOffset(const int16_t* widths, int i, int gap) {
+    return i == 0 ? 0 : uiSpanOffset(widths, i - 1, gap) + widths[i - 1] + gap;
+}
+
+// Equal cells, row-major. A cell may span several columns/rows, gaps included.
+struct UiGrid {
+    int16_t x, y;
+    int16_t cellW, cellH;
+    int16_t gapX, gapY;
+    int16_t cols;
+
+    constexpr UiRect cell(int col, int row, int colSpan = 1, int rowSpan = 1) const {
+        return uiRect(x + col * (cellW + gapX), y + row * (cellH + gapY),
+                      colSpan * cellW + (colSpan - 1) * gapX, rowSpan * cellH + (rowSpan - 1) * gapY);
+    }
+    constexpr UiRect at(int index) const { return cell(index % cols, index / cols); }
+};
+
+// One row of spans with their own widths (function keys, button bars)
+struct UiRow {
+    int16_t x, y, h, gap;
+    const int16_t* widths;
+
+    constexpr UiRect at(int i) const { return uiRect(x + uiSpanOffset(widths, i, gap), y, widths[i], h); }
+};
+
+// Table expansion: UI_TABLE_n(f, base) lists f(base) .. f(base + n - 1)
+#define UI_TABLE_1(f, b) f(b)
+#define UI_TABLE_2(f, b) f(b), f((b) + 1)
+#define UI_TABLE_3(f, b) UI_TABLE_2(f, b), f((b) + 2)
+#define UI_TABLE_4(f, b) UI_TABLE_2(f, b), UI_TABLE_2(f, (b) + 2)
+#define UI_TABLE_5(f, b) UI_TABLE_4(f, b), f((b) + 4)
+#define UI_TABLE_8(f, b) UI_TABLE_4(f, b), UI_TABLE_4(f, (b) + 4)
+#define UI_TABLE_9(f, b) UI_TABLE_8(f, b), f((b) + 8)
+#define UI_TABLE_16(f, b) UI_TABLE_8(f, b), UI_TABLE_8(f, (b) + 8)
+
+// First rect of the table containing the point, -1 if none
+inline int uiHitTest(const UiRect* table, int count, int px, int py) {
+    for (int i = 0; i < count; i++) {
+        if (table[i].contains(px, py)) return i;
+    }
+    return -1;
+}
+
+#define UI_HIT(table, px, py) uiHitTest(table, (int)(sizeof(table) / sizeof((table)[0])), px, py)
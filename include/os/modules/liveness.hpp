@@ -0,0 +1,167 @@
+#pragma once
+#include <Arduino.h>
+#include "daas/daas.hpp"
+#include "node_directory.hpp"
+
+#define LIVENESS_MIN_INTERVAL_MS 5000  // Hot peers, and base of the backoff ladder
+#define LIVENESS_MAX_BACKOFF 6         // Idle peers: 5s << 6 = 320s between probes
+#define LIVENESS_TIMEOUT_MS 3000       // Frisbee without reply after this counts as lost
+#define LIVENESS_MAX_MISSES 3          // Consecutive losses before a peer goes offline
+#define LIVENESS_SCAN_SLOTS 32         // Directory slots visited per update()
+#define LIVENESS_DEFAULT_BUDGET 4      // Probes per second, whole peer table
+
+// Peer presence service.
+// Walks the node directory a few slots per loop and pings peers with
+// frisbee() when their probe is due. Stable peers back off exponentially,
+// peers that stop answering (and hot peers) are probed at the fastest rate.
+// Any traffic from a peer counts as an implicit heartbeat and reschedules
+// its probe. A token bucket caps the total probe rate so the radio load
+// does not grow with the size of the peer table.
+class LivenessMonitor {
+private:
+    NodeDirectory* dir = nullptr;
+    DaasAPI* node = nullptr;
+
+    uint16_t cursor = 0;
+    uint16_t budget = LIVENESS_DEFAULT_BUDGET;
+    uint32_t tokens = 0;        // In 1/1000 of a probe
+    unsigned long lastRefill = 0;
+
+    uint32_t probesSent = 0;
+    uint32_t probesLost = 0;
+
+    uint32_t interval(const NodeRecord& rec) const {
+        if (rec.state & NODE_HOT) return LIVENESS_MIN_INTERVAL_MS;
+        return (uint32_t)LIVENESS_MIN_INTERVAL_MS << rec.backoff;
+    }
+
+    void setOnline(NodeRecord& rec, bool online) {
+        bool was = rec.state & NODE_ONLINE;
+        if (was == online) return;
+        if (online) rec.state |= NODE_ONLINE;
+        else rec.state &= ~NODE_ONLINE;
+        dir->notifyUpdated(rec.din);
+    }
+
+    void alive(NodeRecord& rec, unsigned long now) {
+        rec.state &= ~NODE_PROBING;
+        rec.misses = 0;
+        rec.loss -= rec.loss / 8;
+        if (rec.backoff < LIVENESS_MAX_BACKOFF) rec.backoff++;
+        schedule(rec, now + interval(rec));
+        setOnline(rec, true);
+    }
+
+    void lost(NodeRecord& rec, unsigned long now) {
+        rec.state &= ~NODE_PROBING;
+        rec.loss += (255 - rec.loss) / 8;
+        if (rec.misses < 255) rec.misses++;
+        probesLost++;
+
+        if (rec.misses >= LIVENESS_MAX_MISSES) {
+            // Gone: stop hammering it, the slow ladder will notice a comeback
+            rec.backoff = LIVENESS_MAX_BACKOFF;
+            setOnline(rec, false);
+        } else {
+            // Recently silent: re-probe at the fastest rate
+            rec.backoff = 0;
+        }
+        schedule(rec, now + interval(rec));
+    }
+
+    // millis() wraps: any value of probeAt, 0 included, is a valid time
+    static void schedule(NodeRecord& rec, uint32_t at) {
+        rec.probeAt = at;
+        rec.state |= NODE_SCHEDULED;
+    }
+
+    void refill(unsigned long now) {
+        uint32_t cap = budget * 1000;
+        tokens += (now - lastRefill) * budget;
+        if (tokens > cap) tokens = cap;
+        lastRefill = now;
+    }
+
+public:
+    void init(NodeDirectory* d, DaasAPI* n) {
+        dir = d;
+        node = n;
+        lastRefill = millis();
+    }
+
+    // Max probes per second across all peers
+    void setBudget(uint16_t probesPerSecond) { budget = probesPerSecond; }
+
+    void update() {
+        if (!dir) return;
+        unsigned long now = millis();
+        refill(now);
+
+        for (uint16_t n = 0; n < LIVENESS_SCAN_SLOTS; n++) {
+            NodeRecord* rec = dir->slotAt(cursor++);
+            if (!rec) continue;
+
+            if (!(rec->state & NODE_SCHEDULED)) {
+                schedule(*rec, now + interval(*rec));
+                continue;
+            }
+
+            if (rec->state & NODE_PROBING) {
+                if (now - rec->probeAt > LIVENESS_TIMEOUT_MS) lost(*rec, now);
+                continue;
+            }
+
+            if ((long)(now - rec->probeAt) < 0 || tokens < 1000) continue;
+
+            tokens -= 1000;
+            probesSent++;
+            if (node->frisbee(rec->din) == ERROR_NONE) {
+                rec->state |= NODE_PROBING;
+                rec->probeAt = now;
+            } else {
+                lost(*rec, now);
+            }
+        }
+    }
+
+    // Frisbee answer: closes the in-flight probe and samples the RTT
+    void onReply(din_t din) {
+        NodeRecord* rec = dir ? dir->find(din) : nullptr;
+        if (!rec) return;
+
+        unsigned long now = millis();
+        if (rec->state & NODE_PROBING) {
+            uint32_t sample = now - rec->probeAt;
+            if (sample > 0xFFFE) sample = 0xFFFE;
+            if (rec->rtt == NODE_RTT_UNKNOWN) rec->rtt = sample;
+            else rec->rtt = (int32_t)rec->rtt + ((int32_t)sample - (int32_t)rec->rtt) / 8;
+        }
+        alive(*rec, now);
+    }
+
+    // Any other traffic from the peer (DDO, ATS sync...) proves it is alive
+    void heartbeat(din_t din) {
+        NodeRecord* rec = dir ? dir->find(din) : nullptr;
+        if (rec) alive(*rec, millis());
+    }
+
+    // Hot peers (e.g. the open chat) are probed at the fastest rate
+    void setActive(din_t din, bool active) {
+        NodeRecord* rec = dir ? dir->find(din) : nullptr;
+        if (!rec) return;
+        if (active) {
+            rec->state |= NODE_HOT;
+            if (!(rec->state & NODE_PROBING)) schedule(*rec, millis());
+        } else {
+            rec->state &= ~NODE_HOT;
+        }
+    }
+
+    bool isOnline(din_t din) const {
+        const NodeRecord* rec = dir ? dir->find(din) : nullptr;
+        return rec && (rec->state & NODE_ONLINE);
+    }
+
+    uint32_t getProbesSent() const { return probesSent; }
+    uint32_t getProbesLost() const { return probesLost; }
+};
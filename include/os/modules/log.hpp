@@ -0,0 +1,333 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "log_formats.hpp"
+
+#define LOG_SLOTS 128               // Power of two, 4 KB of records
+#define LOG_PAYLOAD 24              // Argument bytes per record
+#define LOG_RATE_WINDOW_MS 1000
+#define LOG_RATE_BURST 8            // Records per format per window, the rest are counted
+#define LOG_DRAIN_MS 50
+#define LOG_FILE_BATCH 1024         // Binary bytes handed to the file sink at once
+#define LOG_FILE_FLUSH_MS 2000
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY 1
+#define LOG_TASK_CORE 0
+#define LOG_LINE_MAX 160
+
+enum LogLevel : uint8_t {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+};
+
+#define LOG_ENUM(id, level, fmt) id,
+enum LogFormat : uint16_t {
+    LOG_CATALOG(LOG_ENUM)
+    LOG_FORMAT_COUNT
+};
+#undef LOG_ENUM
+
+struct LogFormatInfo {
+    LogLevel level;
+    const char* fmt;
+};
+
+#define LOG_INFO_ENTRY(id, level, fmt) {level, fmt},
+static const LogFormatInfo LOG_FORMATS[LOG_FORMAT_COUNT] = {
+    LOG_CATALOG(LOG_INFO_ENTRY)
+};
+#undef LOG_INFO_ENTRY
+
+// FNV-1a of every format, seeded by its id: logged at boot so the decoder
+// can tell that a log matches its copy of the catalog
+constexpr uint32_t logHash(const char* s, uint32_t h) {
+    return *s ? logHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+#define LOG_HASH_ENTRY(id, level, fmt) ^ logHash(fmt, 2166136261u + id)
+constexpr uint32_t LOG_CATALOG_HASH = 0u LOG_CATALOG(LOG_HASH_ENTRY);
+#undef LOG_HASH_ENTRY
+
+// Fixed-size record, written as is to the binary log file
+struct LogRecord {
+    uint32_t ms;
+    uint16_t id;
+    uint8_t level;
+    uint8_t len;                    // Payload bytes used
+    uint8_t payload[LOG_PAYLOAD];   // uint32 LE per number, length byte + chars per string
+};
+static_assert(sizeof(LogRecord) == 32, "decode_log.py reads 32-byte records");
+
+typedef std::function<void(const uint8_t* bytes, size_t len)> LogFileSink;
+
+// Deferred logging. A call copies the format id and the raw arguments
+// into a lock-free ring (bounded MPMC, one CAS per record) and returns;
+// nothing is formatted and nothing waits on the UART. A low-priority task
+// drains the ring: text to Serial, raw records to the file sink, decoded
+// later by tools/decode_log.py. Records below the level are discarded at
+// the call site, and each format may burst LOG_RATE_BURST records per
+// window before the rest are only counted. When the ring is full the
+// record is dropped and counted, the caller never blocks.
+class Logger {
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        LogRecord rec;
+    };
+    Slot ring[LOG_SLOTS];
+    std::atomic<uint32_t> head{0};
+    uint32_t tail = 0;               // Drain task only
+    std::atomic<uint32_t> dropped{0};   // Since the last drain
+    uint32_t droppedTotal = 0;
+
+    // Rate limit state. Updated without a lock: a race only lets a record
+    // more or less through
+    uint32_t windowStart[LOG_FORMAT_COUNT] = {0};
+    uint16_t windowCount[LOG_FORMAT_COUNT] = {0};
+    uint16_t suppressed[LOG_FORMAT_COUNT] = {0};
+
+    volatile LogLevel threshold = LOG_LEVEL_INFO;
+    volatile bool serialSink = true;
+    volatile bool fileEnabled = true;
+    LogFileSink fileSink;
+    TaskHandle_t task = nullptr;
+
+    std::vector<uint8_t> fileBatch;
+    unsigned long lastFileFlush = 0;
+
+    Logger() {
+        for (uint32_t i = 0; i < LOG_SLOTS; i++) ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // --- Argument packing ---
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    put(LogRecord& r, T v) {
+        if (r.len + 4 > LOG_PAYLOAD) return;
+        uint32_t u = (uint32_t)v;
+        memcpy(r.payload + r.len, &u, 4);
+        r.len += 4;
+    }
+
+    static void put(LogRecord& r, const char* s) {
+        if (r.len >= LOG_PAYLOAD) return;
+        size_t n = s ? strlen(s) : 0;
+        size_t room = LOG_PAYLOAD - r.len - 1;
+        if (n > room) n = room;   // Truncated, never split across records
+        r.payload[r.len++] = (uint8_t)n;
+        memcpy(r.payload + r.len, s, n);
+        r.len += n;
+    }
+
+    static void put(LogRecord& r, const String& s) { put(r, s.c_str()); }
+
+    static void pack(LogRecord&) {}
+
+    template <typename T, typename... Rest>
+    static void pack(LogRecord& r, T first, Rest... rest) {
+        put(r, first);
+        pack(r, rest...);
+    }
+
+    // --- Ring ---
+
+    bool push(const LogRecord& r) {
+        uint32_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& s = ring[pos & (LOG_SLOTS - 1)];
+            int32_t diff = (int32_t)(s.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    s.rec = r;
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(LogRecord& r) {
+        Slot& s = ring[tail & (LOG_SLOTS - 1)];
+        if ((int32_t)(s.seq.load(std::memory_order_acquire) - (tail + 1)) < 0) return false;
+        r = s.rec;
+        s.seq.store(tail + LOG_SLOTS, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+    // False when the format is over its rate. The first record after a
+    // suppressed burst is preceded by the count.
+    bool admit(LogFormat id, uint32_t now) {
+        if (now - windowStart[id] >= LOG_RATE_WINDOW_MS) {
+            windowStart[id] = now;
+            windowCount[id] = 0;
+            if (suppressed[id]) {
+                uint16_t n = suppressed[id];
+                suppressed[id] = 0;
+                log(LOG_SUPPRESSED, n, (uint32_t)id);
+            }
+        }
+        if (windowCount[id] < LOG_RATE_BURST) {
+            windowCount[id]++;
+            return true;
+        }
+        if (suppressed[id] < 0xFFFF) suppressed[id]++;
+        return false;
+    }
+
+    // --- Drain (log task) ---
+
+    static const uint8_t* takeU32(const uint8_t* p, const uint8_t* end, uint32_t* v) {
+        *v = 0;
+        if (p + 4 > end) return end;
+        memcpy(v, p, 4);
+        return p + 4;
+    }
+
+    // Expands the format with the packed arguments, same rules as decode_log.py
+    static void format(const LogRecord& r, char* out, size_t size) {
+        static const char LEVELS[] = "DIWE";
+        int n = snprintf(out, size, "[%6lu.%03lu] %c ", (unsigned long)(r.ms / 1000), (unsigned long)(r.ms % 1000),
+                         LEVELS[r.level & 3]);
+        size_t at = n > 0 ? n : 0;
+        const char* f = r.id < LOG_FORMAT_COUNT ? LOG_FORMATS[r.id].fmt : "LOG: unknown format";
+        const uint8_t* p = r.payload;
+        const uint8_t* end = r.payload + r.len;
+
+        while (*f && at + 1 < size) {
+            if (*f != '%') { out[at++] = *f++; continue; }
+            if (f[1] == '%') { out[at++] = '%'; f += 2; continue; }
+
+            // One conversion: flags/width/precision kept, length modifiers dropped
+            char spec[16];
+            size_t k = 0;
+            spec[k++] = *f++;
+            while (*f && strchr("-+ #0123456789.", *f) && k < sizeof(spec) - 3) spec[k++] = *f++;
+            while (*f && strchr("hlzjt", *f)) f++;
+            char conv = *f ? *f++ : 'd';
+            spec[k++] = conv;
+            spec[k] = '\0';
+
+            int w;
+            if (conv == 's') {
+                char text[LOG_PAYLOAD];
+                uint8_t len = p < end ? *p++ : 0;
+                if (p + len > end) len = end - p;
+                memcpy(text, p, len);
+                text[len] = '\0';
+                p += len;
+                w = snprintf(out + at, size - at, spec, text);
+            } else {
+                uint32_t v;
+                p = takeU32(p, end, &v);
+                if (conv == 'd' || conv == 'i') w = snprintf(out + at, size - at, spec, (int)v);
+                else w = snprintf(out + at, size - at, spec, (unsigned)v);
+            }
+            if (w > 0) at += (size_t)w < size - at ? w : size - at - 1;
+        }
+        out[at] = '\0';
+    }
+
+    void drain() {
+        LogRecord r;
+        char line[LOG_LINE_MAX];
+
+        uint32_t lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost) {
+            droppedTotal += lost;
+            log(LOG_DROPPED, lost);
+        }
+
+        while (pop(r)) {
+            if (serialSink) {
+                format(r, line, sizeof(line));
+                Serial.println(line);
+            }
+            if (fileSink && fileEnabled) {
+                const uint8_t* bytes = (const uint8_t*)&r;
+                fileBatch.insert(fileBatch.end(), bytes, bytes + sizeof(r));
+            }
+        }
+
+        if (!fileSink || fileBatch.empty()) return;
+        if (fileBatch.size() >= LOG_FILE_BATCH || millis() - lastFileFlush >= LOG_FILE_FLUSH_MS) {
+            fileSink(fileBatch.data(), fileBatch.size());
+            fileBatch.clear();
+            lastFileFlush = millis();
+        }
+    }
+
+    static void taskEntry(void* arg) {
+        Logger* self = (Logger*)arg;
+        for (;;) {
+            self->drain();
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+        }
+    }
+
+public:
+    static Logger* getInstance() {
+        static Logger* instance = nullptr;
+        if (instance == nullptr) {
+            instance = new Logger();
+        }
+        return instance;
+    }
+
+    // Starts the drain task. Records logged before (boot) wait in the ring.
+    bool begin() {
+        if (task) return true;
+        log(LOG_BOOT, LOG_CATALOG_HASH);
+        fileBatch.reserve(LOG_FILE_BATCH + sizeof(LogRecord));
+        return xTaskCreatePinnedToCore(taskEntry, "log", LOG_TASK_STACK, this, LOG_TASK_PRIORITY, &task,
+                                       LOG_TASK_CORE) == pdPASS;
+    }
+
+    template <typename... Args>
+    void log(LogFormat id, Args... args) {
+        if (LOG_FORMATS[id].level < threshold) return;
+        uint32_t now = millis();
+        if (!admit(id, now)) return;
+
+        LogRecord r;
+        r.ms = now;
+        r.id = id;
+        r.level = LOG_FORMATS[id].level;
+        r.len = 0;
+        pack(r, args...);
+        push(r);
+    }
+
+    void setLevel(LogLevel level) { threshold = level; }
+    LogLevel getLevel() const { return threshold; }
+    void setSerial(bool on) { serialSink = on; }
+    bool isSerial() const { return serialSink; }
+
+    // Set before begin(): the sink is called from the log task
+    void setFileSink(LogFileSink sink) { fileSink = sink; }
+    void setFile(bool on) { fileEnabled = on; }
+    bool isFile() const { return fileEnabled && fileSink; }
+
+    uint32_t pending() const { return head.load(std::memory_order_relaxed) - tail; }
+    uint32_t droppedCount() const { return droppedTotal + dropped.load(std::memory_order_relaxed); }
+};
+
+// Shorthand for the hot paths
+template <typename... Args>
+inline void sysLog(LogFormat id, Args... args) {
+    Logger::getInstance()->log(id, args...);
+}
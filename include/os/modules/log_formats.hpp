@@ -0,0 +1,38 @@
+#pragma once
+
+// Catalog of every log message: id, severity, printf format.
+// Records carry the position in this list, not the text, so entries are
+// only ever appended: tools/decode_log.py reads this file to expand the
+// binary logs. LOG_BOOT stays first and at error level, so no filter drops
+// it: it carries the catalog hash and lets the decoder skip boots logged
+// with a different catalog.
+// Arguments are 32-bit integers (%d %i %u %x %X %c) or strings (%s).
+#define LOG_CATALOG(X) \
+    X(LOG_BOOT,               LOG_LEVEL_ERROR, "LOG: boot, catalog %08x") \
+    X(LOG_SUPPRESSED,         LOG_LEVEL_WARN,  "LOG: %u messages of format %u suppressed") \
+    X(LOG_DROPPED,            LOG_LEVEL_WARN,  "LOG: ring full, %u messages dropped") \
+    X(LOG_SD_MOUNTED,         LOG_LEVEL_INFO,  "SYSTEM: SD Card Mounted") \
+    X(LOG_SD_MISSING,         LOG_LEVEL_WARN,  "SYSTEM: SD Card Missing or Fail - Files Kept In Flash") \
+    X(LOG_WIFI_UP,            LOG_LEVEL_INFO,  "SYSTEM: Wi-Fi up in %u ms (%s)") \
+    X(LOG_FLASH_MOUNTED,      LOG_LEVEL_INFO,  "SYSTEM: Flash tier mounted (%u files to sync)") \
+    X(LOG_FLASH_MISSING,      LOG_LEVEL_WARN,  "SYSTEM: Flash tier unavailable") \
+    X(LOG_FLASH_STALE,        LOG_LEVEL_INFO,  "SYSTEM: %u flash copies older than SD, re-promoting") \
+    X(LOG_SD_ERRORS,          LOG_LEVEL_ERROR, "SYSTEM: SD errors, writing to flash") \
+    X(LOG_DAAS_DRIVER,        LOG_LEVEL_INFO,  "SYSTEM: DaaS INET4 driver on %s %s") \
+    X(LOG_ASSETS_MAPPED,      LOG_LEVEL_INFO,  "SYSTEM: Asset pack mapped (%u assets)") \
+    X(LOG_ASSETS_MISSING,     LOG_LEVEL_WARN,  "SYSTEM: No asset pack, using built-in graphics") \
+    X(LOG_FONTS_MISSING,      LOG_LEVEL_WARN,  "SYSTEM: Packed fonts missing, using built-in fonts") \
+    X(LOG_LEXICON_MISSING,    LOG_LEVEL_WARN,  "SYSTEM: No lexicon, suggesting learned words only") \
+    X(LOG_APP_NOT_REGISTERED, LOG_LEVEL_ERROR, "TaskManager: System app with ID %d not registered.") \
+    X(LOG_APP_EVICTED,        LOG_LEVEL_WARN,  "TaskManager: Max apps reached, closing oldest app.") \
+    X(LOG_APP_OPEN,           LOG_LEVEL_DEBUG, "TaskManager: app %u started") \
+    X(LOG_HOME_LAUNCH,        LOG_LEVEL_INFO,  "Launching: %s") \
+    X(LOG_HOME_FILES,         LOG_LEVEL_INFO,  "Launch File Browser") \
+    X(LOG_SHOT_SAVED,         LOG_LEVEL_INFO,  "SHOT: %s saved") \
+    X(LOG_SHOT_FAILED,        LOG_LEVEL_ERROR, "SHOT: %s failed") \
+    X(LOG_WD_OVERRUN,         LOG_LEVEL_WARN,  "WD: %s overran the %s phase: %lu ms, budget %lu ms") \
+    X(LOG_HEAP_CYCLE,         LOG_LEVEL_INFO,  "HEAP: %s cycle %lu kept %ld bytes in %ld blocks") \
+    X(LOG_HEAP_LEAK,          LOG_LEVEL_WARN,  "HEAP: %s kept memory %u cycles in a row, %ld bytes live") \
+    X(LOG_APP_BG_DRAW,        LOG_LEVEL_WARN,  "TaskManager: %s drew off screen, %lu panel writes dropped") \
+    X(LOG_FLASH_FORMATTED,    LOG_LEVEL_WARN,  "SYSTEM: Flash tier formatted (new or resized partition)") \
+    X(LOG_FLASH_TAIL_DROPPED, LOG_LEVEL_WARN,  "SYSTEM: %s over the flash cap without a card, %lu bytes dropped")
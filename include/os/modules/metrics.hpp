@@ -0,0 +1,158 @@
+#pragma once
+#include <Arduino.h>
+#include "hal/hal.hpp"
+#include "daas/daas.hpp"
+#include "network_state.hpp"
+
+#define METRICS_HISTORY 72              // Samples kept per series (one sparkline column each)
+#define METRICS_DEFAULT_INTERVAL_MS 1000
+
+enum MetricId {
+    // One series per syscode_t, same order
+    MET_DME_SENT = 0,
+    MET_DME_RECEIVED,
+    MET_DME_ROUTED,
+    MET_RX_BUFFER,
+    MET_TX_BUFFER,
+    MET_ATS_DELTA_AVG,
+    MET_ATS_SYNC,
+    MET_ATS_DECODED,
+    MET_ATS_ENCODED,
+    // Platform
+    MET_HEAP_FREE,
+    MET_HEAP_MAX_BLOCK,
+    MET_LOOP_RATE,
+    MET_WIFI_RSSI,
+    MET_WIFI_CONNECT_MS,
+
+    METRIC_COUNT
+};
+
+struct MetricInfo {
+    const char* label;
+    bool counter;     // Monotonic total: plot and show its per-second rate
+    int32_t offset;   // Added before storing (keeps signed gauges positive)
+};
+
+static const MetricInfo METRIC_INFO[METRIC_COUNT] = {
+    {"Sent",     true,  0},
+    {"Recv",     true,  0},
+    {"Routed",   true,  0},
+    {"RX buf",   false, 0},
+    {"TX buf",   false, 0},
+    {"ATS dlt",  false, 0},
+    {"ATS syn",  true,  0},
+    {"ATS dec",  true,  0},
+    {"ATS enc",  true,  0},
+    {"Heap",     false, 0},
+    {"MaxBlk",   false, 0},
+    {"Loop/s",   false, 0},
+    {"RSSI",     false, 100},
+    {"WiFi ms",  false, 0},
+};
+
+// Fixed-size time series of every syscode_t counter plus heap, loop rate,
+// Wi-Fi signal and time-to-IP. One sample of every series is taken each
+// interval into per-series rings; readers address samples by age and use
+// sampleCount() to draw only what is new since their last frame.
+class MetricsSampler {
+private:
+    DaasAPI* node = nullptr;
+    HardwareManager* hw = nullptr;
+    NetworkState* net = nullptr;
+
+    uint32_t samples[METRIC_COUNT][METRICS_HISTORY];
+    uint32_t stamps[METRICS_HISTORY];   // millis() of each sample: rates use the real spacing
+    uint16_t head = 0;          // Slot of the latest sample
+    uint16_t filled = 0;
+    uint32_t count = 0;
+
+    uint32_t interval = METRICS_DEFAULT_INTERVAL_MS;
+    unsigned long lastSample = 0;
+    uint32_t loops = 0;
+
+    uint32_t read(MetricId id, uint32_t elapsed) {
+        switch (id) {
+            case MET_HEAP_FREE:       return ESP.getFreeHeap();
+            case MET_HEAP_MAX_BLOCK:  return ESP.getMaxAllocHeap();
+            case MET_LOOP_RATE:       return elapsed ? (uint64_t)loops * 1000 / elapsed : 0;
+            case MET_WIFI_RSSI: {
+                if (!net->get().wifiUp) return 0;
+                // Clamped to the offset: a weaker reading would wrap the unsigned sample
+                int32_t rssi = net->get().rssi;
+                if (rssi < -METRIC_INFO[id].offset) rssi = -METRIC_INFO[id].offset;
+                if (rssi > 0) rssi = 0;
+                return rssi + METRIC_INFO[id].offset;
+            }
+            case MET_WIFI_CONNECT_MS: return hw->wifiTimeToIP;
+            default:                  return (uint32_t)node->getSystemStatistics((syscode_t)(id + 1));
+        }
+    }
+
+public:
+    void init(DaasAPI* n, HardwareManager* h, NetworkState* ns) {
+        node = n;
+        hw = h;
+        net = ns;
+        memset(samples, 0, sizeof(samples));
+        memset(stamps, 0, sizeof(stamps));
+        lastSample = millis();
+    }
+
+    void setInterval(uint32_t ms) { interval = ms; }
+    uint32_t getInterval() const { return interval; }
+
+    // Once per kernel loop
+    void loopTick() { loops++; }
+
+    void update() {
+        unsigned long now = millis();
+        uint32_t elapsed = now - lastSample;
+        if (elapsed < interval) return;
+
+        head = (head + 1) % METRICS_HISTORY;
+        for (int id = 0; id < METRIC_COUNT; id++) {
+            samples[id][head] = read((MetricId)id, elapsed);
+        }
+        stamps[head] = now;
+        if (filled < METRICS_HISTORY) filled++;
+        count++;
+
+        loops = 0;
+        lastSample = now;
+    }
+
+    // Stored value, age 0 = latest
+    uint32_t at(MetricId id, uint16_t age) const {
+        if (age >= filled) return 0;
+        return samples[id][(head + METRICS_HISTORY - age) % METRICS_HISTORY];
+    }
+
+    // Gauge value, or per-second rate for counters, as it should be plotted.
+    // Rates divide by the time actually elapsed between the two samples:
+    // a slow loop stretches the interval.
+    uint32_t plotAt(MetricId id, uint16_t age) const {
+        if (!METRIC_INFO[id].counter) return at(id, age);
+        if (age + 1 >= filled) return 0;
+        uint32_t cur = at(id, age), prev = at(id, age + 1);
+        uint32_t span = stampAt(age) - stampAt(age + 1);
+        // Counter reset (doStatisticsReset): restart from zero
+        return cur >= prev && span ? (uint64_t)(cur - prev) * 1000 / span : 0;
+    }
+
+    // millis() the sample was taken at, age 0 = latest
+    uint32_t stampAt(uint16_t age) const {
+        if (age >= filled) return 0;
+        return stamps[(head + METRICS_HISTORY - age) % METRICS_HISTORY];
+    }
+
+    // Human value: gauges without their storage offset
+    int32_t valueAt(MetricId id, uint16_t age) const {
+        return (int32_t)at(id, age) - METRIC_INFO[id].offset;
+    }
+
+    uint16_t available() const { return filled; }
+
+    // Total samples taken so far (monotonic)
+    uint32_t sampleCount() const { return count; }
+};
@@ -0,0 +1,305 @@
+#pragma once
+#include <Arduino.h>
+#include "hal/hal.hpp"
+#include "daas/daas.hpp"
+#include "draw_capture.hpp"
+
+#define MIRROR_TYPESET 0x4D52          // DDO typeset of mirror packets ("MR")
+#define MIRROR_SYNC0 0xA5
+#define MIRROR_SYNC1 0x5A
+#define MIRROR_PAYLOAD_MAX 232
+#define MIRROR_PACKET_MAX (MIRROR_PAYLOAD_MAX + 6)
+#define MIRROR_SPAN 112                // Pixels read back per readRect
+#define MIRROR_DEFAULT_FPS 5
+#define MIRROR_SERIAL_BPS 8000         // Leaves part of 115200 baud to the console and the log
+#define MIRROR_DDO_BPS 60000
+#define MIRROR_DDO_BATCH 1024          // Packets are sent in DDOs of up to this many bytes
+#define MIRROR_LOOP_SHARE_PCT 10       // Share of wall time the mirror may use
+#define MIRROR_CREDIT_MAX_US 3000      // Longest single mirror step
+
+enum MirrorPacket : uint8_t {
+    MIR_FRAME = 1,    // seq, screen w, h (u16)
+    MIR_FILLS = 2,    // n x (x, y, w, h, RGB565) (u16)
+    MIR_PIXELS = 3,   // rect x, y, w, h (u16), first pixel index (u32), PackBits runs
+    MIR_END = 4       // seq (u16), frame bytes (u32)
+};
+
+enum MirrorTransport : uint8_t {
+    MIRROR_OFF,
+    MIRROR_SERIAL,
+    MIRROR_DDO
+};
+
+// Remote screen. The panel records what it is asked to draw (DrawCapture);
+// at most `fps` times per second the captured frame is sent: solid fills as
+// primitives, everything else as the dirty rectangles read back from the
+// panel and PackBits-compressed. Packets go to Serial, between console
+// lines, or in DDOs on MIRROR_TYPESET; tools/mirror_view.py shows them.
+// Sending is paced by a byte budget and by a time budget: the mirror gets
+// MIRROR_LOOP_SHARE_PCT of the wall time, so a frame that does not fit is
+// spread over later loops while the UI keeps its rate.
+//
+// Wire format: A5 5A, type, payload length (u16), payload, XOR of type,
+// length and payload. Little endian; PackBits header h: h < 128 is a
+// literal of h + 1 pixels, h >= 128 a run of h - 127 copies of one pixel.
+class ScreenMirror {
+private:
+    HardwareManager* hw = nullptr;
+    DaasAPI* node = nullptr;
+
+    MirrorTransport transport = MIRROR_OFF;
+    din_t target = 0;
+    uint8_t fps = MIRROR_DEFAULT_FPS;
+    uint32_t byteRate = MIRROR_SERIAL_BPS;
+
+    DrawCapture capture;   // Filled by the panel
+    DrawCapture frame;     // Being sent
+    bool sending = false;
+    bool fillsSent = false;
+    uint8_t rectIdx = 0;
+    uint32_t pixelIdx = 0;
+    uint16_t seq = 0;
+    uint32_t frameBytes = 0;
+
+    // Pacing
+    unsigned long lastFrame = 0;
+    uint32_t lastTick = 0;
+    int32_t creditUs = 0;
+    int32_t tokens = 0;
+
+    // Packet being built
+    uint8_t packet[MIRROR_PACKET_MAX + 1];
+    uint16_t payloadLen = 0;
+    uint8_t packetType = 0;
+
+    uint8_t batch[MIRROR_DDO_BATCH + MIRROR_PACKET_MAX + 1];
+    uint16_t batchLen = 0;
+
+    // Stats
+    uint32_t framesSent = 0;
+    uint32_t bytesSent = 0;
+    uint32_t lastFrameBytes = 0;
+    uint32_t busyUs = 0;
+
+    void put16(uint16_t v) { packet[5 + payloadLen++] = v & 0xFF; packet[5 + payloadLen++] = v >> 8; }
+    void put32(uint32_t v) { put16(v & 0xFFFF); put16(v >> 16); }
+
+    void open(MirrorPacket type) {
+        packetType = type;
+        payloadLen = 0;
+    }
+
+    uint16_t room() const { return MIRROR_PAYLOAD_MAX - payloadLen; }
+
+    void send() {
+        packet[0] = MIRROR_SYNC0;
+        packet[1] = MIRROR_SYNC1;
+        packet[2] = packetType;
+        packet[3] = payloadLen & 0xFF;
+        packet[4] = payloadLen >> 8;
+        uint8_t sum = 0;
+        for (uint16_t i = 2; i < 5 + payloadLen; i++) sum ^= packet[i];
+        uint16_t len = 5 + payloadLen;
+        packet[len++] = sum;
+
+        if (transport == MIRROR_SERIAL) {
+            Serial.write(packet, len);   // One write: never split by other Serial output
+        } else {
+            if (batchLen + len > MIRROR_DDO_BATCH) flushBatch();
+            memcpy(batch + batchLen, packet, len);
+            batchLen += len;
+        }
+        tokens -= len;
+        frameBytes += len;
+        bytesSent += len;
+        payloadLen = 0;
+        packetType = 0;
+    }
+
+    void flushBatch() {
+        if (batchLen == 0) return;
+        DDO ddo(MIRROR_TYPESET);
+        ddo.allocatePayload(batchLen);
+        memcpy(ddo.getPayloadPtr(), batch, batchLen);
+        node->push(target, &ddo);
+        batchLen = 0;
+    }
+
+    // Two worst-case packets can be written without waiting
+    bool canSend() const {
+        if (tokens < 2 * MIRROR_PACKET_MAX) return false;
+        return transport != MIRROR_SERIAL || Serial.availableForWrite() >= 2 * MIRROR_PACKET_MAX;
+    }
+
+    void openPixels(const UiRect& r, uint32_t index) {
+        open(MIR_PIXELS);
+        put16(r.x); put16(r.y); put16(r.w); put16(r.h);
+        put32(index);
+    }
+
+    // PackBits of one read-back span, continued in new packets as they fill
+    void encode(const UiRect& r, const uint16_t* px, int n, uint32_t base) {
+        int i = 0;
+        while (i < n) {
+            int run = 1;
+            while (i + run < n && run < 128 && px[i + run] == px[i]) run++;
+
+            if (room() < 3) { send(); openPixels(r, base + i); }
+            if (run >= 3) {
+                packet[5 + payloadLen++] = 127 + run;
+                put16(px[i]);
+                i += run;
+                continue;
+            }
+
+            // Literal up to the next run of 3, as long as the packet has room
+            int maxLen = (room() - 1) / 2;
+            if (maxLen > 128) maxLen = 128;
+            int len = 0;
+            while (i + len < n && len < maxLen) {
+                if (i + len + 2 < n && px[i + len] == px[i + len + 1] && px[i + len] == px[i + len + 2]) break;
+                len++;
+            }
+            packet[5 + payloadLen++] = len - 1;
+            for (int k = 0; k < len; k++) put16(px[i + k]);
+            i += len;
+        }
+    }
+
+    void beginFrame() {
+        capture.take(frame);
+        sending = true;
+        fillsSent = false;
+        rectIdx = 0;
+        pixelIdx = 0;
+        frameBytes = 0;
+        lastFrame = millis();
+        open(MIR_FRAME);
+        put16(++seq); put16(hw->tft.width()); put16(hw->tft.height());
+        send();
+    }
+
+    void endFrame() {
+        open(MIR_END);
+        put16(seq);
+        put32(frameBytes);
+        send();
+        if (transport == MIRROR_DDO) flushBatch();
+        sending = false;
+        framesSent++;
+        lastFrameBytes = frameBytes;
+    }
+
+    // One bounded piece of the frame: the fills, or one span of a rectangle
+    void step() {
+        if (!fillsSent) {
+            fillsSent = true;
+            for (uint8_t i = 0; i < frame.fillCount; i++) {
+                if (packetType == 0) open(MIR_FILLS);
+                const CaptureFill& f = frame.fills[i];
+                put16(f.r.x); put16(f.r.y); put16(f.r.w); put16(f.r.h); put16(f.color);
+                if (room() < 10) send();
+            }
+            if (packetType != 0) send();
+            return;
+        }
+
+        if (rectIdx >= frame.dirtyCount) { endFrame(); return; }
+
+        const UiRect& r = frame.dirty[rectIdx];
+        if (pixelIdx == 0) openPixels(r, 0);
+        int row = pixelIdx / r.w;
+        int col = pixelIdx % r.w;
+        int n = r.w - col < MIRROR_SPAN ? r.w - col : MIRROR_SPAN;
+
+        uint16_t px[MIRROR_SPAN];
+        hw->tft.readRect(r.x + col, r.y + row, n, 1, px);
+        for (int i = 0; i < n; i++) px[i] = __builtin_bswap16(px[i]);   // Read back byte-swapped
+        encode(r, px, n, pixelIdx);
+        pixelIdx += n;
+
+        // A partly filled packet waits for the next span of the same rectangle
+        if (pixelIdx >= (uint32_t)r.w * r.h) {
+            send();
+            rectIdx++;
+            pixelIdx = 0;
+        }
+    }
+
+public:
+    void init(HardwareManager* h, DaasAPI* n) {
+        hw = h;
+        node = n;
+    }
+
+    // Serial, or DDOs to din. fps and bytesPerSec 0: defaults of the transport.
+    bool start(MirrorTransport t, din_t din = 0, uint8_t framesPerSec = 0, uint32_t bytesPerSec = 0) {
+        if (t == MIRROR_OFF) { stop(); return true; }
+        if (t == MIRROR_DDO && din == 0) return false;
+        transport = t;
+        target = din;
+        fps = framesPerSec ? framesPerSec : MIRROR_DEFAULT_FPS;
+        byteRate = bytesPerSec ? bytesPerSec : (t == MIRROR_SERIAL ? MIRROR_SERIAL_BPS : MIRROR_DDO_BPS);
+        sending = false;
+        packetType = 0;
+        batchLen = 0;
+        tokens = 0;
+        creditUs = 0;
+        lastTick = micros();
+        capture.enabled = true;
+        capture.markAll();   // The viewer starts from a full frame
+        hw->tft.setCapture(&capture);
+        return true;
+    }
+
+    void stop() {
+        if (transport == MIRROR_OFF) return;
+        hw->tft.setCapture(nullptr);
+        capture.enabled = false;
+        capture.fillCount = 0;
+        capture.dirtyCount = 0;
+        transport = MIRROR_OFF;
+    }
+
+    // Full frame on the next send (a viewer that joined late)
+    void keyframe() {
+        if (transport != MIRROR_OFF) capture.markAll();
+    }
+
+    // Once per loop, after the app has drawn
+    void update() {
+        if (transport == MIRROR_OFF) return;
+
+        uint32_t now = micros();
+        uint32_t elapsed = now - lastTick;
+        lastTick = now;
+        creditUs += elapsed * MIRROR_LOOP_SHARE_PCT / 100;
+        if (creditUs > MIRROR_CREDIT_MAX_US) creditUs = MIRROR_CREDIT_MAX_US;
+        tokens += (int32_t)((uint64_t)elapsed * byteRate / 1000000);
+        int32_t tokenCap = byteRate / 4 > 4 * MIRROR_PACKET_MAX ? byteRate / 4 : 4 * MIRROR_PACKET_MAX;
+        if (tokens > tokenCap) tokens = tokenCap;
+
+        if (!sending) {
+            if (capture.empty() || millis() - lastFrame < 1000UL / fps) return;
+            if (!canSend()) return;
+            beginFrame();
+        }
+
+        while (sending && creditUs > 0 && canSend()) {
+            uint32_t t = micros();
+            step();
+            uint32_t spent = micros() - t;
+            creditUs -= spent;
+            busyUs += spent;
+        }
+    }
+
+    MirrorTransport getTransport() const { return transport; }
+    din_t getTarget() const { return target; }
+    uint8_t getFps() const { return fps; }
+    uint32_t getByteRate() const { return byteRate; }
+    uint32_t getFrames() const { return framesSent; }
+    uint32_t getBytes() const { return bytesSent; }
+    uint32_t getLastFrameBytes() const { return lastFrameBytes; }
+    uint32_t getBusyUs() const { return busyUs; }
+};
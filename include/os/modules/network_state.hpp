@@ -0,0 +1,122 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include "daas/daas.hpp"
+#include "log.hpp"
+
+#define NET_RSSI_PERIOD_MS 2000   // Signal strength has no event, sample it slowly
+#define NET_DAAS_PORT 9909
+
+// NetworkState::pending bits, set from the Wi-Fi event task
+#define NET_EVT_GOT_IP (1 << 0)
+#define NET_EVT_LOST   (1 << 1)
+
+// Snapshot read by the UI. Only fields that change what is drawn
+// (link, address, bars, driver) bump the version; raw RSSI does not.
+struct NetworkStatus {
+    bool wifiUp;
+    uint32_t ip;          // IPv4, 0 when down
+    int8_t rssi;          // dBm, 0 when down
+    uint8_t bars;         // 0..4 signal level
+    bool daasDriver;      // _LINK_INET4 driver bound to the current ip
+};
+
+// Wi-Fi link state service.
+// WiFi.onEvent() runs on the system event task, so the callback only
+// raises pending bits; update() applies them on the loop, refreshes the
+// RSSI every NET_RSSI_PERIOD_MS and keeps the DaaS INET4 driver bound
+// to the current address without user interaction.
+class NetworkState {
+private:
+    DaasAPI* node = nullptr;
+    NetworkStatus status = {false, 0, 0, 0, false};
+    uint32_t changeVersion = 0;
+
+    std::atomic<uint32_t> pending{0};
+    unsigned long lastRssi = 0;
+    bool autoDriver = true;
+    uint32_t driverIP = 0;      // Address the INET4 driver was bound to
+    bool driverFailed = false;  // Not retried until the address changes
+
+    static uint8_t barsFor(int8_t rssi) {
+        if (rssi > -55) return 4;
+        if (rssi > -65) return 3;
+        if (rssi > -75) return 2;
+        if (rssi > -85) return 1;
+        return 0;
+    }
+
+    void setUp(bool up) {
+        uint32_t ip = up ? (uint32_t)WiFi.localIP() : 0;
+        if (status.wifiUp == up && status.ip == ip) return;
+
+        if (status.ip != ip) driverFailed = false;
+        status.wifiUp = up;
+        status.ip = ip;
+        // Same lease after a drop: the driver is still bound to it
+        status.daasDriver = up && ip == driverIP;
+        if (!up) { status.rssi = 0; status.bars = 0; }
+        lastRssi = 0; // Sample right away
+        changeVersion++;
+    }
+
+    void sampleRssi(unsigned long now) {
+        lastRssi = now;
+        status.rssi = WiFi.RSSI();
+        uint8_t bars = barsFor(status.rssi);
+        if (bars != status.bars) { status.bars = bars; changeVersion++; }
+    }
+
+public:
+    void init(DaasAPI* n) {
+        node = n;
+        WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+            switch (event) {
+                case ARDUINO_EVENT_WIFI_STA_GOT_IP:       pending |= NET_EVT_GOT_IP; break;
+                case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+                case ARDUINO_EVENT_WIFI_STA_LOST_IP:      pending |= NET_EVT_LOST; break;
+                default: break;
+            }
+        });
+        // The saved network may have come up before the handler was registered
+        if (WiFi.status() == WL_CONNECTED) pending |= NET_EVT_GOT_IP;
+    }
+
+    // Binds _LINK_INET4 automatically whenever a new address is obtained
+    void setAutoDriver(bool enabled) { autoDriver = enabled; }
+
+    void update() {
+        uint32_t events = pending.exchange(0);
+        if (events) {
+            // A drop followed by a new lease in the same loop ends up connected
+            if (events & NET_EVT_LOST) setUp(false);
+            if (events & NET_EVT_GOT_IP) setUp(true);
+        }
+
+        if (!status.wifiUp) return;
+
+        unsigned long now = millis();
+        if (lastRssi == 0 || now - lastRssi > NET_RSSI_PERIOD_MS) sampleRssi(now);
+
+        if (autoDriver && !status.daasDriver && !driverFailed) enableDaasDriver();
+    }
+
+    // Binds the INET4 driver to ip:NET_DAAS_PORT, also used by the Settings button
+    bool enableDaasDriver() {
+        if (!status.wifiUp || !node) return false;
+        String link = uri();
+        bool ok = node->enableDriver(_LINK_INET4, link.c_str()) == ERROR_NONE;
+        driverFailed = !ok;
+        if (ok) driverIP = status.ip;
+        sysLog(LOG_DAAS_DRIVER, link, ok ? "enabled" : "failed");
+        if (ok != status.daasDriver) { status.daasDriver = ok; changeVersion++; }
+        return ok;
+    }
+
+    const NetworkStatus& get() const { return status; }
+    String uri() const { return status.wifiUp ? IPAddress(status.ip).toString() + ":" + String(NET_DAAS_PORT) : String(""); }
+
+    // Bumped whenever a drawn field changes
+    uint32_t version() const { return changeVersion; }
+};
@@ -0,0 +1,243 @@
+#pragma once
+#include <Arduino.h>
+#include "daas/daas.hpp"
+
+// Slot count must be a power of two. With 512 slots and a 75% load cap
+// the directory holds up to 384 nodes in 16 KB of .bss.
+#define NODE_DIR_BITS 9
+#define NODE_DIR_SLOTS (1 << NODE_DIR_BITS)
+#define NODE_DIR_MAX_NODES ((NODE_DIR_SLOTS * 3) / 4)
+
+#define NODE_RTT_UNKNOWN 0xFFFF
+
+// Recent changes kept for incremental consumers (power of two)
+#define NODE_DIR_JOURNAL 64
+
+// NodeRecord::state bits
+#define NODE_ONLINE  (1 << 0) // Heard from recently or answering probes
+#define NODE_PROBING (1 << 1) // A frisbee is in flight, probeAt is its send time
+#define NODE_HOT     (1 << 2) // Active peer (open chat...), probed at the fastest rate
+#define NODE_SCHEDULED (1 << 3) // probeAt holds a time (any value, 0 included)
+
+// One directory entry (32 bytes). din == 0 marks an empty slot,
+// DIN 0 is the NULL DIN in DaaS so it never collides with a real node.
+struct NodeRecord {
+    din_t din;
+    stime_t lastSeen;    // Synced timestamp (ms) of the last activity
+    uint32_t prefix;     // Network prefix (din >> 44)
+    uint16_t rtt;        // Round trip EWMA (ms), NODE_RTT_UNKNOWN if never probed
+    uint8_t link;        // link_t the node was reached through
+    uint8_t features;    // feature_t bitmask advertised by the node
+
+    // Liveness state, maintained by LivenessMonitor
+    uint32_t probeAt;    // millis() of the next probe, valid with NODE_SCHEDULED
+    uint8_t loss;        // Probe loss rate EWMA, 0..255
+    uint8_t misses;      // Consecutive unanswered probes
+    uint8_t backoff;     // Probe interval exponent
+    uint8_t state;       // NODE_ONLINE | NODE_PROBING | NODE_HOT | NODE_SCHEDULED
+};
+
+enum NodeChangeKind : uint8_t {
+    NODE_ADDED,
+    NODE_REMOVED,
+    NODE_UPDATED
+};
+
+struct NodeChange {
+    din_t din;
+    NodeChangeKind kind;
+};
+
+// Open addressing (linear probing) table keyed by DIN.
+// Deletions use backward shifting, so there are no tombstones and
+// lookups stay O(1) even after heavy churn.
+//
+// Every DIN gets its own record. The old discoveredNodes list also
+// dropped a DIN whose network prefix (din >> 44) matched a known node.
+// That rule is gone on purpose: all DINs below 2^44 share prefix 0, so
+// it kept a single node and hid the rest, including the benchmark's
+// loopback peer. The prefix is still stored for grouping.
+class NodeDirectory {
+private:
+    NodeRecord slots[NODE_DIR_SLOTS];
+    uint16_t count = 0;
+    uint32_t changeVersion = 0;
+
+    // journal[v % NODE_DIR_JOURNAL] holds the change that produced version v
+    NodeChange journal[NODE_DIR_JOURNAL];
+    uint32_t journalFloor = 1; // Oldest version still replayable
+
+    void record(din_t din, NodeChangeKind kind) {
+        changeVersion++;
+        journal[changeVersion & (NODE_DIR_JOURNAL - 1)] = {din, kind};
+    }
+
+    static inline uint16_t home(din_t din) {
+        // Fibonacci hashing: DINs share the high prefix bits, multiply to spread them
+        return (uint16_t)((din * 0x9E3779B97F4A7C15ULL) >> (64 - NODE_DIR_BITS));
+    }
+
+    static inline uint16_t next(uint16_t idx) { return (idx + 1) & (NODE_DIR_SLOTS - 1); }
+
+    int16_t indexOf(din_t din) const {
+        if (din == 0) return -1;
+        for (uint16_t i = home(din); slots[i].din != 0; i = next(i)) {
+            if (slots[i].din == din) return i;
+        }
+        return -1;
+    }
+
+    void removeAt(uint16_t hole) {
+        din_t removed = slots[hole].din;
+        // Backward shift: pull up every entry of the probe run that
+        // would become unreachable once the hole is opened.
+        uint16_t i = hole;
+        for (;;) {
+            i = next(i);
+            if (slots[i].din == 0) break;
+            uint16_t h = home(slots[i].din);
+            // Entry can move into the hole only if its home is not in (hole, i]
+            bool stay = (hole <= i) ? (hole < h && h <= i) : (hole < h || h <= i);
+            if (stay) continue;
+            slots[hole] = slots[i];
+            hole = i;
+        }
+        slots[hole].din = 0;
+        count--;
+        record(removed, NODE_REMOVED);
+    }
+
+    // Drops the least recently seen node to make room for a new one.
+    void evictOldest() {
+        int16_t victim = -1;
+        for (uint16_t i = 0; i < NODE_DIR_SLOTS; i++) {
+            if (slots[i].din == 0) continue;
+            if (victim < 0 || slots[i].lastSeen < slots[victim].lastSeen) victim = i;
+        }
+        if (victim >= 0) removeAt(victim);
+    }
+
+public:
+    NodeDirectory() { clear(); }
+
+    void clear() {
+        memset(slots, 0, sizeof(slots));
+        count = 0;
+        // Nothing before a clear can be replayed: consumers must resync
+        changeVersion++;
+        journalFloor = changeVersion + 1;
+    }
+
+    NodeRecord* find(din_t din) {
+        int16_t idx = indexOf(din);
+        return idx < 0 ? nullptr : &slots[idx];
+    }
+
+    const NodeRecord* find(din_t din) const {
+        int16_t idx = indexOf(din);
+        return idx < 0 ? nullptr : &slots[idx];
+    }
+
+    bool contains(din_t din) const { return indexOf(din) >= 0; }
+
+    // Inserts the node or refreshes its last-seen time.
+    // Returns nullptr only for the NULL DIN.
+    NodeRecord* touch(din_t din, stime_t now, link_t link = _LINK_NONE) {
+        if (din == 0) return nullptr;
+
+        int16_t idx = indexOf(din);
+        if (idx >= 0) {
+            NodeRecord& rec = slots[idx];
+            rec.lastSeen = now;
+            if (link != _LINK_NONE && rec.link != link) {
+                rec.link = link;
+                record(din, NODE_UPDATED);
+            }
+            return &rec;
+        }
+
+        if (count >= NODE_DIR_MAX_NODES) evictOldest();
+
+        uint16_t i = home(din);
+        while (slots[i].din != 0) i = next(i);
+
+        slots[i] = {din, now, (uint32_t)(din >> 44), NODE_RTT_UNKNOWN, (uint8_t)link, 0,
+                    0, 0, 0, 0, NODE_ONLINE};
+        count++;
+        record(din, NODE_ADDED);
+        return &slots[i];
+    }
+
+    bool erase(din_t din) {
+        int16_t idx = indexOf(din);
+        if (idx < 0) return false;
+        removeAt(idx);
+        return true;
+    }
+
+    void setFeatures(din_t din, uint8_t features) {
+        NodeRecord* rec = find(din);
+        if (rec && rec->features != features) {
+            rec->features = features;
+            record(din, NODE_UPDATED);
+        }
+    }
+
+    // Publishes an in-place record change (liveness, RTT...) to consumers
+    void notifyUpdated(din_t din) {
+        if (contains(din)) record(din, NODE_UPDATED);
+    }
+
+    // Evicts every node not seen for more than maxAge ms.
+    // Returns the number of evicted nodes.
+    uint16_t age(stime_t now, stime_t maxAge) {
+        uint16_t evicted = 0;
+        uint16_t i = 0;
+        while (i < NODE_DIR_SLOTS) {
+            const NodeRecord& rec = slots[i];
+            // ATS corrections can move the clock back: treat "future" entries as fresh
+            if (rec.din != 0 && now > rec.lastSeen && now - rec.lastSeen > maxAge) {
+                // Backward shift may pull a not yet visited entry into i: re-check it
+                removeAt(i);
+                evicted++;
+                continue;
+            }
+            i++;
+        }
+        return evicted;
+    }
+
+    // Raw slot access for incremental scans, nullptr for empty slots
+    NodeRecord* slotAt(uint16_t idx) {
+        NodeRecord& rec = slots[idx & (NODE_DIR_SLOTS - 1)];
+        return rec.din != 0 ? &rec : nullptr;
+    }
+
+    // Calls fn(const NodeRecord&) for every known node, in slot order.
+    template <typename F>
+    void forEach(F fn) const {
+        for (uint16_t i = 0; i < NODE_DIR_SLOTS; i++) {
+            if (slots[i].din != 0) fn(slots[i]);
+        }
+    }
+
+    uint16_t size() const { return count; }
+
+    // Replays, in order, every change made after version `since`.
+    // Returns false when the journal no longer covers that range:
+    // the caller must then rebuild from forEach().
+    template <typename F>
+    bool changesSince(uint32_t since, F fn) const {
+        if (since >= changeVersion) return true;
+        uint32_t first = since + 1;
+        if (first < journalFloor || changeVersion - first >= NODE_DIR_JOURNAL) return false;
+        for (uint32_t v = first; v <= changeVersion; v++) {
+            fn(journal[v & (NODE_DIR_JOURNAL - 1)]);
+        }
+        return true;
+    }
+
+    // Bumped on every insert, removal or link/feature change.
+    // UIs compare it against the value they last rendered.
+    uint32_t version() const { return changeVersion; }
+};
@@ -0,0 +1,390 @@
+#pragma once
+#include <Arduino.h>
+#include <LovyanGFX.hpp>
+#include <vector>
+
+#include "storage.hpp"
+
+// Anti-aliased glyph fonts built by tools/subset_fonts.py.
+//
+//   PackedFontHeader
+//   uint32_t pages[256]        offset of each 256-codepoint page, 0 = empty
+//   page: uint32_t glyphs[256] offset of each glyph, 0 = missing
+//   glyph: PackedGlyph + RLE stream
+//
+// Offsets are from the start of the font, integers little endian.
+// RLE stream of 4-bit alpha, row major over width * height pixels:
+//   0x00-0x3F  n+1 transparent pixels
+//   0x40-0x7F  n+1 opaque pixels
+//   0x80-0xFF  n+1 literal alphas follow, two per byte, high nibble first
+
+#define PACKED_FONT_MAGIC 0x544E464D   // "MFNT"
+#define PACKED_FONT_VERSION 1
+#define PACKED_FONT_PAGES 256
+#define PACKED_FONT_MAX_PIXELS 1600    // Largest glyph box (40x40)
+
+#define FONT_FALLBACK_PAGES 4          // Page tables cached in RAM (1 KB each)
+#define FONT_FALLBACK_GLYPHS 64        // Decoded glyph records cached in RAM
+#define FONT_FALLBACK_INFLIGHT 8       // Glyph reads queued at once
+#define FONT_FALLBACK_GLYPH_READ 520   // PackedGlyph + the largest RLE stream
+
+struct PackedFontHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t bpp;          // 4
+    uint8_t height;       // Line height
+    uint8_t ascent;       // Baseline from the top of the line
+    uint16_t glyphCount;
+    uint16_t reserved;
+    uint32_t totalSize;
+};
+
+struct PackedGlyph {
+    uint8_t width;
+    uint8_t height;
+    int8_t xOffset;       // From the pen position
+    int8_t yOffset;       // From the top of the line
+    uint8_t advance;
+    uint8_t reserved;
+    uint16_t size;        // RLE bytes that follow
+};
+
+static_assert(sizeof(PackedFontHeader) == 16, "font header layout");
+static_assert(sizeof(PackedGlyph) == 8, "glyph header layout");
+
+// Lazily loaded full font on storage (opt-in).
+// Glyphs missing from the subset are fetched through the storage task in
+// up to three steps (page table, page, glyph) and cached; until they land
+// the renderer draws the replacement glyph, then version() changes so the
+// kernel can repaint the screen. All state is touched from the loop only.
+class FontFallback {
+private:
+    struct Page { uint16_t page; uint32_t glyphs[256]; uint32_t lastUse; };
+    struct Glyph { uint16_t code; std::vector<uint8_t> bytes; uint32_t lastUse; };
+
+    StorageService* storage = nullptr;
+    String path = "";
+
+    std::vector<uint32_t> pageTable;     // Empty until loaded
+    bool tableInFlight = false;
+    bool failed = false;                 // File missing or corrupt: stop asking
+    std::vector<Page> pages;
+    std::vector<uint16_t> pagesInFlight;
+    std::vector<Glyph> glyphs;
+    std::vector<uint16_t> glyphsInFlight;
+    std::vector<uint16_t> absent;        // Not in the full font either
+    std::vector<uint16_t> waiting;       // Asked for before the page table arrived
+    uint32_t useClock = 0;
+    uint32_t changeVersion = 0;
+    uint32_t generation = 0;             // Bumped by begin/end: older callbacks are ignored
+
+    static bool contains(const std::vector<uint16_t>& v, uint16_t x) {
+        for (uint16_t e : v) if (e == x) return true;
+        return false;
+    }
+
+    static void drop(std::vector<uint16_t>& v, uint16_t x) {
+        for (size_t i = 0; i < v.size(); i++) {
+            if (v[i] == x) { v[i] = v.back(); v.pop_back(); return; }
+        }
+    }
+
+    Page* findPage(uint16_t page) {
+        for (auto& p : pages) {
+            if (p.page == page) { p.lastUse = ++useClock; return &p; }
+        }
+        return nullptr;
+    }
+
+    void loadTable() {
+        tableInFlight = true;
+        uint32_t gen = generation;
+        storage->read(path, 0, sizeof(PackedFontHeader) + PACKED_FONT_PAGES * 4, [this, gen](const StorageRequest& req) {
+            if (gen != generation) return;
+            tableInFlight = false;
+            const PackedFontHeader* hdr = (const PackedFontHeader*)req.data.data();
+            if (!req.ok() || req.data.size() < sizeof(PackedFontHeader) + PACKED_FONT_PAGES * 4 ||
+                hdr->magic != PACKED_FONT_MAGIC || hdr->version != PACKED_FONT_VERSION) {
+                failed = true;
+                return;
+            }
+            pageTable.resize(PACKED_FONT_PAGES);
+            memcpy(pageTable.data(), req.data.data() + sizeof(PackedFontHeader), PACKED_FONT_PAGES * 4);
+
+            std::vector<uint16_t> codes;
+            codes.swap(waiting);
+            for (uint16_t c : codes) request(c);
+        });
+    }
+
+    void loadPage(uint16_t page, uint16_t code) {
+        pagesInFlight.push_back(page);
+        uint32_t gen = generation;
+        storage->read(path, pageTable[page], 256 * 4, [this, gen, page, code](const StorageRequest& req) {
+            if (gen != generation) return;
+            drop(pagesInFlight, page);
+            if (!req.ok() || req.data.size() < 256 * 4) { absent.push_back(code); return; }
+
+            Page* slot = nullptr;
+            if (pages.size() < FONT_FALLBACK_PAGES) {
+                pages.push_back(Page());
+                slot = &pages.back();
+            } else {
+                slot = &pages[0];
+                for (auto& p : pages) if (p.lastUse < slot->lastUse) slot = &p;
+            }
+            slot->page = page;
+            slot->lastUse = ++useClock;
+            memcpy(slot->glyphs, req.data.data(), sizeof(slot->glyphs));
+            request(code); // Next step for the glyph that needed the page
+        });
+    }
+
+    void loadGlyph(uint16_t code, uint32_t offset) {
+        glyphsInFlight.push_back(code);
+        uint32_t gen = generation;
+        storage->read(path, offset, FONT_FALLBACK_GLYPH_READ, [this, gen, code](const StorageRequest& req) {
+            if (gen != generation) return;
+            drop(glyphsInFlight, code);
+            const PackedGlyph* g = (const PackedGlyph*)req.data.data();
+            if (!req.ok() || req.data.size() < sizeof(PackedGlyph) ||
+                req.data.size() < sizeof(PackedGlyph) + g->size ||
+                (uint32_t)g->width * g->height > PACKED_FONT_MAX_PIXELS) {
+                absent.push_back(code);
+                return;
+            }
+
+            Glyph* slot = nullptr;
+            if (glyphs.size() < FONT_FALLBACK_GLYPHS) {
+                glyphs.push_back(Glyph());
+                slot = &glyphs.back();
+            } else {
+                slot = &glyphs[0];
+                for (auto& e : glyphs) if (e.lastUse < slot->lastUse) slot = &e;
+            }
+            slot->code = code;
+            slot->lastUse = ++useClock;
+            slot->bytes.assign(req.data.begin(), req.data.begin() + sizeof(PackedGlyph) + g->size);
+            changeVersion++;
+        });
+    }
+
+    // Issues the next read needed to get code into the cache
+    void request(uint16_t code) {
+        if (!storage || failed || contains(absent, code) || contains(glyphsInFlight, code)) return;
+        if (pageTable.empty()) {
+            if (!contains(waiting, code) && waiting.size() < FONT_FALLBACK_INFLIGHT * 2) waiting.push_back(code);
+            if (!tableInFlight) loadTable();
+            return;
+        }
+
+        uint16_t page = code >> 8;
+        if (pageTable[page] == 0) { absent.push_back(code); return; }
+
+        Page* p = findPage(page);
+        if (!p) {
+            if (!contains(pagesInFlight, page) && pagesInFlight.size() < FONT_FALLBACK_INFLIGHT) loadPage(page, code);
+            return;
+        }
+
+        uint32_t offset = p->glyphs[code & 0xFF];
+        if (offset == 0) { absent.push_back(code); return; }
+        if (glyphsInFlight.size() < FONT_FALLBACK_INFLIGHT) loadGlyph(code, offset);
+    }
+
+public:
+    void begin(StorageService* s, const String& file) {
+        end();
+        storage = s;
+        path = file;
+        failed = false;
+    }
+
+    // Reads still queued complete into the next generation and are dropped
+    void end() {
+        generation++;
+        storage = nullptr;
+        tableInFlight = false;
+        pagesInFlight.clear();
+        glyphsInFlight.clear();
+        pageTable.clear();
+        pages.clear();
+        glyphs.clear();
+        absent.clear();
+        waiting.clear();
+        changeVersion++;
+    }
+
+    bool isEnabled() const { return storage != nullptr; }
+
+    // Cached glyph, or nullptr after queueing its load
+    const PackedGlyph* find(uint16_t code) {
+        if (!storage) return nullptr;
+        for (auto& g : glyphs) {
+            if (g.code == code) { g.lastUse = ++useClock; return (const PackedGlyph*)g.bytes.data(); }
+        }
+        request(code);
+        return nullptr;
+    }
+
+    // Bumped when a glyph lands: text drawn with placeholders is stale
+    uint32_t version() const { return changeVersion; }
+};
+
+// LovyanGFX font backed by a PackedFont blob (typically mapped from the
+// asset pack, so glyphs are decoded straight from flash). Drop-in for
+// setFont(), every drawString()/textWidth() keeps working.
+class PackedFont : public lgfx::IFont {
+private:
+    const uint8_t* base = nullptr;
+    const PackedFontHeader* hdr = nullptr;
+    const uint32_t* pages = nullptr;
+    mutable FontFallback fallback;
+
+    // One glyph box of blended pixels, shared: fonts are only drawn from the loop
+    static uint16_t* pixelBuffer() {
+        static uint16_t buf[PACKED_FONT_MAX_PIXELS];
+        return buf;
+    }
+
+    const PackedGlyph* local(uint16_t code) const {
+        uint32_t page = pages[code >> 8];
+        if (page == 0) return nullptr;
+        uint32_t off = ((const uint32_t*)(base + page))[code & 0xFF];
+        return off ? (const PackedGlyph*)(base + off) : nullptr;
+    }
+
+    const PackedGlyph* glyph(uint16_t code) const {
+        const PackedGlyph* g = local(code);
+        if (!g && code >= 0x80) g = fallback.find(code);
+        if (!g) g = local('?'); // Placeholder while a fallback glyph loads
+        return g;
+    }
+
+    static inline uint16_t to565(uint32_t rgb888) {
+        return ((rgb888 >> 8) & 0xF800) | ((rgb888 >> 5) & 0x07E0) | ((rgb888 >> 3) & 0x001F);
+    }
+
+    static inline uint16_t blend(uint16_t fg, uint16_t bg, uint8_t a) {
+        // 4-bit alpha per channel, exact at 0 and 15
+        uint32_t r = ((fg >> 11) * a + (bg >> 11) * (15 - a)) / 15;
+        uint32_t g = (((fg >> 5) & 0x3F) * a + ((bg >> 5) & 0x3F) * (15 - a)) / 15;
+        uint32_t b = ((fg & 0x1F) * a + (bg & 0x1F) * (15 - a)) / 15;
+        return (r << 11) | (g << 5) | b;
+    }
+
+    // Calls span(index, count, alpha) for every run of equal alpha
+    template <typename F>
+    static void decode(const PackedGlyph* g, F span) {
+        const uint8_t* rle = (const uint8_t*)(g + 1);
+        const uint8_t* end = rle + g->size;
+        uint32_t total = (uint32_t)g->width * g->height;
+        uint32_t idx = 0;
+        while (rle < end && idx < total) {
+            uint8_t op = *rle++;
+            uint32_t n = (op & (op & 0x80 ? 0x7F : 0x3F)) + 1;
+            if (idx + n > total) n = total - idx;
+            if (op < 0x40) {
+                idx += n;
+            } else if (op < 0x80) {
+                span(idx, n, 15);
+                idx += n;
+            } else {
+                for (uint32_t i = 0; i < n && rle < end; i++) {
+                    uint8_t a = (i & 1) ? (*rle++ & 0x0F) : (*rle >> 4);
+                    if (a) span(idx, 1, a);
+                    idx++;
+                }
+                if (n & 1) rle++; // Odd count: skip the unused low nibble
+            }
+        }
+    }
+
+public:
+    bool begin(const uint8_t* blob, uint32_t len) {
+        base = nullptr;
+        if (!blob || len < sizeof(PackedFontHeader) + PACKED_FONT_PAGES * 4) return false;
+        const PackedFontHeader* h = (const PackedFontHeader*)blob;
+        if (h->magic != PACKED_FONT_MAGIC || h->version != PACKED_FONT_VERSION || h->bpp != 4) return false;
+        base = blob;
+        hdr = h;
+        pages = (const uint32_t*)(blob + sizeof(PackedFontHeader));
+        return true;
+    }
+
+    bool isLoaded() const { return base != nullptr; }
+
+    // Opt-in: glyphs outside the subset come from this full font on storage
+    void enableFallback(StorageService* storage, const String& path) { fallback.begin(storage, path); }
+    void disableFallback() { fallback.end(); }
+    bool hasFallback() const { return fallback.isEnabled(); }
+    uint32_t fallbackVersion() const { return fallback.version(); }
+
+    // --- lgfx::IFont ---
+
+    void getDefaultMetric(lgfx::FontMetrics* metrics) const override {
+        metrics->width = hdr->height / 2;
+        metrics->x_advance = metrics->width;
+        metrics->x_offset = 0;
+        metrics->height = hdr->height;
+        metrics->y_advance = hdr->height;
+        metrics->y_offset = 0;
+        metrics->baseline = hdr->ascent;
+    }
+
+    bool updateFontMetric(lgfx::FontMetrics* metrics, uint16_t code) const override {
+        const PackedGlyph* g = glyph(code);
+        if (!g) return false;
+        metrics->width = g->advance;
+        metrics->x_advance = g->advance;
+        metrics->x_offset = 0;
+        return true;
+    }
+
+    size_t drawChar(lgfx::LGFXBase* gfx, int32_t x, int32_t y, uint16_t code, const lgfx::TextStyle* style,
+                    lgfx::FontMetrics* metrics, int32_t& filled_x) const override {
+        const PackedGlyph* g = glyph(code);
+        if (!g) return 0;
+
+        uint16_t fg = to565(style->fore_rgb888);
+        uint16_t bg = to565(style->back_rgb888);
+        bool opaque = style->fore_rgb888 != style->back_rgb888; // LGFX: same colour = transparent text
+
+        if (opaque) {
+            // Cell background, minus what the previous glyph already covered
+            int32_t left = max(x, filled_x);
+            int32_t right = x + g->advance;
+            if (right > left) gfx->fillRect(left, y, right - left, hdr->height, bg);
+            filled_x = right;
+        }
+
+        uint32_t w = g->width, h = g->height;
+        if (w == 0 || h == 0 || w * h > PACKED_FONT_MAX_PIXELS) return g->advance;
+        int32_t gx = x + g->xOffset;
+        int32_t gy = y + g->yOffset;
+
+        if (opaque) {
+            // Blend the whole box against the known background, one window write
+            uint16_t* pixelBuf = pixelBuffer();
+            for (uint32_t i = 0; i < w * h; i++) pixelBuf[i] = bg;
+            decode(g, [&](uint32_t idx, uint32_t n, uint8_t a) {
+                uint16_t c = a == 15 ? fg : blend(fg, bg, a);
+                for (uint32_t i = 0; i < n; i++) pixelBuf[idx + i] = c;
+            });
+            gfx->pushImage(gx, gy, w, h, (const lgfx::rgb565_t*)pixelBuf);
+        } else {
+            // Unknown background: solid runs only, half-covered pixels rounded
+            decode(g, [&](uint32_t idx, uint32_t n, uint8_t a) {
+                if (a < 8) return;
+                while (n > 0) {
+                    uint32_t col = idx % w;
+                    uint32_t run = min(n, w - col);
+                    gfx->drawFastHLine(gx + col, gy + idx / w, run, fg);
+                    idx += run;
+                    n -= run;
+                }
+            });
+        }
+        return g->advance;
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+#include <Arduino.h>
+#include "hal/hal.hpp"
+#include "storage.hpp"
+#include "log.hpp"
+#include "toastmessages.hpp"
+
+#define SHOT_STRIP_ROWS 4            // 1920 bytes read back at a time
+#define SHOT_STRIPS_PER_LOOP 4
+#define SHOT_QUEUE_HEADROOM 6        // Storage queue slots left to everyone else
+#define SHOT_HOLD_MS 2000            // Gesture: hold the top-right corner
+#define SHOT_HEADER_SIZE 66          // File + info header + RGB565 masks
+
+// Top-right corner, over the status bar
+constexpr UiRect SHOT_CORNER = {UI_SCREEN_W - 32, 0, 32, 32};
+
+enum ShotTrigger : uint8_t {
+    SHOT_TRIGGER_CONSOLE = 1,
+    SHOT_TRIGGER_GESTURE = 2,
+    SHOT_TRIGGER_WATCHDOG = 4
+};
+
+// Screenshots to storage as 16-bit BMP (RGB565 bitfields, bottom-up rows).
+// The panel is read back a strip at a time into one fixed buffer and each
+// strip is appended to the file right away: the frame never exists in RAM.
+// A few strips per loop, so a capture takes about 20 loops and a screen
+// that changes meanwhile can tear between strips.
+class ScreenshotService {
+private:
+    HardwareManager* hw = nullptr;
+    StorageService* storage = nullptr;
+    uint8_t triggers = SHOT_TRIGGER_CONSOLE | SHOT_TRIGGER_GESTURE | SHOT_TRIGGER_WATCHDOG;
+
+    uint16_t strip[UI_SCREEN_W * SHOT_STRIP_ROWS];
+    String path = "";
+    String lastPath = "";
+    int nextRow = 0;                 // Rows [0, nextRow) still to write, bottom-up
+    bool active = false;
+    bool failed = false;             // A strip did not make it to the file
+    StorageFuture last;
+    uint32_t changeVersion = 0;
+
+    unsigned long holdStart = 0;
+    bool holdFired = false;
+
+    static void le16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+    static void le32(uint8_t* p, uint32_t v) { le16(p, v & 0xFFFF); le16(p + 2, v >> 16); }
+
+    void header(uint8_t* h, int w, int height) {
+        uint32_t image = (uint32_t)w * 2 * height;
+        memset(h, 0, SHOT_HEADER_SIZE);
+        h[0] = 'B'; h[1] = 'M';
+        le32(h + 2, SHOT_HEADER_SIZE + image);
+        le32(h + 10, SHOT_HEADER_SIZE);
+        le32(h + 14, 40);            // BITMAPINFOHEADER
+        le32(h + 18, w);
+        le32(h + 22, height);        // Positive: bottom-up
+        le16(h + 26, 1);
+        le16(h + 28, 16);
+        le32(h + 30, 3);             // BI_BITFIELDS
+        le32(h + 34, image);
+        le32(h + 38, 2835);          // 72 dpi
+        le32(h + 42, 2835);
+        le32(h + 54, 0xF800);
+        le32(h + 58, 0x07E0);
+        le32(h + 62, 0x001F);
+    }
+
+    void finish(bool ok) {
+        active = false;
+        last.reset();
+        changeVersion++;
+        // The toast comes after the last strip, it is never in the picture
+        if (ok) {
+            lastPath = path;
+            sysLog(LOG_SHOT_SAVED, path);
+            ToastManager::getInstance()->show("Screenshot " + path, TOAST_SUCCESS, 1500);
+        } else {
+            sysLog(LOG_SHOT_FAILED, path);
+            ToastManager::getInstance()->show("Screenshot failed", TOAST_ERROR, 1500);
+        }
+    }
+
+    // One strip, the bottom-most still missing
+    void writeStrip() {
+        int w = hw->tft.width();
+        int rows = nextRow < SHOT_STRIP_ROWS ? nextRow : SHOT_STRIP_ROWS;
+        int top = nextRow - rows;
+        hw->tft.readRect(0, top, w, rows, strip);
+
+        // Bottom-up in the file: reverse the rows, and un-swap the read-back bytes
+        for (int r = 0; r < rows / 2; r++) {
+            uint16_t* a = strip + r * w;
+            uint16_t* b = strip + (rows - 1 - r) * w;
+            for (int x = 0; x < w; x++) { uint16_t t = a[x]; a[x] = b[x]; b[x] = t; }
+        }
+        for (int i = 0; i < w * rows; i++) strip[i] = __builtin_bswap16(strip[i]);
+
+        last = storage->append(path, (const uint8_t*)strip, (size_t)w * rows * 2, "",
+                               [this](const StorageRequest& req) { if (!req.ok()) failed = true; });
+        nextRow = top;
+    }
+
+public:
+    void init(HardwareManager* h, StorageService* s) {
+        hw = h;
+        storage = s;
+        triggers = hw->loadShotTriggers(triggers);
+    }
+
+    uint8_t getTriggers() const { return triggers; }
+    void setTriggers(uint8_t t) {
+        triggers = t;
+        hw->saveShotTriggers(t);
+    }
+
+    // Starts a capture if this trigger is enabled and none is running
+    bool capture(ShotTrigger why) {
+        if (!(triggers & why) || active || !storage->isAvailable()) return false;
+
+        char name[24];
+        snprintf(name, sizeof(name), "/shot%04u.bmp", hw->nextShotNumber());
+        path = name;
+
+        uint8_t h[SHOT_HEADER_SIZE];
+        header(h, hw->tft.width(), hw->tft.height());
+        last = storage->write(path, h, sizeof(h), [this](const StorageRequest& req) { if (!req.ok()) failed = true; });
+        nextRow = hw->tft.height();
+        active = true;
+        failed = false;
+        changeVersion++;
+        return true;
+    }
+
+    bool isActive() const { return active; }
+    const String& getLastPath() const { return lastPath; }
+    uint32_t version() const { return changeVersion; }
+
+    // Once per loop, after the app has drawn
+    void update() {
+        // Gesture: a press held on the corner, once per press
+        if (hw->isTouching && SHOT_CORNER.contains(hw->touchX, hw->touchY)) {
+            if (hw->touchPressed) { holdStart = millis(); holdFired = false; }
+            if (!holdFired && millis() - holdStart > SHOT_HOLD_MS) {
+                holdFired = true;
+                capture(SHOT_TRIGGER_GESTURE);
+            }
+        } else {
+            holdFired = true;   // Released or slid away: wait for a new press
+        }
+
+        if (!active) return;
+        if (failed) { finish(false); return; }
+
+        for (int n = 0; n < SHOT_STRIPS_PER_LOOP && nextRow > 0; n++) {
+            if (storage->getQueueDepth() > STORAGE_QUEUE_LEN - SHOT_QUEUE_HEADROOM) return;
+            writeStrip();
+        }
+        if (nextRow == 0 && last->isDone()) finish(last->ok() && !failed);
+    }
+};
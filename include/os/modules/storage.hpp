@@ -0,0 +1,507 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <SD.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include "hal/hal.hpp"
+#include "storage_tiers.hpp"
+
+#define STORAGE_QUEUE_LEN 16
+#define STORAGE_TASK_STACK 6144
+#define STORAGE_TASK_PRIORITY 1      // Below Wi-Fi/lwIP, above idle
+#define STORAGE_TASK_CORE 0          // The UI loop and DaaS run on core 1
+
+#define STORAGE_BLOCK_SIZE 512
+#define STORAGE_CACHE_BLOCKS 8       // 4 KB read cache
+#define STORAGE_READAHEAD_BLOCKS 2   // Prefetched after a sequential read
+
+#define STORAGE_WRITEBACK_FILES 4    // Files with buffered appends
+#define STORAGE_WRITEBACK_MAX 2048   // Buffered bytes per file before a flush
+#define STORAGE_FLUSH_MS 500         // Max age of buffered appends
+#define STORAGE_SYNC_MS 5000         // Flash -> SD background sync period
+
+enum StorageOp : uint8_t {
+    STORAGE_READ,      // [offset, offset + length) or the whole file with length 0
+    STORAGE_WRITE,     // Replaces the file content
+    STORAGE_APPEND,    // Coalesced into the write-back buffer
+    STORAGE_REMOVE,
+    STORAGE_EXISTS,
+    STORAGE_FLUSH      // Writes every buffered append out
+};
+
+enum StorageError : int32_t {
+    STORAGE_OK = 0,
+    STORAGE_ERR_NO_MEDIA = -1,
+    STORAGE_ERR_BUSY = -2,        // Queue full, request dropped
+    STORAGE_ERR_NOT_FOUND = -3,
+    STORAGE_ERR_IO = -4
+};
+
+struct StorageRequest;
+typedef std::shared_ptr<StorageRequest> StorageFuture;
+typedef std::function<void(const StorageRequest&)> StorageCallback;
+
+// One queued operation. The submitter keeps the StorageFuture to poll it,
+// the callback (if any) runs later on the loop task from update().
+struct StorageRequest {
+    StorageOp op;
+    String path;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    std::vector<uint8_t> data;    // Payload to write, or bytes read
+    String header;                // APPEND: written first when the file is new
+    uint32_t rotateAt = 0;        // APPEND: past this size the file moves to path.1 first
+    StorageCallback callback;
+
+    std::atomic<bool> done{false};
+    int32_t result = STORAGE_OK;  // Bytes transferred or a StorageError
+    uint32_t latency = 0;         // ms from submit to completion
+
+    // Holds the request while it is owned by the queues
+    StorageFuture self;
+    unsigned long submitted = 0;
+
+    bool isDone() const { return done; }
+    bool ok() const { return done && result >= 0; }
+    String text() const { return String((const char*)data.data(), data.size()); }
+
+    // Blocking wait, for boot-time code only: never call it from the loop
+    int32_t wait(uint32_t timeoutMs = portMAX_DELAY) const {
+        unsigned long start = millis();
+        while (!done) {
+            if (millis() - start > timeoutMs) return STORAGE_ERR_BUSY;
+            vTaskDelay(1);
+        }
+        return result;
+    }
+};
+
+// Asynchronous storage service (SD card behind a LittleFS flash tier).
+// The media are only ever touched by the storage task, so a card that stalls
+// for 100+ ms on a write costs the UI loop and DaaS nothing. Reads go
+// through a small LRU block cache with sequential read-ahead, appends are
+// coalesced per file and flushed when large enough or STORAGE_FLUSH_MS
+// after the first buffered byte. Operations on one path complete in
+// submission order, and reads see earlier buffered appends.
+class StorageService {
+private:
+    struct CacheBlock {
+        uint32_t pathHash;
+        uint32_t index;           // Block number in the file
+        uint16_t valid;           // Bytes filled, < STORAGE_BLOCK_SIZE at EOF
+        uint32_t lastUse;         // 0 = empty slot
+        uint8_t bytes[STORAGE_BLOCK_SIZE];
+    };
+
+    struct WriteBack {
+        String path;
+        String header;
+        uint32_t rotateAt;
+        std::vector<uint8_t> data;
+        unsigned long since;      // millis() of the first buffered byte
+    };
+
+    StorageTiers tiers;
+    QueueHandle_t requests = nullptr;
+    QueueHandle_t completions = nullptr;
+    TaskHandle_t task = nullptr;
+
+    // Owned by the storage task
+    CacheBlock cache[STORAGE_CACHE_BLOCKS];
+    uint32_t useClock = 0;
+    WriteBack pending[STORAGE_WRITEBACK_FILES];
+    File readFile;                // Kept open across sequential reads
+    String readPath = "";
+    uint32_t lastReadHash = 0;
+    uint32_t lastReadBlock = 0;
+    unsigned long lastSync = 0;
+
+    // Counters, written by the task and read by diagnostics
+    volatile uint32_t statRequests = 0;
+    volatile uint32_t statCacheHits = 0;
+    volatile uint32_t statFlushes = 0;
+    volatile uint32_t statMaxLatency = 0;
+
+    static uint32_t hashPath(const String& path) {
+        uint32_t h = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < path.length(); i++) { h ^= (uint8_t)path[i]; h *= 16777619u; }
+        return h;
+    }
+
+    // --- Block cache ---
+
+    CacheBlock* lookup(uint32_t hash, uint32_t index) {
+        for (auto& b : cache) {
+            if (b.lastUse && b.pathHash == hash && b.index == index) { b.lastUse = ++useClock; return &b; }
+        }
+        return nullptr;
+    }
+
+    CacheBlock* victim() {
+        CacheBlock* v = &cache[0];
+        for (auto& b : cache) {
+            if (b.lastUse < v->lastUse) v = &b;
+        }
+        return v;
+    }
+
+    void invalidate(const String& path) {
+        uint32_t hash = hashPath(path);
+        for (auto& b : cache) {
+            if (b.pathHash == hash) b.lastUse = 0;
+        }
+        if (readPath == path) { readFile.close(); readPath = ""; }
+    }
+
+    bool openForRead(const String& path) {
+        if (readPath == path && readFile) return true;
+        readFile.close();
+        readPath = "";
+        fs::FS* tier = tiers.readTier(path);
+        if (!tier) return false;
+        readFile = tier->open(path.c_str(), FILE_READ);
+        if (!readFile) return false;
+        readPath = path;
+        return true;
+    }
+
+    CacheBlock* load(uint32_t hash, uint32_t index) {
+        CacheBlock* b = lookup(hash, index);
+        if (b) { statCacheHits++; return b; }
+        if (!readFile.seek(index * STORAGE_BLOCK_SIZE)) return nullptr;
+
+        b = victim();
+        int n = readFile.read(b->bytes, STORAGE_BLOCK_SIZE);
+        if (n <= 0) { b->lastUse = 0; return nullptr; }
+        b->pathHash = hash;
+        b->index = index;
+        b->valid = n;
+        b->lastUse = ++useClock;
+        return b;
+    }
+
+    int32_t doRead(StorageRequest& req) {
+        flushPath(req.path); // Read-your-writes
+        tiers.syncTail(req.path);
+        if (!openForRead(req.path)) return STORAGE_ERR_NOT_FOUND;
+
+        uint32_t size = readFile.size();
+        if (req.offset >= size) return 0;
+        uint32_t len = req.length ? req.length : size - req.offset;
+        if (len > size - req.offset) len = size - req.offset;
+        req.data.resize(len);
+
+        uint32_t first = req.offset / STORAGE_BLOCK_SIZE;
+        uint32_t last = (req.offset + len - 1) / STORAGE_BLOCK_SIZE;
+
+        // Bulk reads would only flush the cache: go straight to the card
+        if (last - first >= STORAGE_CACHE_BLOCKS / 2) {
+            if (!readFile.seek(req.offset)) return STORAGE_ERR_IO;
+            int n = readFile.read(req.data.data(), len);
+            if (n < 0) return STORAGE_ERR_IO;
+            req.data.resize(n);
+            return n;
+        }
+
+        uint32_t hash = hashPath(req.path);
+        uint32_t copied = 0;
+        for (uint32_t i = first; i <= last && copied < len; i++) {
+            CacheBlock* b = load(hash, i);
+            if (!b) break;
+            uint32_t from = (i == first) ? req.offset % STORAGE_BLOCK_SIZE : 0;
+            if (from >= b->valid) break;
+            uint32_t n = min((uint32_t)b->valid - from, len - copied);
+            memcpy(req.data.data() + copied, b->bytes + from, n);
+            copied += n;
+        }
+        req.data.resize(copied);
+
+        // Sequential access: warm the next blocks while the caller digests these
+        bool sequential = (hash == lastReadHash) && (first == lastReadBlock || first == lastReadBlock + 1);
+        lastReadHash = hash;
+        lastReadBlock = last;
+        if (sequential) {
+            for (uint32_t i = last + 1; i <= last + STORAGE_READAHEAD_BLOCKS; i++) {
+                if ((uint64_t)i * STORAGE_BLOCK_SIZE >= size) break;
+                load(hash, i);
+            }
+        }
+        return copied;
+    }
+
+    int32_t doWrite(StorageRequest& req) {
+        // A full rewrite supersedes whatever was still buffered for the file
+        for (auto& wb : pending) {
+            if (wb.path == req.path) { wb.path = ""; wb.data.clear(); }
+        }
+        invalidate(req.path);
+
+        bool ok = store(req.path, false, "", req.data);
+        return ok ? (int32_t)req.data.size() : STORAGE_ERR_IO;
+    }
+
+    // Writes to the tier chosen for path; a failing card falls back to flash
+    bool store(const String& path, bool append, const String& header, const std::vector<uint8_t>& data) {
+        for (int attempt = 0; attempt < 2; attempt++) {
+            fs::FS* tier = append ? tiers.appendTier(path) : tiers.writeTier(path);
+            if (!tier) return false;
+
+            bool isNew = append && !tiers.exists(path);
+            File file = tier->open(path.c_str(), append ? FILE_APPEND : FILE_WRITE, true);
+            bool ok = (bool)file;
+            if (ok) {
+                if (isNew && header.length() > 0) ok = file.write((const uint8_t*)header.c_str(), header.length()) == header.length();
+                if (ok) ok = file.write(data.data(), data.size()) == data.size();
+                file.close();
+            }
+            if (ok) { tiers.written(tier, path, append); return true; }
+            if (tier != &SD) return false;
+            tiers.sdFailed(); // Retry once on flash
+        }
+        return false;
+    }
+
+    int32_t doAppend(StorageRequest& req) {
+        WriteBack* wb = nullptr;
+        for (auto& p : pending) {
+            if (p.path == req.path) { wb = &p; break; }
+        }
+        if (!wb) {
+            // Free slot, or make one by flushing the oldest file
+            for (auto& p : pending) {
+                if (p.path.length() == 0) { wb = &p; break; }
+                if (!wb || (long)(p.since - wb->since) < 0) wb = &p;
+            }
+            if (wb->path.length() > 0) flush(*wb);
+            wb->path = req.path;
+            wb->header = req.header;
+            wb->since = millis();
+        }
+        wb->rotateAt = req.rotateAt;
+
+        wb->data.insert(wb->data.end(), req.data.begin(), req.data.end());
+        if (wb->data.size() >= STORAGE_WRITEBACK_MAX) return flush(*wb) ? (int32_t)req.data.size() : STORAGE_ERR_IO;
+        return req.data.size();
+    }
+
+    bool flush(WriteBack& wb) {
+        if (wb.path.length() == 0) return true;
+        invalidate(wb.path);
+        // Rotated between batches, so a file only ever holds whole batches
+        if (wb.rotateAt && tiers.rotate(wb.path, wb.rotateAt)) invalidate(wb.path + ".1");
+
+        bool ok = store(wb.path, true, wb.header, wb.data);
+        statFlushes++;
+
+        wb.path = "";
+        wb.header = "";
+        wb.rotateAt = 0;
+        wb.data.clear();
+        wb.data.shrink_to_fit();
+        return ok;
+    }
+
+    void flushPath(const String& path) {
+        for (auto& wb : pending) {
+            if (wb.path == path) flush(wb);
+        }
+    }
+
+    bool flushAll() {
+        bool ok = true;
+        for (auto& wb : pending) ok &= flush(wb);
+        return ok;
+    }
+
+    // Ticks until the oldest buffered append or the next sync is due
+    TickType_t nextDeadline() const {
+        TickType_t wait = tiers.syncPending() ? pdMS_TO_TICKS(STORAGE_SYNC_MS) : portMAX_DELAY;
+        unsigned long now = millis();
+        for (const auto& wb : pending) {
+            if (wb.path.length() == 0) continue;
+            unsigned long age = now - wb.since;
+            TickType_t t = age >= STORAGE_FLUSH_MS ? 0 : pdMS_TO_TICKS(STORAGE_FLUSH_MS - age);
+            if (t < wait) wait = t;
+        }
+        return wait;
+    }
+
+    void flushExpired() {
+        unsigned long now = millis();
+        for (auto& wb : pending) {
+            if (wb.path.length() > 0 && now - wb.since >= STORAGE_FLUSH_MS) flush(wb);
+        }
+    }
+
+    void execute(StorageRequest& req) {
+        switch (req.op) {
+            case STORAGE_READ:   req.result = doRead(req); break;
+            case STORAGE_WRITE:  req.result = doWrite(req); break;
+            case STORAGE_APPEND: req.result = doAppend(req); break;
+            case STORAGE_REMOVE:
+                flushPath(req.path);
+                invalidate(req.path);
+                req.result = tiers.remove(req.path) ? STORAGE_OK : STORAGE_ERR_NOT_FOUND;
+                break;
+            case STORAGE_EXISTS:
+                // Buffered appends count: the file will exist once they land
+                req.result = tiers.exists(req.path) ? 1 : 0;
+                for (const auto& wb : pending) {
+                    if (wb.path == req.path) req.result = 1;
+                }
+                break;
+            case STORAGE_FLUSH:
+                req.result = flushAll() ? STORAGE_OK : STORAGE_ERR_IO;
+                break;
+        }
+    }
+
+    void complete(StorageRequest* req) {
+        req->latency = millis() - req->submitted;
+        if (req->latency > statMaxLatency) statMaxLatency = req->latency;
+        req->done = true;
+        // Callbacks and the final release happen on the loop task
+        if (xQueueSend(completions, &req, portMAX_DELAY) != pdTRUE) req->self.reset();
+    }
+
+    static void taskEntry(void* arg) {
+        StorageService* self = (StorageService*)arg;
+        StorageRequest* req = nullptr;
+        for (;;) {
+            if (xQueueReceive(self->requests, &req, self->nextDeadline()) == pdTRUE) {
+                self->statRequests++;
+                self->execute(*req);
+                self->complete(req);
+            }
+            self->flushExpired();
+            self->syncIdle();
+        }
+    }
+
+    // Copies one dirty flash file to SD when no request is waiting
+    void syncIdle() {
+        if (!tiers.syncPending() || uxQueueMessagesWaiting(requests) > 0) return;
+        if (millis() - lastSync < STORAGE_SYNC_MS) return;
+        lastSync = millis();
+        String synced = tiers.syncStep();
+        if (synced.length() > 0) invalidate(synced);
+    }
+
+    StorageFuture make(StorageOp op, const String& path, StorageCallback cb) {
+        StorageFuture req = std::make_shared<StorageRequest>();
+        req->op = op;
+        req->path = path;
+        req->callback = cb;
+        return req;
+    }
+
+    StorageFuture enqueue(StorageFuture req) {
+        req->submitted = millis();
+        req->self = req;
+        StorageRequest* raw = req.get();
+
+        if (!task) {
+            req->result = STORAGE_ERR_NO_MEDIA;
+        } else if (xQueueSend(requests, &raw, 0) == pdTRUE) {
+            return req; // Never block the caller on a busy card
+        } else {
+            req->result = STORAGE_ERR_BUSY;
+        }
+
+        // Rejected: complete it right away, the callback still runs from update()
+        req->done = true;
+        if (!completions || xQueueSend(completions, &raw, 0) != pdTRUE) req->self.reset();
+        return req;
+    }
+
+public:
+    // Mounts the flash tier and starts the storage task. Works without
+    // a card: files then live in flash until one shows up on a later boot.
+    bool begin(HardwareManager* hw) {
+        completions = xQueueCreate(STORAGE_QUEUE_LEN * 2, sizeof(StorageRequest*));
+        if (!tiers.begin(hw->sdAvailable)) return false;
+
+        memset(cache, 0, sizeof(cache));
+        requests = xQueueCreate(STORAGE_QUEUE_LEN, sizeof(StorageRequest*));
+        if (!requests || !completions) return false;
+        return xTaskCreatePinnedToCore(taskEntry, "storage", STORAGE_TASK_STACK, this,
+                                       STORAGE_TASK_PRIORITY, &task, STORAGE_TASK_CORE) == pdPASS;
+    }
+
+    bool isAvailable() const { return task != nullptr; }
+
+    // Runs the callbacks of completed requests, call once per loop
+    void update() {
+        StorageRequest* req = nullptr;
+        while (completions && xQueueReceive(completions, &req, 0) == pdTRUE) {
+            if (req->callback) req->callback(*req);
+            req->self.reset(); // May free the request
+        }
+    }
+
+    // Whole file with length 0
+    StorageFuture read(const String& path, uint32_t offset = 0, uint32_t length = 0, StorageCallback cb = nullptr) {
+        StorageFuture req = make(STORAGE_READ, path, cb);
+        req->offset = offset;
+        req->length = length;
+        return enqueue(req);
+    }
+
+    StorageFuture write(const String& path, const uint8_t* bytes, size_t len, StorageCallback cb = nullptr) {
+        StorageFuture req = make(STORAGE_WRITE, path, cb);
+        req->data.assign(bytes, bytes + len);
+        return enqueue(req);
+    }
+
+    StorageFuture write(const String& path, const String& text, StorageCallback cb = nullptr) {
+        return write(path, (const uint8_t*)text.c_str(), text.length(), cb);
+    }
+
+    // Completes once buffered: durability comes with the next flush.
+    // header is written first if the file does not exist yet (CSV logs).
+    StorageFuture append(const String& path, const String& text, const String& header = "", StorageCallback cb = nullptr) {
+        StorageFuture req = make(STORAGE_APPEND, path, cb);
+        req->data.assign((const uint8_t*)text.c_str(), (const uint8_t*)text.c_str() + text.length());
+        req->header = header;
+        return enqueue(req);
+    }
+
+    // rotateAt caps a growing log: once the file reaches it, it is renamed
+    // to path.1 (replacing the previous one) and a new file is started.
+    // Without a card its flash tail is capped (StorageTiers::trimTail).
+    StorageFuture append(const String& path, const uint8_t* bytes, size_t len, const String& header = "",
+                         StorageCallback cb = nullptr, uint32_t rotateAt = 0) {
+        StorageFuture req = make(STORAGE_APPEND, path, cb);
+        req->data.assign(bytes, bytes + len);
+        req->header = header;
+        req->rotateAt = rotateAt;
+        return enqueue(req);
+    }
+
+    StorageFuture remove(const String& path, StorageCallback cb = nullptr) {
+        return enqueue(make(STORAGE_REMOVE, path, cb));
+    }
+
+    // result is 1 when the file exists
+    StorageFuture exists(const String& path, StorageCallback cb = nullptr) {
+        return enqueue(make(STORAGE_EXISTS, path, cb));
+    }
+
+    StorageFuture flush(StorageCallback cb = nullptr) {
+        return enqueue(make(STORAGE_FLUSH, "", cb));
+    }
+
+    uint32_t getRequestCount() const { return statRequests; }
+    uint32_t getCacheHits() const { return statCacheHits; }
+    uint32_t getFlushCount() const { return statFlushes; }
+    uint32_t getMaxLatency() const { return statMaxLatency; }
+    uint8_t getQueueDepth() const { return requests ? uxQueueMessagesWaiting(requests) : 0; }
+    uint16_t getUnsyncedCount() const { return tiers.getDirtyCount(); }
+};
@@ -0,0 +1,362 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <SD.h>
+#include <LittleFS.h>
+#include <vector>
+#include "log.hpp"
+
+#define FLASH_PARTITION_LABEL "spiffs"   // huge_app.csv data partition
+#define FLASH_MOUNT_POINT "/flash"
+#define FLASH_SYNC_FILE "/.sync"         // Dirty list, survives reboots
+#define FLASH_ORIGIN_FILE "/.origin"     // SD size/mtime each clean flash copy was taken from
+#define FLASH_HOT_MAX 16384              // Larger files are never promoted to flash
+#define FLASH_COPY_CHUNK 512
+#define FLASH_TAIL_MAX 65536             // Cap of a rotated file's tail while the card is away
+
+// Internal flash (LittleFS) tier in front of the SD card.
+// Hot files (registry, config, icons, node config) live in flash and are
+// copied to SD in the background; without a card, or while the card keeps
+// failing, every file goes to flash. The dirty list is persisted, so files
+// written without a card reach SD on the next boot that has one.
+// A clean flash copy remembers the size/mtime of the SD file it matches;
+// if the card was edited elsewhere the SD copy wins and is promoted again.
+// Only used from the storage task.
+class StorageTiers {
+private:
+    struct Dirty {
+        String path;
+        bool tail;   // Flash holds bytes to append to the SD copy, not the whole file
+    };
+
+    struct Origin {
+        String path;
+        uint32_t size;
+        uint32_t mtime;
+    };
+
+    fs::FS* sd = nullptr;
+    fs::FS* flash = nullptr;
+    bool sdHealthy = false;
+    std::vector<String> hotPrefixes;
+    std::vector<Dirty> dirty;
+    std::vector<Origin> origins;
+
+    int dirtyIndex(const String& path) const {
+        for (size_t i = 0; i < dirty.size(); i++) {
+            if (dirty[i].path == path) return i;
+        }
+        return -1;
+    }
+
+    void saveDirty() {
+        File file = flash->open(FLASH_SYNC_FILE, FILE_WRITE);
+        if (!file) return;
+        for (const auto& d : dirty) {
+            file.print(d.tail ? "A " : "R ");
+            file.println(d.path);
+        }
+        file.close();
+    }
+
+    void loadDirty() {
+        dirty.clear();
+        File file = flash->open(FLASH_SYNC_FILE, FILE_READ);
+        if (!file) return;
+        while (file.available()) {
+            String line = file.readStringUntil('\n');
+            line.trim();
+            if (line.length() > 2) dirty.push_back({line.substring(2), line[0] == 'A'});
+        }
+        file.close();
+    }
+
+    int originIndex(const String& path) const {
+        for (size_t i = 0; i < origins.size(); i++) {
+            if (origins[i].path == path) return i;
+        }
+        return -1;
+    }
+
+    void saveOrigins() {
+        File file = flash->open(FLASH_ORIGIN_FILE, FILE_WRITE);
+        if (!file) return;
+        for (const auto& o : origins) file.printf("%lu %lu %s\n", (unsigned long)o.size, (unsigned long)o.mtime, o.path.c_str());
+        file.close();
+    }
+
+    void loadOrigins() {
+        origins.clear();
+        File file = flash->open(FLASH_ORIGIN_FILE, FILE_READ);
+        if (!file) return;
+        while (file.available()) {
+            String line = file.readStringUntil('\n');
+            line.trim();
+            int a = line.indexOf(' ');
+            int b = a < 0 ? -1 : line.indexOf(' ', a + 1);
+            if (b < 0) continue;
+            origins.push_back({line.substring(b + 1), (uint32_t)line.substring(0, a).toInt(),
+                               (uint32_t)line.substring(a + 1, b).toInt()});
+        }
+        file.close();
+    }
+
+    // Size/mtime of the SD copy, false if it is not there
+    bool sdStamp(const String& path, uint32_t& size, uint32_t& mtime) const {
+        File f = sd->open(path.c_str(), FILE_READ);
+        if (!f) return false;
+        size = f.size();
+        mtime = (uint32_t)f.getLastWrite();
+        f.close();
+        return true;
+    }
+
+    // The flash copy of path now matches the SD copy
+    void recordOrigin(const String& path) {
+        Origin o{path, 0, 0};
+        if (!sdStamp(path, o.size, o.mtime)) return;
+        int i = originIndex(path);
+        if (i >= 0) origins[i] = o;
+        else origins.push_back(o);
+        saveOrigins();
+    }
+
+    void dropOrigin(const String& path) {
+        int i = originIndex(path);
+        if (i < 0) return;
+        origins.erase(origins.begin() + i);
+        saveOrigins();
+    }
+
+    // After a mount with a card: clean flash copies whose SD file changed
+    // meanwhile (edited on a PC, restored from a backup) are dropped, so
+    // the next read promotes the SD content again
+    void revalidate() {
+        uint16_t stale = 0;
+        for (size_t i = 0; i < origins.size();) {
+            const Origin& o = origins[i];
+            uint32_t size, mtime;
+            bool changed = dirtyIndex(o.path) < 0 && sdStamp(o.path, size, mtime) && (size != o.size || mtime != o.mtime);
+            if (changed) {
+                flash->remove(o.path.c_str());
+                origins.erase(origins.begin() + i);
+                stale++;
+            } else {
+                i++;
+            }
+        }
+        if (stale) {
+            saveOrigins();
+            sysLog(LOG_FLASH_STALE, stale);
+        }
+    }
+
+    static bool copy(fs::FS* from, fs::FS* to, const String& path, const char* mode) {
+        File src = from->open(path.c_str(), FILE_READ);
+        if (!src) return false;
+        File dst = to->open(path.c_str(), mode, true);
+        if (!dst) { src.close(); return false; }
+
+        uint8_t buf[FLASH_COPY_CHUNK];
+        bool ok = true;
+        int n;
+        while (ok && (n = src.read(buf, sizeof(buf))) > 0) {
+            ok = dst.write(buf, n) == (size_t)n;
+        }
+        src.close();
+        dst.close();
+        return ok;
+    }
+
+    bool sdUsable() const { return sd && sdHealthy; }
+
+public:
+    bool begin(bool sdMounted) {
+        if (sdMounted) { sd = &SD; sdHealthy = true; }
+
+        // Formatted on first boot, and when the partition was resized
+        // (huge_app.csv): anything it held that SD lacks is lost then
+        bool mounted = LittleFS.begin(false, FLASH_MOUNT_POINT, 10, FLASH_PARTITION_LABEL);
+        if (!mounted && LittleFS.begin(true, FLASH_MOUNT_POINT, 10, FLASH_PARTITION_LABEL)) {
+            mounted = true;
+            sysLog(LOG_FLASH_FORMATTED);
+        }
+        if (mounted) {
+            flash = &LittleFS;
+            loadDirty();
+            loadOrigins();
+            sysLog(LOG_FLASH_MOUNTED, dirty.size());
+            if (sd) revalidate();
+        } else {
+            sysLog(LOG_FLASH_MISSING);
+        }
+
+        hotPrefixes = {"/apps.json", "/config/", "/icons/", "/nodes"};
+        return sd || flash;
+    }
+
+    void addHotPath(const String& prefix) { hotPrefixes.push_back(prefix); }
+
+    bool isHot(const String& path) const {
+        for (const auto& p : hotPrefixes) {
+            if (path.startsWith(p)) return true;
+        }
+        return false;
+    }
+
+    // Where the freshest copy of path is, nullptr if nowhere.
+    // Hot files found only on SD are promoted to flash on the way.
+    fs::FS* readTier(const String& path) {
+        int d = dirtyIndex(path);
+        bool tail = d >= 0 && dirty[d].tail;
+        bool inFlash = flash && flash->exists(path.c_str());
+
+        if (inFlash && !tail && (isHot(path) || d >= 0 || !sdUsable())) return flash;
+        if (sdUsable() && sd->exists(path.c_str())) {
+            if (flash && isHot(path) && !inFlash) {
+                uint32_t size = 0, mtime;
+                sdStamp(path, size, mtime);
+                if (size > 0 && size <= FLASH_HOT_MAX && copy(sd, flash, path, FILE_WRITE)) {
+                    recordOrigin(path);
+                    return flash;
+                }
+            }
+            return sd;
+        }
+        // Without the card an unsynced tail is all there is
+        return inFlash ? flash : nullptr;
+    }
+
+    // Tier a full rewrite of path goes to
+    fs::FS* writeTier(const String& path) const {
+        if (flash && (isHot(path) || !sdUsable())) return flash;
+        return sd;
+    }
+
+    // Tier an append goes to. Hot files are promoted first, so their
+    // flash copy stays whole.
+    fs::FS* appendTier(const String& path) {
+        fs::FS* tier = writeTier(path);
+        if (tier == flash && isHot(path) && !flash->exists(path.c_str())) readTier(path); // Promote first
+        return tier;
+    }
+
+    // Records a successful write to flash for the background sync.
+    // Appends creating a non-hot flash file are a tail for the SD copy;
+    // a full rewrite always replaces it.
+    void written(fs::FS* tier, const String& path, bool append) {
+        if (tier != flash) return;
+        int d = dirtyIndex(path);
+        dropOrigin(path);   // Flash is ahead of SD until the sync
+        if (d < 0) {
+            dirty.push_back({path, append && !isHot(path)});
+            saveDirty();
+        } else if (!append && dirty[d].tail) {
+            dirty[d].tail = false;
+            saveDirty();
+        }
+    }
+
+    // An SD operation failed: route everything to flash until a sync succeeds
+    void sdFailed() {
+        if (sdHealthy) sysLog(LOG_SD_ERRORS);
+        sdHealthy = false;
+    }
+
+    bool exists(const String& path) const {
+        if (flash && flash->exists(path.c_str())) return true;
+        return sdUsable() && sd->exists(path.c_str());
+    }
+
+    bool remove(const String& path) {
+        bool removed = false;
+        if (flash && flash->exists(path.c_str())) removed |= flash->remove(path.c_str());
+        if (sdUsable() && sd->exists(path.c_str())) removed |= sd->remove(path.c_str());
+        int d = dirtyIndex(path);
+        if (d >= 0) { dirty.erase(dirty.begin() + d); saveDirty(); }
+        if (flash) dropOrigin(path);
+        return removed;
+    }
+
+    bool isDirty(const String& path) const { return dirtyIndex(path) >= 0; }
+    bool syncPending() const { return sd && !dirty.empty(); }
+
+    // Copies one dirty file to SD. Returns the synced path, "" if nothing was done.
+    String syncStep() {
+        if (!syncPending()) return "";
+        String path = dirty[0].path;
+        return sync(0) ? path : "";
+    }
+
+    // Lands a pending tail on SD now, so the SD copy can be read whole
+    bool syncTail(const String& path) {
+        int d = dirtyIndex(path);
+        if (d < 0 || !dirty[d].tail) return true;
+        return sdUsable() && sync(d);
+    }
+
+    // Renames path to path.1, replacing it, once the SD copy reaches
+    // limit bytes. A pending flash tail lands first. Without a healthy
+    // card the tail is capped instead (see trimTail).
+    bool rotate(const String& path, uint32_t limit) {
+        if (!sdUsable()) { trimTail(path, limit); return false; }
+        if (!syncTail(path)) return false;
+        File f = sd->open(path.c_str(), FILE_READ);
+        if (!f) return false;
+        uint32_t size = f.size();
+        f.close();
+        if (size < limit) return false;
+
+        String old = path + ".1";
+        if (sd->exists(old.c_str())) sd->remove(old.c_str());
+        if (flash && flash->exists(old.c_str())) flash->remove(old.c_str());
+        if (!sd->rename(path.c_str(), old.c_str())) return false;
+        // A clean flash copy (hot path) would now shadow the new file
+        if (flash && flash->exists(path.c_str()) && !isDirty(path)) flash->remove(path.c_str());
+        return true;
+    }
+
+    // The flash tail of a rotated file shares the partition with the hot
+    // files: past FLASH_TAIL_MAX (or limit) it is dropped and a new one
+    // started, so a long run without a card cannot fill the flash tier
+    void trimTail(const String& path, uint32_t limit) {
+        int d = dirtyIndex(path);
+        if (!flash || d < 0 || !dirty[d].tail) return;
+        File f = flash->open(path.c_str(), FILE_READ);
+        if (!f) return;
+        uint32_t size = f.size();
+        f.close();
+        if (size < limit && size < FLASH_TAIL_MAX) return;
+
+        flash->remove(path.c_str());
+        dirty.erase(dirty.begin() + d);
+        saveDirty();
+        sysLog(LOG_FLASH_TAIL_DROPPED, path.c_str(), size);
+    }
+
+    bool hasFlash() const { return flash != nullptr; }
+    bool hasSD() const { return sd != nullptr; }
+    bool isSDHealthy() const { return sdUsable(); }
+    uint16_t getDirtyCount() const { return dirty.size(); }
+
+private:
+    bool sync(size_t idx) {
+        Dirty d = dirty[idx];
+        bool ok = copy(flash, sd, d.path, d.tail ? FILE_APPEND : FILE_WRITE);
+        if (!ok) {
+            sdFailed();
+            // Retry it last so one bad file does not block the others
+            dirty.erase(dirty.begin() + idx);
+            dirty.push_back(d);
+            return false;
+        }
+
+        sdHealthy = true;
+        // Tails are consumed; hot files keep their flash copy, others free it
+        if (d.tail || !isHot(d.path)) flash->remove(d.path.c_str());
+        else recordOrigin(d.path);
+        dirty.erase(dirty.begin() + idx);
+        saveDirty();
+        return true;
+    }
+};
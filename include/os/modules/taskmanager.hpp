@@ -34,16 +34,23 @@ class TaskManager {
                     if (systemApplications[i]->getPID() == 0){
                         // start the application if not started yet
                         systemApplications[i]->onStart();
+                        sysLog(LOG_APP_OPEN, app_id);
                     }
 
                     return systemApplications[i];
                 } 
             }
 
-            Serial.printf("TaskManager: System app with ID %d not registered.\n", app_id);
+            sysLog(LOG_APP_NOT_REGISTERED, app_id);
             return nullptr;
         }
 
+        // Every app slot, system apps first; nullptr for an empty slot
+        int appSlots() const { return MAX_SYS_APPS + MAX_OPENED_APPS; }
+        Application* appAt(int slot) const {
+            return slot < MAX_SYS_APPS ? systemApplications[slot] : openedApp[slot - MAX_SYS_APPS];
+        }
+
         Application* openApp(Application* &app) {
             for (int i = 0; i < MAX_OPENED_APPS; i++) {
                 if (openedApp[i] == nullptr) {
@@ -54,7 +61,7 @@ class TaskManager {
             }
 
             // if no slot found, we're a circular buffer, close the first one
-            printf("TaskManager: Max apps reached, closing oldest app.\n");
+            sysLog(LOG_APP_EVICTED);
             // for now the first one
             openedApp[0]->onExit();
             delete openedApp[0];
@@ -1,6 +1,19 @@
 #pragma once
+#include <vector>
 #include "../../hal/hal.hpp"
-#include "../../themes/theme_structure.hpp"   
+#include "../../themes/theme_structure.hpp"
+#include "animation.hpp"
+
+#define TOAST_QUEUE_MAX 6
+#define TOAST_H 40
+#define TOAST_SHADOW 2
+#define TOAST_RADIUS 20
+#define TOAST_PADDING 30
+#define TOAST_MARGIN_BOTTOM 60    // Rest position from the bottom edge, also the saved band
+#define TOAST_MIN_RESUME_MS 600   // A preempted toast with less time left is dropped
+#define TOAST_REFRESH_MS 250      // Coalesced repeats redraw the counter at most this often
+#define TOAST_SLIDE_IN_MS 220
+#define TOAST_SLIDE_OUT_MS 180
 
 enum ToastType {
     TOAST_INFO,
@@ -9,30 +22,127 @@ enum ToastType {
     TOAST_WARNING
 };
 
+struct Toast {
+    String message;
+    ToastType type;
+    uint32_t duration;
+    uint16_t count;      // Coalesced duplicates, shown as "x3"
+};
+
+// Overlay notifications. The band the toast slides through is read back
+// from the panel before it appears; every frame of the slide restores only
+// the rows it uncovered, so the app underneath is never repainted. The
+// panel watches the band: when the app redraws part of it (a list row, a
+// progress bar) that area is read back, so the slide never restores
+// stale pixels. Only the pixels the app wrote are read back, never the
+// toast between two writes. Pending toasts wait in a priority queue (errors first)
+// and duplicates are coalesced into a counter.
 class ToastManager {
-private:    
-    HardwareManager* hw;
-    ThemePalette* theme;
+private:
+    HardwareManager* hw = nullptr;
+    ThemePalette* theme = nullptr;
+    AnimationEngine* anim = nullptr;
 
-    // Stato del Toast
-    String message;
-    uint16_t msgColor;
-    uint16_t bgColor;
-    
-    bool isVisible = false;
+    std::vector<Toast> queue;            // Highest priority first, FIFO within a priority
+    Toast current;
+    bool isVisible = false;              // On screen or sliding
+    bool hiding = false;
     unsigned long startTime = 0;
-    unsigned long duration = 2000;
-    
-    // Animazione
-    float currentY;  // Posizione Y attuale
-    float targetY;   // Posizione Y target (visibile)
-    float hiddenY;   // Posizione Y nascosta (fuori schermo)
-    bool lastState = false;
-    bool changed = false;
+    unsigned long lastDraw = 0;
+    bool countChanged = false;
+
+    // Geometry: the toast moves vertically between restY and hiddenY
+    int restY = 0, hiddenY = 0;
+    int y = 0;                           // Top of the drawn toast
+    int toastW = 0;
+    String text;
+    int slide = -1;                      // Tween handle
+
+    // Saved background of the band [bandY, bandY + bandH) under the toast
+    std::vector<uint16_t> background;
+    int bgX = 0, bgW = 0, bandY = 0, bandH = 0;
+    bool bgStale = false;                // The app repainted under the toast
+    BandWatch watched;                   // Band pixels the app drew into
+
+    // Per row of toast + shadow: pixels left/right of the pills, which
+    // still show the previous frame when the toast moves a few rows
+    uint8_t leftGap[TOAST_H + TOAST_SHADOW];
+    uint8_t rightGap[TOAST_H + TOAST_SHADOW];
 
     // Costruttore privato (Singleton)
     ToastManager() {}
 
+    // The toast's own writes are not the app drawing into the band
+    class OwnDraw {
+    private:
+        BandWatch& watch;
+
+    public:
+        OwnDraw(BandWatch& w) : watch(w) { watch.paused++; }
+        ~OwnDraw() { watch.paused--; }
+    };
+
+    static uint8_t priority(ToastType type) {
+        switch (type) {
+            case TOAST_ERROR:   return 3;
+            case TOAST_WARNING: return 2;
+            case TOAST_SUCCESS: return 1;
+            case TOAST_INFO:
+            default:            return 0;
+        }
+    }
+
+    static bool same(const Toast& a, const String& msg, ToastType type) {
+        return a.type == type && a.message == msg;
+    }
+
+    void enqueue(const Toast& t, bool front = false) {
+        uint8_t p = priority(t.type);
+        size_t pos = 0;
+        while (pos < queue.size() && (priority(queue[pos].type) > p || (!front && priority(queue[pos].type) == p))) pos++;
+
+        if (queue.size() >= TOAST_QUEUE_MAX) {
+            if (pos >= queue.size()) return;   // Full of toasts that matter more
+            queue.pop_back();
+        }
+        queue.insert(queue.begin() + pos, t);
+    }
+
+    void colors(ToastType type, uint16_t& msgColor, uint16_t& bgColor) const {
+        switch (type) {
+            case TOAST_SUCCESS: msgColor = theme->TEXT_MAIN; bgColor = theme->ACCENT_PRIMARY; break;
+            case TOAST_ERROR:   msgColor = theme->TEXT_MAIN; bgColor = theme->ACCENT_ALERT; break;
+            case TOAST_WARNING: msgColor = theme->BG_COLOR;  bgColor = theme->ACCENT_WARN; break;
+            case TOAST_INFO:
+            default:            msgColor = theme->TEXT_MAIN; bgColor = theme->PANEL_SHADOW; break;
+        }
+    }
+
+    // Columns a rounded rect of height TOAST_H leaves empty on its row r
+    static int pillInset(int r) {
+        if (r < 0 || r >= TOAST_H) return 255;
+        int d = 2 * r + 1 - TOAST_H;                 // Twice the distance from the centre row
+        if (d < 0) d = -d;
+        int d2 = TOAST_RADIUS * TOAST_RADIUS * 4 - d * d;
+        int w = 0;
+        while (4 * (w + 1) * (w + 1) <= d2) w++;
+        return TOAST_RADIUS - w;
+    }
+
+    void computeGaps() {
+        for (int r = 0; r < TOAST_H + TOAST_SHADOW; r++) {
+            int body = pillInset(r);
+            int shadow = pillInset(r - TOAST_SHADOW);
+            // One spare column: restoring a pixel the pill then covers is harmless
+            leftGap[r] = min(min(body, shadow + TOAST_SHADOW), 254) + 1;
+            rightGap[r] = min(min(body + TOAST_SHADOW, shadow), 254) + 1;
+        }
+    }
+
+    String label() const {
+        return current.count > 1 ? current.message + "  x" + String(current.count) : current.message;
+    }
+
 public:
     // Accesso Singleton
     static ToastManager* getInstance() {
@@ -44,91 +154,210 @@ public:
     }
 
     // Inizializzazione (da chiamare nel Kernel::boot)
-    void init(HardwareManager* h, ThemePalette* t) {
+    void init(HardwareManager* h, ThemePalette* t, AnimationEngine* a) {
         hw = h;
         theme = t;
-        hiddenY = hw->tft.height() + 10; // Appena sotto lo schermo
-        targetY = hw->tft.height() - 60; // Posizione visibile (dal basso)
-        currentY = hiddenY;
+        anim = a;
+        hiddenY = hw->tft.height();                    // Just below the screen
+        restY = hw->tft.height() - TOAST_MARGIN_BOTTOM;
+        bandY = restY;
+        bandH = TOAST_MARGIN_BOTTOM;
+        y = hiddenY;
+        computeGaps();
+        // Largest band, allocated once: showing a toast never touches the heap
+        background.resize(hw->tft.width() * bandH);
+        watched.reserve(hw->tft.width(), bandH);
+        hw->tft.setBandWatch(&watched);
     }
 
     // Mostra un messaggio
     void show(String msg, ToastType type = TOAST_INFO, int ms = 2500) {
-        message = msg;
-        duration = ms;
-        startTime = millis();
-        isVisible = true;
-        changed = true;
-
+        // Repeat of the visible toast: bump the counter and restart its timer
+        if (isVisible && !hiding && same(current, msg, type)) {
+            current.count++;
+            if ((uint32_t)ms > current.duration) current.duration = ms;
+            startTime = millis();
+            countChanged = true;
+            return;
+        }
+        for (auto& q : queue) {
+            if (same(q, msg, type)) {
+                q.count++;
+                if ((uint32_t)ms > q.duration) q.duration = ms;
+                return;
+            }
+        }
 
-        // Imposta colori in base al tipo
-        switch (type) {
-            case TOAST_SUCCESS: msgColor = theme->TEXT_MAIN; bgColor = 0x07E0; /* Verde scuro */ break; // O usa theme->ACCENT_PRIMARY
-            case TOAST_ERROR:   msgColor = theme->TEXT_MAIN; bgColor = theme->ACCENT_ALERT; break;
-            case TOAST_WARNING: msgColor = theme->BG_COLOR;  bgColor = theme->ACCENT_WARN; break;
-            case TOAST_INFO:    
-            default:            msgColor = theme->TEXT_MAIN; bgColor = theme->PANEL_SHADOW; break;
+        Toast t = {msg, type, (uint32_t)ms, 1};
+        if (isVisible && !hiding && priority(type) > priority(current.type)) {
+            // Preempt: the interrupted toast resumes with the time it had left
+            uint32_t shown = millis() - startTime;
+            if (current.duration > shown + TOAST_MIN_RESUME_MS) {
+                current.duration -= shown;
+                enqueue(current, true);
+            }
+            finishHide();
         }
-        
-        // Se vuoi sovrascrivere con i colori del tema corrente per coerenza:
-        if (type == TOAST_SUCCESS) bgColor = theme->ACCENT_PRIMARY;
+        enqueue(t);
     }
 
     // Da chiamare nel loop principale (disegna sopra tutto)
     void update() {
         if (!hw) return;
-
         unsigned long now = millis();
 
-        // 1. Logica di Timeout
-        if (isVisible && (now - startTime > duration)) {
-            isVisible = false; // Inizia a nascondersi
+        if (bgStale) {
+            // The app repainted the screen: its new pixels are the background
+            bgStale = false;
+            if (hiding) finishHide();
+            else if (isVisible) { capture(); moveTo(restY); }
         }
 
-        // 2. Calcolo Animazione (Slide semplice)
-        float goal = isVisible ? targetY : hiddenY;
-        
+        // The app redrew part of the band: those pixels are the background now
+        if (isVisible && watched.hit()) refresh();
 
-        currentY = goal;
+        if (isVisible && !hiding && now - startTime > current.duration) startHide();
 
-        if (lastState != isVisible || changed)
-        {
-            draw();
-            changed = false;
+        if (!isVisible && !queue.empty()) {
+            current = queue.front();
+            queue.erase(queue.begin());
+            startTime = now;
+            countChanged = false;
+            isVisible = true;
+            capture();
+            slideTo(restY, TOAST_SLIDE_IN_MS, false);
+            return;
         }
-        lastState = isVisible;
+
+        if (isVisible && !hiding && countChanged && now - lastDraw >= TOAST_REFRESH_MS) {
+            // The label changed width: new band, drawn in place
+            anim->cancel(slide);
+            restoreRows(y, y + TOAST_H + TOAST_SHADOW);
+            y = hiddenY;
+            capture();
+            moveTo(restY);
+            countChanged = false;
+        }
+    }
+
+    // The app is about to repaint the whole screen. The toast is lifted now
+    // and drawn again over the new frame in update().
+    void invalidate() {
+        if (!isVisible || bgStale) return;
+        anim->cancel(slide);
+        restoreRows(y, y + TOAST_H + TOAST_SHADOW);
+        y = hiddenY;
+        bgStale = true;
     }
 
     bool isActive() const {
-        return isVisible || (currentY < hiddenY - 1);
+        return isVisible || !queue.empty();
     }
 
 private:
-    void draw() {
-        // Calcola larghezza dinamica in base al testo
-        int textW = hw->tft.textWidth(message);
-        int padding = 30;
-        int toastW = textW + padding;
-        int toastH = 40;
-        
-        // Centra orizzontalmente
+    void startHide() {
+        hiding = true;
+        slideTo(hiddenY, TOAST_SLIDE_OUT_MS, true);
+    }
+
+    void finishHide() {
+        anim->cancel(slide);
+        restoreRows(y, y + TOAST_H + TOAST_SHADOW);
+        y = hiddenY;
+        isVisible = false;
+        hiding = false;
+        watched.watch(uiRect(0, 0, 0, 0));
+    }
+
+    void slideTo(int target, uint32_t ms, bool thenHide) {
+        anim->cancel(slide);
+        slide = anim->start(y, target, ms, EASE_OUT_CUBIC, [this, thenHide](int32_t value, int32_t, bool last) {
+            moveTo(value);
+            if (last && thenHide) finishHide();
+        });
+        if (slide < 0) {
+            // No free tween: jump to the end
+            moveTo(target);
+            if (thenHide) finishHide();
+        }
+    }
+
+    // Measures the label and saves the band under the toast column
+    void capture() {
+        hw->tft.setFont(hw->fontRegular);
+        text = label();
+
         int screenW = hw->tft.width();
-        int x = (screenW - toastW) / 2;
-        int y = (int)currentY;
+        toastW = min(hw->tft.textWidth(text) + TOAST_PADDING, screenW - TOAST_SHADOW);
+        bgX = (screenW - toastW - TOAST_SHADOW) / 2;
+        bgW = toastW + TOAST_SHADOW;
+        hw->tft.readRect(bgX, bandY, bgW, bandH, background.data());
+        watched.watch(uiRect(bgX, bandY, bgW, bandH));
+    }
+
+    // Reads back the pixels of the band the app drew into, then puts the
+    // toast back over them
+    void refresh() {
+        watched.takeRuns([this](int x, int row, int w) {
+            hw->tft.readRect(x, row, w, 1, background.data() + (row - bandY) * bgW + (x - bgX));
+        });
+        if (y < hiddenY) draw(bgX, y);
+    }
+
+    // Puts back the saved rows in [from, to), clipped to the band
+    void restoreRows(int from, int to) {
+        if (from < bandY) from = bandY;
+        if (to > bandY + bandH) to = bandY + bandH;
+        if (to <= from || bgW == 0) return;
+        OwnDraw own(watched);
+        hw->tft.pushImage(bgX, from, bgW, to - from, (const uint16_t*)background.data() + (from - bandY) * bgW);
+    }
+
+    void restoreSpan(int row, int from, int to) {
+        if (row < bandY || row >= bandY + bandH || to <= from) return;
+        OwnDraw own(watched);
+        hw->tft.pushImage(bgX + from, row, to - from, 1, (const uint16_t*)background.data() + (row - bandY) * bgW + from);
+    }
+
+    // Region-limited frame: the rows the toast left are restored whole,
+    // the rows it still covers only around the rounded ends
+    void moveTo(int newY) {
+        int h = TOAST_H + TOAST_SHADOW;
+        if (newY != y) {
+            if (newY < y) restoreRows(max(newY + h, y), y + h);
+            else restoreRows(y, min(newY, y + h));
+
+            int from = max(y, newY), to = min(y, newY) + h;
+            for (int row = from; row < to; row++) {
+                int r = row - newY;
+                restoreSpan(row, 0, min((int)leftGap[r], bgW));
+                restoreSpan(row, max(bgW - rightGap[r], 0), bgW);
+            }
+        }
+        y = newY;
+        if (y < hiddenY) draw(bgX, y);
+        lastDraw = millis();
+    }
+
+    void draw(int x, int y) {
+        OwnDraw own(watched);
+        uint16_t msgColor, bgColor;
+        colors(current.type, msgColor, bgColor);
 
         // 1. Ombra (Shadow)
-        hw->tft.fillRoundRect(x + 2, y + 2, toastW, toastH, 20, 0x0000); // Nero puro o PANEL_SHADOW
+        hw->tft.fillRoundRect(x + TOAST_SHADOW, y + TOAST_SHADOW, toastW, TOAST_H, 20, 0x0000);
 
         // 2. Sfondo Toast
-        hw->tft.fillRoundRect(x, y, toastW, toastH, 20, bgColor);
+        hw->tft.fillRoundRect(x, y, toastW, TOAST_H, 20, bgColor);
 
         // 3. Bordo sottile (Opzionale, per eleganza su sfondo scuro)
-        hw->tft.drawRoundRect(x, y, toastW, toastH, 20, theme->TEXT_MUTED);
+        hw->tft.drawRoundRect(x, y, toastW, TOAST_H, 20, theme->TEXT_MUTED);
 
         // 4. Testo
+        hw->tft.setFont(hw->fontRegular);
         hw->tft.setTextColor(msgColor, bgColor);
         hw->tft.setTextDatum(textdatum_t::middle_center);
-        hw->tft.drawString(message, x + toastW/2, y + toastH/2);
+        hw->tft.drawString(text, x + toastW/2, y + TOAST_H/2);
         hw->tft.setTextDatum(textdatum_t::top_left); // Reset
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+
+#include "console.hpp"
+
+#define TRACE_SLOTS 64   // Power of two
+#define TRACE_LINE_MAX 64 // TX space an echoed line may need (bytes)
+
+enum TraceEvent : uint8_t {
+    TRACE_TOUCH,       // arg: x << 16 | y
+    TRACE_LAUNCH,      // arg: app id
+    TRACE_DDO,         // arg: typeset
+    TRACE_NODE,        // arg: low 32 bits of the DIN
+    TRACE_SLOW_LOOP,   // arg: loop time (us)
+    TRACE_MARK,        // arg: free, from the console
+    TRACE_OVERRUN      // arg: phase << 24 | time over budget (ms)
+};
+
+static const char* const TRACE_NAMES[] = {"touch", "launch", "ddo", "node", "slow", "mark", "over"};
+
+struct TraceEntry {
+    uint32_t us;
+    uint32_t arg;
+    uint8_t event;
+    uint8_t app;    // Foreground app id, 0xFF if none
+};
+
+// Last TRACE_SLOTS kernel events, always recorded: cheap enough for the
+// loop and there when a field tech asks what just happened. With echo
+// on each event is also printed, from the loop (echoPending) rather than
+// from the callback that recorded it: DaaS callbacks never wait for Serial.
+class TraceRing {
+private:
+    TraceEntry ring[TRACE_SLOTS];
+    uint32_t head = 0;   // Events recorded so far
+    uint32_t echoed = 0; // Events the echo has printed
+    bool echo = false;
+
+public:
+    void setEcho(bool on) {
+        echo = on;
+        echoed = head;
+    }
+    bool isEchoing() const { return echo; }
+
+    // Prints the events recorded since the last call while the TX buffer
+    // has room; the ones the ring overwrote meanwhile are counted
+    void echoPending(Print& to) {
+        if (!echo) return;
+        if (head - echoed > TRACE_SLOTS) {
+            if (to.availableForWrite() < TRACE_LINE_MAX) return;
+            to.printf("TRACE %lu events not echoed\n", (unsigned long)(head - echoed - TRACE_SLOTS));
+            echoed = head - TRACE_SLOTS;
+        }
+        while (echoed != head && to.availableForWrite() >= TRACE_LINE_MAX) {
+            print(to, ring[echoed++ & (TRACE_SLOTS - 1)]);
+        }
+    }
+
+    void record(TraceEvent event, uint8_t app, uint32_t arg) {
+        TraceEntry& e = ring[head & (TRACE_SLOTS - 1)];
+        e.us = micros();
+        e.arg = arg;
+        e.event = event;
+        e.app = app;
+        head++;
+    }
+
+    uint32_t count() const { return head < TRACE_SLOTS ? head : TRACE_SLOTS; }
+
+    // i = 0 is the oldest entry still held
+    const TraceEntry& get(uint32_t i) const {
+        return ring[(head - count() + i) & (TRACE_SLOTS - 1)];
+    }
+
+    static void print(Print& to, const TraceEntry& e) {
+        to.printf("TRACE %10lu %-6s app=%u arg=%lu\n", (unsigned long)e.us, TRACE_NAMES[e.event], e.app,
+                  (unsigned long)e.arg);
+    }
+
+    // The entries held now, a line per console step. Entries the ring
+    // overwrites before their line is printed are skipped.
+    bool dump(DiagConsole& console) const {
+        uint32_t first = head - count(), last = head;
+        return console.startLines(last - first + 1, [this, first, last](uint16_t i, Print& to) {
+            uint32_t seq = first + i;
+            if (seq == last) to.printf("TRACE %lu events\n", (unsigned long)last);
+            else if (head - seq <= TRACE_SLOTS) print(to, ring[seq & (TRACE_SLOTS - 1)]);
+        });
+    }
+};
@@ -0,0 +1,346 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "storage.hpp"
+#include "trace.hpp"
+#include "screenshot.hpp"
+#include "toastmessages.hpp"
+#include "log.hpp"
+
+#define WD_APP_BUDGETS 8                // Per-app overrides of the app phase budget
+#define WD_RECORDS 4                    // Kept in RTC memory, power of two
+#define WD_TRACE_KEEP 16                // Trace entries saved with a record
+#define WD_HANG_MS 3000                 // A phase still running this long is recorded from the monitor task
+#define WD_MONITOR_MS 250
+#define WD_MONITOR_STACK 2560
+#define WD_REPEAT_COUNT 3               // Overruns of one app within the window make it an offender
+#define WD_REPEAT_WINDOW_MS 60000
+#define WD_TOAST_COOLDOWN_MS 60000
+#define WD_LOG_FILE "/stalls.csv"
+#define WD_PERSIST_MS 10000             // One row per app + phase this often at most, hangs always
+#define WD_PERSIST_KEYS 8
+#define WD_MAGIC 0x57444C47             // "WDLG"
+
+enum LoopPhase : uint8_t {
+    PHASE_DAAS,       // doPerform
+    PHASE_SERVICES,   // Network, storage callbacks, liveness, bench, metrics, scanner
+    PHASE_CONSOLE,
+    PHASE_INPUT,      // Touch, Wi-Fi state machine
+    PHASE_APP,        // onUpdate of the foreground app
+    PHASE_UI,         // Toasts, animations, latency flush
+    PHASE_DIAG,       // Mirror, screenshots
+    PHASE_BACKGROUND, // One background tick or event delivery, per app
+    PHASE_COUNT,
+    PHASE_IDLE = 0xFF
+};
+
+static const char* const PHASE_NAMES[PHASE_COUNT] = {"daas", "services", "console", "input", "app", "ui", "diag", "bg"};
+
+// Default budgets (us). The app phase budget applies to apps without an override.
+static const uint32_t PHASE_BUDGET_US[PHASE_COUNT] = {20000, 10000, 5000, 10000, 30000, 20000, 8000, 10000};
+
+struct StallRecord {
+    uint32_t uptimeMs;
+    uint32_t elapsedUs;      // Phase duration, or time so far for a hang
+    uint32_t budgetUs;
+    uint32_t stackFree;      // Loop task stack high-water mark (bytes)
+    uint8_t phase;
+    uint8_t app;
+    uint8_t hang;            // Recorded by the monitor while the phase was still running
+    uint8_t persisted;       // Already in WD_LOG_FILE
+    char appName[12];
+    uint8_t traceCount;
+    TraceEntry trace[WD_TRACE_KEEP];
+};
+
+// Survives a software reset and a watchdog reset (not a power cycle)
+struct StallLog {
+    uint32_t magic;
+    uint32_t head;           // Records written so far
+    StallRecord records[WD_RECORDS];
+    uint32_t check;          // magic ^ head: the RTC content is ours
+};
+
+// Software loop watchdog. The kernel marks each phase of its loop; a
+// phase that outlasts its budget (per phase, or per app for the app
+// phase) is recorded with the app, the overrun, a stack high-water sample
+// and the tail of the trace ring. Records go to RTC memory first, so they
+// survive the reset a hard hang ends in, then to WD_LOG_FILE. A monitor
+// task records a phase still running after WD_HANG_MS. An app that
+// overruns WD_REPEAT_COUNT times within the window gets a toast and, if
+// that trigger is on, a screenshot. Rows for the same app and phase are
+// written at most every WD_PERSIST_MS; the next row counts the ones
+// skipped, so an app overrunning every loop does not flood the card.
+class StallWatchdog {
+private:
+    StorageService* storage = nullptr;
+    TraceRing* trace = nullptr;
+    ScreenshotService* screenshots = nullptr;
+    TaskHandle_t loopTask = nullptr;
+    TaskHandle_t monitor = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    uint32_t phaseBudget[PHASE_COUNT];
+    struct AppBudget { uint8_t app; uint32_t us; };
+    AppBudget appBudgets[WD_APP_BUDGETS];
+    uint8_t appBudgetCount = 0;
+
+    // Current phase, read by the monitor task
+    volatile uint8_t phase = PHASE_IDLE;
+    volatile uint8_t app = 0xFF;
+    const char* volatile appName = "";
+    volatile uint32_t phaseStart = 0;
+    volatile bool hangRecorded = false;
+    volatile int hangSlot = -1;
+
+    struct Offender { uint8_t app; uint8_t count; uint32_t windowStart; uint32_t lastToast; };
+    Offender offenders[WD_APP_BUDGETS];
+
+    struct PersistKey { uint8_t app; uint8_t phase; uint16_t skipped; uint32_t last; };
+    PersistKey persistKeys[WD_PERSIST_KEYS];
+    uint32_t overruns = 0;
+    uint32_t changeVersion = 0;
+
+    // One instance for every translation unit, left alone by the startup code
+    static StallLog& rtcLog() {
+        static RTC_NOINIT_ATTR StallLog log;
+        return log;
+    }
+
+    uint32_t budgetOf(uint8_t p, uint8_t appId) const {
+        if (p == PHASE_APP) {
+            for (uint8_t i = 0; i < appBudgetCount; i++) if (appBudgets[i].app == appId) return appBudgets[i].us;
+        }
+        return phaseBudget[p];
+    }
+
+    // Next RTC slot, oldest overwritten. Caller holds the lock.
+    int fill(uint8_t p, uint8_t appId, const char* name, uint32_t elapsed, uint32_t budget, bool hang) {
+        StallLog& rtc = rtcLog();
+        int slot = rtc.head & (WD_RECORDS - 1);
+        rtc.head++;
+        rtc.check = rtc.magic ^ rtc.head;
+        StallRecord& r = rtc.records[slot];
+        r.uptimeMs = millis();
+        r.elapsedUs = elapsed;
+        r.budgetUs = budget;
+        r.stackFree = loopTask ? uxTaskGetStackHighWaterMark(loopTask) : 0;
+        r.phase = p;
+        r.app = appId;
+        r.hang = hang;
+        r.persisted = 0;
+        strncpy(r.appName, name ? name : "", sizeof(r.appName) - 1);
+        r.appName[sizeof(r.appName) - 1] = '\0';
+        uint32_t n = trace->count() < WD_TRACE_KEEP ? trace->count() : WD_TRACE_KEEP;
+        for (uint32_t i = 0; i < n; i++) r.trace[i] = trace->get(trace->count() - n + i);
+        r.traceCount = n;
+        return slot;
+    }
+
+    // Rate limit per app + phase: false if the row is skipped (counted
+    // into the next one written, in skipped)
+    bool persistDue(const StallRecord& r, uint16_t& skipped) {
+        uint32_t now = millis();
+        PersistKey* k = nullptr;
+        for (auto& p : persistKeys) if (p.app == r.app && p.phase == r.phase) { k = &p; break; }
+        if (!k) {
+            // Reuse the least recently written key
+            k = &persistKeys[0];
+            for (auto& p : persistKeys) if (p.last < k->last) k = &p;
+            *k = {r.app, r.phase, 0, 0};
+        } else if (!r.hang && now - k->last < WD_PERSIST_MS) {
+            if (k->skipped < 0xFFFF) k->skipped++;
+            return false;
+        }
+        skipped = k->skipped;
+        k->skipped = 0;
+        k->last = now;
+        return true;
+    }
+
+    // One CSV row per record, the trace as event@us:arg separated by spaces
+    void persist(StallRecord& r, uint32_t bootTag, uint16_t skipped = 0) {
+        char line[96];
+        snprintf(line, sizeof(line), "%lu,%lu,%u,%s,%s,%lu,%lu,%lu,%u,%u,", (unsigned long)bootTag, (unsigned long)r.uptimeMs,
+                 r.app, r.appName, r.phase < PHASE_COUNT ? PHASE_NAMES[r.phase] : "?", (unsigned long)r.elapsedUs,
+                 (unsigned long)r.budgetUs, (unsigned long)r.stackFree, r.hang, skipped);
+        String row = line;
+        for (uint8_t i = 0; i < r.traceCount && i < WD_TRACE_KEEP; i++) {
+            const TraceEntry& e = r.trace[i];
+            snprintf(line, sizeof(line), "%s%s@%lu:%lu", i ? " " : "", e.event <= TRACE_OVERRUN ? TRACE_NAMES[e.event] : "?",
+                     (unsigned long)e.us, (unsigned long)e.arg);
+            row += line;
+        }
+        row += "\n";
+        storage->append(WD_LOG_FILE, row, "boot,uptime_ms,app,name,phase,elapsed_us,budget_us,stack_free,hang,skipped,trace\n");
+        r.persisted = 1;
+    }
+
+    void offend(uint8_t appId, const char* name) {
+        uint32_t now = millis();
+        Offender* o = nullptr;
+        for (auto& f : offenders) if (f.app == appId) { o = &f; break; }
+        if (!o) {
+            // Reuse the slot with the oldest window
+            o = &offenders[0];
+            for (auto& f : offenders) if (f.windowStart < o->windowStart) o = &f;
+            *o = {appId, 0, now, 0};
+        }
+        if (now - o->windowStart > WD_REPEAT_WINDOW_MS) { o->windowStart = now; o->count = 0; }
+        if (++o->count < WD_REPEAT_COUNT) return;
+        if (o->lastToast && now - o->lastToast < WD_TOAST_COOLDOWN_MS) return;
+        o->lastToast = now;
+        ToastManager::getInstance()->show(String(name) + " is stalling the system", TOAST_WARNING, 2500);
+        if (screenshots) screenshots->capture(SHOT_TRIGGER_WATCHDOG);
+    }
+
+    void close(uint32_t now) {
+        if (phase == PHASE_IDLE) return;
+        uint32_t elapsed = now - phaseStart;
+        uint32_t budget = budgetOf(phase, app);
+        if (elapsed <= budget) return;
+
+        overruns++;
+        changeVersion++;
+        portENTER_CRITICAL(&lock);
+        int slot;
+        if (hangRecorded && hangSlot >= 0) {
+            slot = hangSlot;
+            rtcLog().records[slot].elapsedUs = elapsed;   // The hang ended: its real length
+        } else {
+            slot = fill(phase, app, appName, elapsed, budget, false);
+        }
+        portEXIT_CRITICAL(&lock);
+
+        trace->record(TRACE_OVERRUN, app, (uint32_t)phase << 24 | ((elapsed - budget) / 1000 & 0xFFFFFF));
+        sysLog(LOG_WD_OVERRUN, appName, PHASE_NAMES[phase], elapsed / 1000, budget / 1000);
+        StallRecord& r = rtcLog().records[slot];
+        uint16_t skipped = 0;
+        if (persistDue(r, skipped)) persist(r, 0, skipped);
+        else r.persisted = 1;   // Counted in the next row, not written at the next boot
+        if (phase == PHASE_APP || phase == PHASE_BACKGROUND) offend(app, appName);
+    }
+
+    static void monitorEntry(void* arg) {
+        StallWatchdog* self = (StallWatchdog*)arg;
+        for (;;) {
+            vTaskDelay(pdMS_TO_TICKS(WD_MONITOR_MS));
+            self->checkHang();
+        }
+    }
+
+    void checkHang() {
+        uint8_t p = phase;
+        if (p == PHASE_IDLE || hangRecorded) return;
+        uint32_t elapsed = micros() - phaseStart;
+        if (elapsed < WD_HANG_MS * 1000UL) return;
+        portENTER_CRITICAL(&lock);
+        if (!hangRecorded && phase == p) {
+            hangSlot = fill(p, app, appName, elapsed, budgetOf(p, app), true);
+            hangRecorded = true;
+        }
+        portEXIT_CRITICAL(&lock);
+    }
+
+public:
+    // Call from the loop task. Records left in RTC memory by the previous
+    // boot (a hang that ended in a reset) are written out now.
+    void init(StorageService* s, TraceRing* t, ScreenshotService* shots) {
+        storage = s;
+        trace = t;
+        screenshots = shots;
+        loopTask = xTaskGetCurrentTaskHandle();
+        for (uint8_t p = 0; p < PHASE_COUNT; p++) phaseBudget[p] = PHASE_BUDGET_US[p];
+        for (auto& o : offenders) o = {0xFF, 0, 0, 0};
+        for (auto& k : persistKeys) k = {0xFF, 0xFF, 0, 0};
+
+        StallLog& rtc = rtcLog();
+        if (rtc.magic != WD_MAGIC || rtc.check != (rtc.magic ^ rtc.head)) {
+            memset(&rtc, 0, sizeof(rtc));
+            rtc.magic = WD_MAGIC;
+            rtc.check = rtc.magic;
+        } else {
+            uint32_t reason = (uint32_t)esp_reset_reason();
+            for (auto& r : rtc.records) {
+                if (r.uptimeMs != 0 && !r.persisted) persist(r, reason);
+            }
+        }
+
+        xTaskCreatePinnedToCore(monitorEntry, "loopwd", WD_MONITOR_STACK, this, configMAX_PRIORITIES - 2, &monitor, 0);
+    }
+
+    // Marks the start of a phase (and the end of the previous one)
+    void enter(LoopPhase p, uint8_t appId = 0xFF, const char* name = "") {
+        uint32_t now = micros();
+        close(now);
+        app = appId;
+        appName = name;
+        hangRecorded = false;
+        hangSlot = -1;
+        phaseStart = now;
+        phase = p;
+    }
+
+    // End of the loop: closes the last phase
+    void idle() {
+        close(micros());
+        phase = PHASE_IDLE;
+    }
+
+    void setPhaseBudget(LoopPhase p, uint32_t us) { if (p < PHASE_COUNT) phaseBudget[p] = us; }
+    uint32_t getPhaseBudget(LoopPhase p) const { return phaseBudget[p]; }
+
+    bool setAppBudget(uint8_t appId, uint32_t us) {
+        for (uint8_t i = 0; i < appBudgetCount; i++) {
+            if (appBudgets[i].app == appId) { appBudgets[i].us = us; return true; }
+        }
+        if (appBudgetCount >= WD_APP_BUDGETS) return false;
+        appBudgets[appBudgetCount++] = {appId, us};
+        return true;
+    }
+    uint32_t getAppBudget(uint8_t appId) const { return budgetOf(PHASE_APP, appId); }
+
+    uint32_t overrunCount() const { return overruns; }
+    uint32_t version() const { return changeVersion; }
+
+    // The records still in RTC memory as a listing for
+    // Console::startLines, newest last: per record a summary line and
+    // WD_TRACE_KEEP trace lines, then the overrun count. Lines are taken
+    // against the head at the start, so a stall recorded meanwhile does
+    // not shift them.
+    uint32_t head() const { return rtcLog().head; }
+    uint16_t lineCount(uint32_t head) const {
+        uint32_t n = head < WD_RECORDS ? head : WD_RECORDS;
+        return n * (1 + WD_TRACE_KEEP) + 1;
+    }
+
+    void printLine(uint32_t head, uint16_t i, Print& out) const {
+        uint32_t n = head < WD_RECORDS ? head : WD_RECORDS;
+        if (i >= n * (1 + WD_TRACE_KEEP)) {
+            out.printf("WD overruns=%lu\n", (unsigned long)overruns);
+            return;
+        }
+        const StallRecord& r = rtcLog().records[(head - n + i / (1 + WD_TRACE_KEEP)) & (WD_RECORDS - 1)];
+        uint8_t t = i % (1 + WD_TRACE_KEEP);
+        if (t == 0) {
+            out.printf("WD %lums app=%u(%s) phase=%s took=%luus budget=%luus stack=%lu%s\n", (unsigned long)r.uptimeMs,
+                       r.app, r.appName, r.phase < PHASE_COUNT ? PHASE_NAMES[r.phase] : "?", (unsigned long)r.elapsedUs,
+                       (unsigned long)r.budgetUs, (unsigned long)r.stackFree, r.hang ? " hang" : "");
+        } else if (t <= r.traceCount) {
+            out.print("   ");
+            TraceRing::print(out, r.trace[t - 1]);
+        }
+    }
+
+    void clear() {
+        StallLog& rtc = rtcLog();
+        portENTER_CRITICAL(&lock);
+        memset(rtc.records, 0, sizeof(rtc.records));
+        rtc.head = 0;
+        rtc.check = rtc.magic;
+        portEXIT_CRITICAL(&lock);
+    }
+};
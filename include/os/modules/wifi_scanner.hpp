@@ -0,0 +1,153 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define WIFI_CACHE_MAX 24
+#define WIFI_CACHE_MAX_AGE_MS 60000   // Networks not seen for a minute are dropped
+#define WIFI_SCAN_CHANNELS 13
+#define WIFI_SCAN_MS_PER_CHANNEL 120
+#define WIFI_SCAN_PAUSE_MS 5000       // Between two sweeps in continuous mode
+
+struct WifiNetwork {
+    char ssid[33];
+    uint8_t bssid[6];     // Strongest access point seen for this SSID
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t encryption;   // wifi_auth_mode_t
+    unsigned long seenAt;
+};
+
+// Non-blocking Wi-Fi scanner.
+// Sweeps one channel per async scan, so results stream into the cache
+// while the sweep is running and the loop (and DaaS) keeps going.
+// The cache holds one entry per SSID, sorted by RSSI, and forgets
+// networks that were not seen for WIFI_CACHE_MAX_AGE_MS.
+class WifiScanner {
+private:
+    WifiNetwork cache[WIFI_CACHE_MAX];
+    uint8_t count = 0;
+    uint32_t changeVersion = 0;
+
+    bool active = false;        // Sweeping (or pausing between sweeps)
+    bool continuous = false;
+    bool scanPending = false;   // Async scan of `channel` in flight
+    uint8_t channel = 0;        // Channel being swept, 0 = between sweeps
+    unsigned long sweepEnd = 0;
+
+    void startChannel() {
+        scanPending = WiFi.scanNetworks(true, false, false, WIFI_SCAN_MS_PER_CHANNEL, channel) == WIFI_SCAN_RUNNING;
+    }
+
+    void merge(int n) {
+        unsigned long now = millis();
+        for (int i = 0; i < n; i++) {
+            String ssid = WiFi.SSID(i);
+            if (ssid.length() == 0) continue; // Hidden network
+
+            int8_t rssi = WiFi.RSSI(i);
+            int slot = find(ssid.c_str());
+            if (slot < 0) {
+                if (count < WIFI_CACHE_MAX) slot = count++;
+                else if (rssi > cache[count - 1].rssi) slot = count - 1; // Replace the weakest
+                else continue;
+                strlcpy(cache[slot].ssid, ssid.c_str(), sizeof(cache[slot].ssid));
+                cache[slot].rssi = -128;
+            }
+
+            WifiNetwork& net = cache[slot];
+            // Same AP or a stronger one for this SSID: take its coordinates
+            if (rssi >= net.rssi || memcmp(net.bssid, WiFi.BSSID(i), 6) == 0) {
+                net.rssi = rssi;
+                memcpy(net.bssid, WiFi.BSSID(i), 6);
+                net.channel = WiFi.channel(i);
+                net.encryption = WiFi.encryptionType(i);
+            }
+            net.seenAt = now;
+            changeVersion++;
+        }
+        sort();
+    }
+
+    void sort() {
+        // Insertion sort: the cache is tiny and almost sorted already
+        for (int i = 1; i < count; i++) {
+            WifiNetwork net = cache[i];
+            int j = i - 1;
+            while (j >= 0 && cache[j].rssi < net.rssi) { cache[j + 1] = cache[j]; j--; }
+            cache[j + 1] = net;
+        }
+    }
+
+    void ageOut() {
+        unsigned long now = millis();
+        int kept = 0;
+        for (int i = 0; i < count; i++) {
+            if (now - cache[i].seenAt <= WIFI_CACHE_MAX_AGE_MS) cache[kept++] = cache[i];
+        }
+        if (kept != count) { count = kept; changeVersion++; }
+    }
+
+public:
+    // Starts a sweep of every channel; continuous keeps sweeping until stop()
+    void start(bool keepScanning = true) {
+        continuous = keepScanning;
+        if (active) return;
+        active = true;
+        channel = 1;
+        startChannel();
+    }
+
+    void stop() {
+        active = false;
+        continuous = false;
+        // An in-flight channel scan is harvested by update() and then ignored
+    }
+
+    void update() {
+        if (scanPending) {
+            int16_t n = WiFi.scanComplete();
+            if (n == WIFI_SCAN_RUNNING) return;
+
+            scanPending = false;
+            if (n > 0 && active) merge(n);
+            WiFi.scanDelete();
+
+            if (!active) return;
+            if (++channel <= WIFI_SCAN_CHANNELS) { startChannel(); return; }
+
+            // Sweep complete
+            channel = 0;
+            sweepEnd = millis();
+            ageOut();
+            if (!continuous) active = false;
+            changeVersion++;
+            return;
+        }
+
+        if (active && channel == 0 && millis() - sweepEnd > WIFI_SCAN_PAUSE_MS) {
+            channel = 1;
+            startChannel();
+        } else if (active && channel != 0) {
+            // Scan refused (e.g. driver busy connecting): try the next channel
+            if (++channel <= WIFI_SCAN_CHANNELS) startChannel();
+            else { channel = 0; sweepEnd = millis(); }
+        }
+    }
+
+    int find(const char* ssid) const {
+        for (int i = 0; i < count; i++) {
+            if (strcmp(cache[i].ssid, ssid) == 0) return i;
+        }
+        return -1;
+    }
+
+    bool isScanning() const { return active && channel != 0; }
+    uint8_t getChannel() const { return channel; }
+    uint8_t size() const { return count; }
+
+    // nullptr when idx is out of range
+    const WifiNetwork* get(int idx) const { return (idx >= 0 && idx < count) ? &cache[idx] : nullptr; }
+
+    // Bumped whenever the cache content or the sweep state changes
+    uint32_t version() const { return changeVersion; }
+};
@@ -0,0 +1,321 @@
+#pragma once
+#include <Arduino.h>
+#include <string.h>
+
+#include "storage.hpp"
+
+// Lexicon built by tools/build_lexicon.py (a DAWG: a trie with shared
+// suffixes), mapped straight from the asset pack.
+//
+//   LexiconHeader
+//   uint32_t edges[edgeCount]   bits 0-7 char, 8 last sibling, 9 ends a word,
+//                               10-31 first edge of the child node (0 = leaf)
+//   uint8_t info[edgeCount]     high nibble: frequency class of the word
+//                               ending here, low nibble: best class below
+//
+// A node is a run of sibling edges; edge 0 is a sentinel so 0 means "none".
+
+#define LEXICON_MAGIC 0x58454C4D   // "MLEX"
+#define LEXICON_VERSION 1
+
+#define WORD_MAX 24                // Longest word handled, terminator included
+#define WORD_SUGGESTIONS 3
+#define WORD_SEARCH_BUDGET 600     // Edges visited per lookup at most
+#define LEARNED_WORDS 48
+#define LEARNED_WORD_LEN 16
+#define LEARNED_FILE "/config/words.bin"
+#define LEARNED_MAGIC 0x4452574D   // "MWRD"
+#define LEARNED_SAVE_MS 30000      // Learned words are written at most this often
+
+struct LexiconHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t maxLength;
+    uint16_t reserved;
+    uint32_t edgeCount;
+    uint32_t root;        // First edge of the root node
+};
+
+static_assert(sizeof(LexiconHeader) == 16, "lexicon header layout");
+
+struct LearnedWord {
+    char word[LEARNED_WORD_LEN];
+    uint16_t count;
+};
+
+static_assert(sizeof(LearnedWord) == 18, "learned word layout");
+
+// Word completion for the virtual keyboard.
+// The prefix state is kept per character (lexicon node and learned-word
+// match mask), so each keystroke costs one step and backspace just pops.
+// Everything lives in fixed arrays: no allocation while typing.
+class WordPredictor {
+private:
+    const uint32_t* edges = nullptr;
+    const uint8_t* info = nullptr;
+    uint32_t edgeCount = 0;
+    uint32_t root = 0;
+
+    StorageService* storage = nullptr;
+    LearnedWord learned[LEARNED_WORDS];
+    uint8_t learnedCount = 0;
+    bool learnedDirty = false;     // Counted since the last save
+    unsigned long dirtySince = 0;
+
+    // Prefix state: node[i] / mask[i] after i characters
+    char prefix[WORD_MAX];
+    uint8_t prefixLen = 0;
+    uint32_t node[WORD_MAX];       // UINT32_MAX: left the lexicon
+    uint64_t mask[WORD_MAX];       // Learned words starting with the prefix
+
+    char results[WORD_SUGGESTIONS][WORD_MAX];
+    uint8_t resultScore[WORD_SUGGESTIONS];
+    uint8_t resultCount = 0;
+    uint32_t changeVersion = 0;
+
+    static char lower(char c) { return (c >= 'A' && c <= 'Z') ? c + 32 : c; }
+    static bool isWordChar(char c) { c = lower(c); return (c >= 'a' && c <= 'z') || c == '\''; }
+
+    // Edge of node first labelled c, 0 if none
+    uint32_t child(uint32_t first, char c) const {
+        if (first == 0 || first >= edgeCount) return 0;
+        for (uint32_t e = first; e < edgeCount; e++) {
+            if ((char)(edges[e] & 0xFF) == c) return e;
+            if (edges[e] & 0x100) break;
+        }
+        return 0;
+    }
+
+    void stepTo(uint8_t len) {
+        char c = prefix[len - 1];
+        uint32_t from = node[len - 1];
+        uint32_t e = (from == UINT32_MAX) ? 0 : child(from, c);
+        node[len] = e ? (edges[e] >> 10) : UINT32_MAX;   // 0: a word with nothing after it
+
+        uint64_t m = 0;
+        for (uint8_t i = 0; i < learnedCount && len <= LEARNED_WORD_LEN; i++) {
+            if ((mask[len - 1] >> i & 1) && lower(learned[i].word[len - 1]) == c) m |= (uint64_t)1 << i;
+        }
+        mask[len] = m;
+    }
+
+    bool hasResult(const char* w) const {
+        for (uint8_t i = 0; i < resultCount; i++) if (strcmp(results[i], w) == 0) return true;
+        return false;
+    }
+
+    // Keeps the best WORD_SUGGESTIONS, ties go to the earlier offer
+    void offer(const char* w, uint8_t score) {
+        if (hasResult(w)) return;
+        int pos = resultCount;
+        while (pos > 0 && resultScore[pos - 1] < score) pos--;
+        if (pos >= WORD_SUGGESTIONS) return;
+        int last = resultCount < WORD_SUGGESTIONS ? resultCount : WORD_SUGGESTIONS - 1;
+        for (int i = last; i > pos; i--) {
+            memcpy(results[i], results[i - 1], WORD_MAX);
+            resultScore[i] = resultScore[i - 1];
+        }
+        strncpy(results[pos], w, WORD_MAX - 1);
+        results[pos][WORD_MAX - 1] = 0;
+        resultScore[pos] = score;
+        if (resultCount < WORD_SUGGESTIONS) resultCount++;
+    }
+
+    // Bounded depth-first walk below the prefix node, pruned by the best
+    // class of each subtree once the result list is full
+    void searchLexicon() {
+        uint32_t start = node[prefixLen];
+        if (!edges || start == UINT32_MAX || start == 0) return;
+
+        char word[WORD_MAX];
+        memcpy(word, prefix, prefixLen);
+        uint32_t at[WORD_MAX];
+        int depth = 0;
+        at[0] = start;
+        int budget = WORD_SEARCH_BUDGET;
+
+        while (depth >= 0 && budget-- > 0) {
+            uint32_t e = at[depth];
+            if (e == 0 || e >= edgeCount) {
+                // Node done: next sibling one level up
+                if (--depth < 0) break;
+                uint32_t up = at[depth];
+                at[depth] = (edges[up] & 0x100) ? 0 : up + 1;
+                continue;
+            }
+
+            uint32_t edge = edges[e];
+            uint8_t best = info[e] & 0x0F;
+            bool full = resultCount == WORD_SUGGESTIONS;
+            int len = prefixLen + depth + 1;
+
+            if (!(full && best <= resultScore[WORD_SUGGESTIONS - 1]) && len < WORD_MAX) {
+                word[len - 1] = (char)(edge & 0xFF);
+                if (edge & 0x200) {
+                    word[len] = 0;
+                    offer(word, info[e] >> 4);
+                }
+                uint32_t next = edge >> 10;
+                if (next != 0 && len + 1 < WORD_MAX) {
+                    at[++depth] = next;
+                    continue;
+                }
+            }
+            at[depth] = (edge & 0x100) ? 0 : e + 1;
+        }
+    }
+
+    void refresh() {
+        char before[WORD_SUGGESTIONS][WORD_MAX];
+        uint8_t beforeCount = resultCount;
+        memcpy(before, results, sizeof(results));
+        resultCount = 0;
+
+        // Learned words first: they are what this operator actually sends
+        uint64_t m = mask[prefixLen];
+        for (uint8_t i = 0; i < learnedCount; i++) {
+            if (!(m >> i & 1) || strlen(learned[i].word) <= prefixLen) continue;
+            offer(learned[i].word, 16 + (learned[i].count < 239 ? learned[i].count : 239));
+        }
+        if (prefixLen > 0) searchLexicon();
+
+        if (beforeCount != resultCount || memcmp(before, results, sizeof(results[0]) * resultCount) != 0) changeVersion++;
+    }
+
+    void saveLearned() {
+        learnedDirty = false;
+        if (!storage) return;
+        uint8_t buf[8 + sizeof(learned)];
+        uint32_t magic = LEARNED_MAGIC;
+        uint16_t count = learnedCount;
+        memcpy(buf, &magic, 4);
+        memcpy(buf + 4, &count, 2);
+        memset(buf + 6, 0, 2);
+        memcpy(buf + 8, learned, sizeof(LearnedWord) * learnedCount);
+        storage->write(LEARNED_FILE, buf, 8 + sizeof(LearnedWord) * learnedCount);
+    }
+
+    void learnWord(const char* w, uint8_t len) {
+        if (len < 2 || len >= LEARNED_WORD_LEN) return;
+        for (uint8_t i = 0; i < learnedCount; i++) {
+            if (strncmp(learned[i].word, w, len) == 0 && learned[i].word[len] == 0) {
+                if (learned[i].count < 0xFFFF) learned[i].count++;
+                return;
+            }
+        }
+        uint8_t slot = learnedCount;
+        if (learnedCount < LEARNED_WORDS) learnedCount++;
+        else {
+            // Full: the least used word makes room
+            slot = 0;
+            for (uint8_t i = 1; i < learnedCount; i++) if (learned[i].count < learned[slot].count) slot = i;
+        }
+        memset(learned[slot].word, 0, LEARNED_WORD_LEN);
+        memcpy(learned[slot].word, w, len);
+        learned[slot].count = 1;
+    }
+
+public:
+    WordPredictor() { clear(); }
+
+    // blob: lexicon from the asset pack (optional), storage: learned words
+    bool begin(const uint8_t* blob, uint32_t len, StorageService* s) {
+        storage = s;
+        edges = nullptr;
+        if (blob && len >= sizeof(LexiconHeader)) {
+            const LexiconHeader* h = (const LexiconHeader*)blob;
+            if (h->magic == LEXICON_MAGIC && h->version == LEXICON_VERSION &&
+                len >= sizeof(LexiconHeader) + (uint64_t)h->edgeCount * 5 && h->root < h->edgeCount) {
+                edges = (const uint32_t*)(blob + sizeof(LexiconHeader));
+                info = blob + sizeof(LexiconHeader) + h->edgeCount * 4;
+                edgeCount = h->edgeCount;
+                root = h->root;
+            }
+        }
+        clear();
+
+        if (storage) {
+            storage->read(LEARNED_FILE, 0, 0, [this](const StorageRequest& req) {
+                if (!req.ok() || req.data.size() < 8) return;
+                uint32_t magic;
+                uint16_t count;
+                memcpy(&magic, req.data.data(), 4);
+                memcpy(&count, req.data.data() + 4, 2);
+                if (magic != LEARNED_MAGIC || count > LEARNED_WORDS || req.data.size() < 8 + count * sizeof(LearnedWord)) return;
+                memcpy(learned, req.data.data() + 8, count * sizeof(LearnedWord));
+                for (uint8_t i = 0; i < count; i++) learned[i].word[LEARNED_WORD_LEN - 1] = 0;
+                learnedCount = count;
+                clear();
+            });
+        }
+        return edges != nullptr;
+    }
+
+    bool hasLexicon() const { return edges != nullptr; }
+
+    // Starts a new word
+    void clear() {
+        prefixLen = 0;
+        node[0] = root;
+        mask[0] = learnedCount >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << learnedCount) - 1);
+        refresh();
+    }
+
+    // Follows the word being typed (the text after the last separator).
+    // Only the characters that differ from the previous call are stepped:
+    // one step per keystroke, none for a backspace.
+    void sync(const char* word, uint8_t len) {
+        if (len >= WORD_MAX) len = WORD_MAX - 1;
+        uint8_t common = 0;
+        while (common < len && common < prefixLen && lower(word[common]) == prefix[common]) common++;
+        if (common == prefixLen && common == len) return;
+
+        prefixLen = common;
+        for (uint8_t i = common; i < len; i++) {
+            if (!isWordChar(word[i])) { prefixLen = 0; break; }
+            prefix[i] = lower(word[i]);
+            prefixLen = i + 1;
+            stepTo(prefixLen);
+        }
+        refresh();
+    }
+
+    // Counts the words of a sent message
+    void learn(const String& text) {
+        char w[LEARNED_WORD_LEN];
+        uint8_t len = 0;
+        bool skip = false;
+        for (size_t i = 0; i <= text.length(); i++) {
+            char c = i < text.length() ? text[i] : ' ';
+            if (isWordChar(c)) {
+                if (len < LEARNED_WORD_LEN - 1) w[len++] = lower(c);
+                else skip = true; // Too long to be worth storing
+                continue;
+            }
+            if (len > 0 && !skip) learnWord(w, len);
+            len = 0;
+            skip = false;
+        }
+        // Saved by update(), not after every message
+        if (!learnedDirty) dirtySince = millis();
+        learnedDirty = true;
+        clear();
+    }
+
+    // From the loop: writes the learned words LEARNED_SAVE_MS after the
+    // first unsaved message
+    void update() {
+        if (learnedDirty && millis() - dirtySince >= LEARNED_SAVE_MS) saveLearned();
+    }
+
+    // Writes pending learned words now (the app that learns is closing)
+    void flush() {
+        if (learnedDirty) saveLearned();
+    }
+
+    uint8_t count() const { return resultCount; }
+    const char* get(uint8_t i) const { return i < resultCount ? results[i] : ""; }
+
+    // Bumped when the suggestions change: the strip redraws only then
+    uint32_t version() const { return changeVersion; }
+};
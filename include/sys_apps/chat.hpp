@@ -2,8 +2,15 @@
 #include "os/interfaces/application_interface.hpp"
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include "daas/daas.hpp"
+#include "os/modules/node_directory.hpp"
+#include "os/modules/toastmessages.hpp"
+
+#define MSG_TYPESET 1          // DDO typeset of chat messages
+#define MSG_PENDING_MAX 16     // Senders with a message waiting
+#define MSG_PULLS_PER_TICK 4   // Background: messages taken per tick
 
 // Strutture Dati
 struct Contact {
@@ -11,6 +18,117 @@ struct Contact {
     String lastMsg;
     bool isOnline;
     uint16_t color; // Colore avatar
+    uint16_t unread;
+    bool dirty;     // Row must be redrawn
+};
+
+// Contact model keyed by DIN, kept in sync with the kernel NodeDirectory
+// through its change journal. Per-contact state (last message, unread
+// counter, color) survives node churn, and only touched rows are marked
+// dirty so the list can be repainted row by row.
+class ContactStore {
+private:
+    std::vector<Contact> rows;
+    std::unordered_map<din_t, uint16_t> index; // DIN -> row
+    uint32_t syncedVersion = 0;
+    uint16_t drawnRows = 0; // Rows on screen at the last redraw
+
+    static uint16_t avatarColor(din_t din) {
+        static const uint16_t palette[] = {0xE46C, 0x04F9, 0x9492, 0xF800, 0x07E0, 0x9000};
+        return palette[(din ^ (din >> 44)) % (sizeof(palette) / sizeof(palette[0]))];
+    }
+
+    void add(din_t din, bool online) {
+        if (index.count(din)) return;
+        index[din] = rows.size();
+        rows.push_back({din, "", online, avatarColor(din), 0, true});
+    }
+
+    void refresh(const NodeRecord* rec) {
+        if (!rec) return;
+        Contact* c = find(rec->din);
+        bool online = rec->state & NODE_ONLINE;
+        if (c && c->isOnline != online) { c->isOnline = online; c->dirty = true; }
+    }
+
+    // Swap-remove: O(1), only the vacated row and the old last row change
+    void remove(din_t din) {
+        auto it = index.find(din);
+        if (it == index.end()) return;
+        uint16_t idx = it->second;
+        index.erase(it);
+
+        uint16_t last = rows.size() - 1;
+        if (idx != last) {
+            rows[idx] = rows[last];
+            rows[idx].dirty = true;
+            index[rows[idx].din] = idx;
+        }
+        rows.pop_back();
+    }
+
+    void rebuild(const NodeDirectory& dir) {
+        // Drop contacts the directory forgot, keep state of the others
+        for (int i = rows.size() - 1; i >= 0; i--) {
+            if (!dir.contains(rows[i].din)) remove(rows[i].din);
+        }
+        dir.forEach([this](const NodeRecord& rec) {
+            add(rec.din, rec.state & NODE_ONLINE);
+            refresh(&rec);
+        });
+    }
+
+public:
+    // Applies the directory changes made since the last call.
+    // Returns true if any row changed.
+    bool sync(const NodeDirectory& dir) {
+        if (dir.version() == syncedVersion) return false;
+
+        bool replayed = dir.changesSince(syncedVersion, [this, &dir](const NodeChange& c) {
+            const NodeRecord* rec = dir.find(c.din);
+            if (c.kind == NODE_REMOVED) remove(c.din);
+            else if (c.kind == NODE_ADDED && rec) add(c.din, rec->state & NODE_ONLINE);
+            else refresh(rec);
+        });
+        if (!replayed) rebuild(dir);
+
+        syncedVersion = dir.version();
+        return true;
+    }
+
+    Contact* find(din_t din) {
+        auto it = index.find(din);
+        return it == index.end() ? nullptr : &rows[it->second];
+    }
+
+    int indexOf(din_t din) const {
+        auto it = index.find(din);
+        return it == index.end() ? -1 : it->second;
+    }
+
+    void setLastMessage(din_t din, const String& msg, bool countUnread) {
+        Contact* c = find(din);
+        if (!c) return;
+        c->lastMsg = msg;
+        if (countUnread) c->unread++;
+        c->dirty = true;
+    }
+
+    void markRead(din_t din) {
+        Contact* c = find(din);
+        if (c && c->unread) { c->unread = 0; c->dirty = true; }
+    }
+
+    void markAllDirty() {
+        for (auto& c : rows) c.dirty = true;
+    }
+
+    // Rows that disappeared since the last redraw, [size(), drawnRows)
+    uint16_t staleRows() const { return drawnRows > rows.size() ? drawnRows - rows.size() : 0; }
+    void rowsDrawn() { drawnRows = rows.size(); }
+
+    uint16_t size() const { return rows.size(); }
+    Contact& operator[](uint16_t idx) { return rows[idx]; }
 };
 
 struct Message {
@@ -29,13 +147,13 @@ enum MsgState {
 class MessengerApp : public Application {
 private:
     MsgState state = MSG_CONTACTS;
-    bool needsRedraw = true;
     
     // Dati
-    std::vector<Contact> contacts;
+    ContactStore contacts;
     std::vector<Message> currentChat; // Messaggi della chat aperta
     
-    int selectedContactIdx = -1;
+    din_t selectedDin = 0; // Chat aperta (per DIN: le righe possono spostarsi)
+    std::vector<din_t> pendingDins; // Mittenti con un DDO in attesa (eventi dal kernel)
     int scrollY = 0; // Per lo scorrimento della lista contatti
     
     // Simulazione risposta automatica
@@ -45,20 +163,19 @@ private:
     // Layout Costanti
     const int ROW_H = 70; // Altezza riga contatto
     const int INPUT_H = 50; // Altezza barra input
+    const int LIST_START = 50;
 
     DaasAPI* getDaas() {
         return system->getNode();
     }
 public:
     MessengerApp() : Application(2) {} // ID arbitrario 2
+    const char* getName() const override { return "Messenger"; }
 
 
-    void updateContactList() {
-        contacts.clear();
-        auto nodes = system->getNode()->listNodes();
-        for (u32_t idx = 0; idx < nodes.size(); idx++) {
-            contacts.push_back({nodes[idx], "Ciao!", true, 0x07E0}); // Verde
-        }
+    // Applies node directory deltas, true if some row must be redrawn
+    bool updateContactList() {
+        return contacts.sync(system->getNodeDirectory());
     }
 
     void onStart() override {
@@ -76,29 +193,30 @@ public:
             */
     }
 
-    void onUpdate() override {
-        // Gestione Risposta Automatica (Bot)
-        uint32_t pulls = 0;
-        if (state == MSG_CHAT) {
+    // Receiving goes on behind other apps: new messages update the contacts
+    bool runsInBackground() const override { return true; }
 
-            DDO* ddo;
-
-            if (system->getNode()->pull(contacts[selectedContactIdx].din, &ddo) == ERROR_NONE) {
-                char* buffer = new char[ddo->getPayloadSize() + 1];
-                memcpy(buffer, ddo->getPayloadPtr(), ddo->getPayloadSize());
-                buffer[ddo->getPayloadSize()] = '\0'; 
+    void onEvent(const AppEvent& event) override {
+        if (event.type != APP_EVENT_DDO || event.typeset != MSG_TYPESET) return;
+        for (din_t din : pendingDins) if (din == event.din) return;
+        if (pendingDins.size() < MSG_PENDING_MAX) pendingDins.push_back(event.din);
+    }
 
-                currentChat.push_back({String(buffer), false, millis()});
-                contacts[selectedContactIdx].lastMsg = String(buffer);
+    // No drawing here: the rows are only marked, the list repaints them when shown
+    void onBackgroundTick() override {
+        updateContactList();
+        int received = receivePending(MSG_PULLS_PER_TICK, false);
+        if (received > 0) ToastManager::getInstance()->show("Messenger: " + String(received) + " new", TOAST_INFO, 1500);
+    }
 
-                delete[] buffer;
-                delete ddo;
-                needsRedraw = true;
-            }
-        }
+    void onUpdate() override {
+        if (state == MSG_CHAT && receive(selectedDin, true)) needsRedraw = true;
+        bool received = receivePending(MSG_PULLS_PER_TICK, state == MSG_CHAT) > 0;
+        if (received && state == MSG_CHAT) needsRedraw = true;
 
         switch (state) {
             case MSG_CONTACTS:
+                if ((updateContactList() || received) && !needsRedraw) drawDirtyContacts();
                 if (needsRedraw) { drawContactList(); needsRedraw = false; }
                 handleContactsTouch();
                 break;
@@ -112,7 +230,7 @@ public:
                 // Gestione logica tastiera
                 auto kb = system->getKeyboard();
                 if (needsRedraw) { 
-                    kb->begin("Scrivi a " + String(contacts[selectedContactIdx].din));
+                    kb->begin("Scrivi a " + String(selectedDin), "", true);
                     needsRedraw = false; 
                 }
                 
@@ -129,7 +247,11 @@ public:
         }
     }
 
-    void onExit() override { }
+    void onExit() override {
+        // Closed from the chat page (Home, task switch): the peer is no longer hot
+        if (selectedDin != 0) system->getLiveness()->setActive(selectedDin, false);
+        system->getPredictor()->flush();
+    }
     void onDraw() override {
         updateContactList();
      }
@@ -142,54 +264,78 @@ private:
         hw->tft.fillScreen(theme->BG_COLOR);
         drawHeader("MESSAGES");
 
-        int listStart = 50;
+        contacts.markAllDirty();
+        drawDirtyContacts();
+    }
+
+    // Ridisegna solo le righe cambiate (e cancella quelle rimosse)
+    void drawDirtyContacts() {
         int w = hw->tft.width();
 
-        // Disegna lista contatti
         for (int i = 0; i < contacts.size(); i++) {
-            int y = listStart + (i * ROW_H) - scrollY;
-            
-            // Ottimizzazione: Disegna solo se visibile nello schermo
-            if (y + ROW_H < 50 || y > hw->tft.height()) continue;
-
-            // 1. Riga Sfondo (Cliccabile)
-            hw->tft.drawLine(20, y + ROW_H - 1, w - 20, y + ROW_H - 1, theme->PANEL_SHADOW);
-
-            // 2. Avatar (Cerchio con iniziale)
-            int avR = 22; // Raggio avatar
-            int avX = 35;
-            int avY = y + ROW_H/2;
-            
-            hw->tft.fillCircle(avX, avY, avR, contacts[i].color);
-            hw->tft.setTextColor(theme->TEXT_MAIN, contacts[i].color);
+            if (!contacts[i].dirty) continue;
+            contacts[i].dirty = false;
+
+            int y = LIST_START + (i * ROW_H) - scrollY;
+            if (y + ROW_H < LIST_START || y > hw->tft.height()) continue;
+
+            hw->tft.fillRect(0, y, w, ROW_H, theme->BG_COLOR);
+            drawContactRow(contacts[i], y);
+        }
+
+        for (int i = contacts.size(); i < contacts.size() + contacts.staleRows(); i++) {
+            int y = LIST_START + (i * ROW_H) - scrollY;
+            if (y + ROW_H < LIST_START || y > hw->tft.height()) continue;
+            hw->tft.fillRect(0, y, w, ROW_H, theme->BG_COLOR);
+        }
+        contacts.rowsDrawn();
+    }
+
+    void drawContactRow(const Contact& c, int y) {
+        int w = hw->tft.width();
+
+        // 1. Riga Sfondo (Cliccabile)
+        hw->tft.drawLine(20, y + ROW_H - 1, w - 20, y + ROW_H - 1, theme->PANEL_SHADOW);
+
+        // 2. Avatar (Cerchio con iniziale)
+        int avR = 22; // Raggio avatar
+        int avX = 35;
+        int avY = y + ROW_H/2;
+        
+        hw->tft.fillCircle(avX, avY, avR, c.color);
+        hw->tft.setTextColor(theme->TEXT_MAIN, c.color);
+        hw->tft.setTextDatum(textdatum_t::middle_center);
+        hw->tft.setFont(hw->fontRegular);
+        String initial = String(c.din).substring(0, 1);
+        hw->tft.drawString(initial, avX, avY);
+
+        // Pallino Online
+        if (c.isOnline) {
+            hw->tft.fillCircle(avX + 15, avY + 15, 6, theme->BG_COLOR); // Bordo
+            hw->tft.fillCircle(avX + 15, avY + 15, 4, 0x07E0); // Verde (Online)
+        }
+
+        // 3. Testi
+        int textX = 70;
+        hw->tft.setTextDatum(textdatum_t::top_left);
+        
+        // Nome
+        hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
+        hw->tft.drawString(String(c.din), textX, y + 15);
+        
+        // Ultimo Messaggio (Grigio e troncato)
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        String msg = c.lastMsg;
+        if (msg.length() > 20) msg = msg.substring(0, 19) + "...";
+        hw->tft.drawString(msg, textX, y + 40);
+
+        // Badge messaggi non letti (a destra)
+        if (c.unread > 0) {
+            hw->tft.fillCircle(w - 25, y + 22, 10, theme->ACCENT_PRIMARY);
+            hw->tft.setTextColor(theme->TEXT_MAIN, theme->ACCENT_PRIMARY);
             hw->tft.setTextDatum(textdatum_t::middle_center);
-            hw->tft.setFont(&fonts::efontCN_14);
-            String initial = String(contacts[i].din).substring(0, 1);
-            hw->tft.drawString(initial, avX, avY);
-
-            // Pallino Online
-            if (contacts[i].isOnline) {
-                hw->tft.fillCircle(avX + 15, avY + 15, 6, theme->BG_COLOR); // Bordo
-                hw->tft.fillCircle(avX + 15, avY + 15, 4, 0x07E0); // Verde (Online)
-            }
-
-            // 3. Testi
-            int textX = 70;
+            hw->tft.drawString(c.unread > 9 ? "9+" : String(c.unread), w - 25, y + 22);
             hw->tft.setTextDatum(textdatum_t::top_left);
-            
-            // Nome
-            hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
-            hw->tft.drawString(String(contacts[i].din), textX, y + 15);
-            
-            // Ultimo Messaggio (Grigio e troncato)
-            hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
-            String msg = contacts[i].lastMsg;
-            if (msg.length() > 20) msg = msg.substring(0, 19) + "...";
-            hw->tft.drawString(msg, textX, y + 40);
-
-            // Orario finto (a destra)
-           /* hw->tft.setTextDatum(textdatum_t::top_right);
-            hw->tft.drawString("10:30", w - 10, y + 15);*/
         }
     }
 
@@ -205,11 +351,10 @@ private:
 
         // Click su contatto
         int yTouch = hw->touchY;
-        int listStart = 50;
         
         // Calcolo indice basato su Y e Scroll
         // (y - start + scroll) / altezza_riga
-        int idx = (yTouch - listStart + scrollY) / ROW_H;
+        int idx = (yTouch - LIST_START + scrollY) / ROW_H;
 
         if (idx >= 0 && idx < contacts.size()) {
             openChat(idx);
@@ -219,14 +364,18 @@ private:
     // --- LOGICA CHAT INTERFACE ---
 
     void openChat(int idx) {
-        selectedContactIdx = idx;
+        selectedDin = contacts[idx].din;
         state = MSG_CHAT;
         needsRedraw = true;
+        contacts.markRead(selectedDin);
+        system->getLiveness()->setActive(selectedDin, true);
         
         // Pulisce o carica messaggi precedenti (qui simulo reset o storico finto)
         currentChat.clear();
-        // Aggiungi un messaggio di benvenuto finto
-        currentChat.push_back({contacts[idx].lastMsg, false, millis()});
+        // Mostra l'ultimo messaggio noto
+        if (contacts[idx].lastMsg.length() > 0) {
+            currentChat.push_back({contacts[idx].lastMsg, false, millis()});
+        }
     }
 
     void drawChatInterface() {
@@ -241,11 +390,23 @@ private:
         hw->tft.drawString("<", 10, 15); // Back icon
         
         // Avatar piccolo header
-        hw->tft.fillCircle(40, 25, 15, contacts[selectedContactIdx].color);
+        Contact* c = contacts.find(selectedDin);
+        hw->tft.fillCircle(40, 25, 15, c ? c->color : theme->PANEL_BG);
         
         hw->tft.setTextColor(theme->TEXT_MAIN, theme->HEADER_BG);
         hw->tft.setTextDatum(textdatum_t::middle_left);
-        hw->tft.drawString(String(contacts[selectedContactIdx].din), 65, 25);
+        hw->tft.drawString(String(selectedDin), 65, 17);
+
+        // Presenza: RTT medio e perdita dei probe
+        const NodeRecord* rec = system->getNodeDirectory().find(selectedDin);
+        String presence = "offline";
+        if (rec && (rec->state & NODE_ONLINE)) {
+            presence = "online";
+            if (rec->rtt != NODE_RTT_UNKNOWN) presence += " - " + String(rec->rtt) + " ms";
+            if (rec->loss > 0) presence += " - " + String(rec->loss * 100 / 255) + "% loss";
+        }
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->HEADER_BG);
+        hw->tft.drawString(presence, 65, 35);
         
         // 2. Area Messaggi
         int chatBottom = hw->tft.height() - INPUT_H;
@@ -313,6 +474,7 @@ private:
 
         // Header Back (Torna alla lista contatti)
         if (hw->isTouchInRect(0, 0, 60, 50)) {
+            system->getLiveness()->setActive(selectedDin, false);
             state = MSG_CONTACTS;
             needsRedraw = true;
             return;
@@ -333,15 +495,45 @@ private:
         
         // Aggiungi alla chat
         currentChat.push_back({text, true, millis()});
+        system->getPredictor()->learn(text);
         
         // Aggiorna l'anteprima nella lista contatti
-        contacts[selectedContactIdx].lastMsg = "Tu: " + text;
+        contacts.setLastMessage(selectedDin, "Tu: " + text, false);
         
-        DDO ddo(1);
+        DDO ddo(MSG_TYPESET);
         ddo.allocatePayload(text.length() + 1);
         memcpy(ddo.getPayloadPtr(), text.c_str(), text.length() + 1);
-        system->getNode()->locate(contacts[selectedContactIdx].din, 1);
-        system->getNode()->push(contacts[selectedContactIdx].din>>44, &ddo);
+        system->getNode()->locate(selectedDin, 1);
+        system->getNode()->push(selectedDin>>44, &ddo);
+    }
+
+    // One message from din, if any. seen: the chat with din is on screen.
+    bool receive(din_t din, bool seen) {
+        DDO* ddo;
+        if (system->getNode()->pull(din, &ddo) != ERROR_NONE) return false;
+
+        char* buffer = new char[ddo->getPayloadSize() + 1];
+        memcpy(buffer, ddo->getPayloadPtr(), ddo->getPayloadSize());
+        buffer[ddo->getPayloadSize()] = '\0';
+
+        if (din == selectedDin) currentChat.push_back({String(buffer), false, millis()});
+        contacts.setLastMessage(din, String(buffer), !seen);
+
+        delete[] buffer;
+        delete ddo;
+        return true;
+    }
+
+    // Up to max messages from the senders that announced one; a sender
+    // stays pending until its queue is empty. Returns the messages taken.
+    int receivePending(int max, bool chatOnScreen) {
+        int received = 0;
+        for (size_t i = 0; i < pendingDins.size() && received < max;) {
+            din_t din = pendingDins[i];
+            if (receive(din, chatOnScreen && din == selectedDin)) { received++; continue; }
+            pendingDins.erase(pendingDins.begin() + i);
+        }
+        return received;
     }
 
     // Helper generico
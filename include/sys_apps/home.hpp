@@ -1,18 +1,36 @@
+// Grid Configuration: 3x3 icons, more vertical space for the labels.
+// Centering calculation: (240 - (3*60 + 2*15)) / 2 = 15
+#define HOME_ICON_SIZE 60
+#define HOME_SLOTS 9
+constexpr UiGrid HOME_GRID = {15, 60, HOME_ICON_SIZE, HOME_ICON_SIZE, 15, 35, 3};
+constexpr UiRect HOME_ICONS[HOME_SLOTS] = { UI_TABLE_9(HOME_GRID.at, 0) };
+
 class HomeApp : public Application {
 private:
-    // Grid Configuration
-    const int COLS = 3;
-    const int ROWS = 3; 
-    const int ICON_SIZE = 60;
-    const int GAP = 15;
-    // Centering calculation: (240 - (3*60 + 2*15)) / 2 = 15
-    const int START_X = 15; 
-    const int START_Y = 60;
+    const int ICON_SIZE = HOME_ICON_SIZE;
+
+    uint32_t netDrawnVersion = 0; // NetworkState version shown in the status bar
+    uint32_t appsDrawnVersion = 0; // AppRegistry version shown in the grid
+
+    // Press feedback: a ring grows around the tile, the app opens when it ends
+    const int PRESS_GROW = 4;
+    const uint32_t PRESS_MS = 140;
+    int pressTween = -1;
+
+    // "icons/<lowercase name>" from the asset pack, if it fits the tile
+    const AssetImage* findIcon(const char* label) {
+        char key[40];
+        snprintf(key, sizeof(key), "icons/%s", label);
+        for (char* c = key; *c; c++) *c = tolower(*c);
+        const AssetImage* icon = system->getAssets()->image(key);
+        if (!icon || icon->width > ICON_SIZE || icon->height > ICON_SIZE) return nullptr;
+        return icon;
+    }
 
     // Helper: Draw a single app icon with "Depth"
-    void drawAppIcon(int col, int row, const char* label, uint16_t color, bool isAddBtn = false) {
-        int x = START_X + (col * (ICON_SIZE + GAP));
-        int y = START_Y + (row * (ICON_SIZE + 35)); // More vertical space for text
+    void drawAppIcon(int index, const char* label, uint16_t color, bool isAddBtn = false) {
+        int x = HOME_ICONS[index].x;
+        int y = HOME_ICONS[index].y;
 
         // 1. Icon Shadow (Offset)
         hw->tft.fillRoundRect(x, y + 4, ICON_SIZE, ICON_SIZE, 14, theme->PANEL_SHADOW);
@@ -28,16 +46,20 @@ private:
         hw->tft.setTextDatum(textdatum_t::middle_center);
         
         if (isAddBtn) {
-            hw->tft.setFont(&fonts::efontCN_24);
+            hw->tft.setFont(hw->fontLarge);
             hw->tft.drawString("+", x + ICON_SIZE/2, y + ICON_SIZE/2 - 2);
-            hw->tft.setFont(&fonts::efontCN_14);
+            hw->tft.setFont(hw->fontRegular);
+        } else if (const AssetImage* icon = findIcon(label)) {
+            // Packed icon, drawn straight from the mapped flash
+            hw->tft.pushImage(x + (ICON_SIZE - icon->width) / 2, y + (ICON_SIZE - icon->height) / 2,
+                              icon->width, icon->height, (const lgfx::swap565_t*)icon->pixels);
         } else {
             // Draw first letter as logo
             String initial = String(label).substring(0, 1);
             initial.toUpperCase();
-            hw->tft.setFont(&fonts::efontCN_24);
+            hw->tft.setFont(hw->fontLarge);
             hw->tft.drawString(initial, x + ICON_SIZE/2, y + ICON_SIZE/2);
-            hw->tft.setFont(&fonts::efontCN_14);
+            hw->tft.setFont(hw->fontRegular);
         }
 
         // 5. Label (Below icon)
@@ -77,12 +99,13 @@ private:
         xPos -= 28;
 
         // 2. WI-FI SIGNAL
-        if (WiFi.status() == WL_CONNECTED) {
-            int rssi = WiFi.RSSI();
+        const NetworkStatus& net = system->getNetwork()->get();
+        netDrawnVersion = system->getNetwork()->version();
+        if (net.wifiUp) {
             // Draw 3 bars
             for(int i=0; i<3; i++) {
                 int barH = 4 + (i*3);
-                bool active = (i==0) || (i==1 && rssi > -80) || (i==2 && rssi > -60);
+                bool active = (i==0) || (i==1 && net.bars >= 2) || (i==2 && net.bars >= 3);
                 hw->tft.fillRect(xPos - 10 + (i*4), yCenter + 5 - barH, 3, barH, active ? theme->TEXT_MAIN : theme->PANEL_SHADOW);
             }
         } else {
@@ -100,15 +123,18 @@ private:
     
     public:
     HomeApp() : Application(0) {}
+    const char* getName() const override { return "Home"; }
     
     void onStart() override {
         needsRedraw = true;
     }
 
     void onUpdate() override {
-        if (needsRedraw) {
+        if (needsRedraw || appsDrawnVersion != system->registry.version()) {
             drawGrid();
             needsRedraw = false;
+        } else if (netDrawnVersion != system->getNetwork()->version()) {
+            drawStatusBar();
         }
         handleTouch();
     }
@@ -123,83 +149,69 @@ private:
         
         // Draw Installed Apps
         auto& apps = system->registry.getApps();
+        appsDrawnVersion = system->registry.version();
         int count = 0;
         
         for (const auto& app : apps) {
-            int col = count % COLS;
-            int row = count / COLS;
-            if (row >= ROWS) break; 
+            if (count >= HOME_SLOTS) break; 
             
-            drawAppIcon(col, row, app.name.c_str(), app.color);
+            drawAppIcon(count, app.name.c_str(), app.color);
             count++;
         }
 
         // Draw "Add App" Button
-        int col = count % COLS;
-        int row = count / COLS;
-        if (row < ROWS) {
-            drawAppIcon(col, row, "Add", theme->PANEL_BG, true);
+        if (count < HOME_SLOTS) {
+            drawAppIcon(count, "Add", theme->PANEL_BG, true);
         }
     }
 
-    void highlightApp(int index) {
-        int col = index % COLS;
-        int row = index / COLS;
-        
-        int x = START_X + (col * (ICON_SIZE + GAP));
-        int y = START_Y + (row * (ICON_SIZE + 35));
-
-        // Draw a bright border to indicate selection
-        hw->tft.drawRoundRect(x-2, y-2, ICON_SIZE+4, ICON_SIZE+4, 16, theme->ACCENT_PRIMARY);
-        delay(100); 
-        // Redraw the background part to erase border
-        // (Full redraw is safer but slower, this is a quick patch)
-        hw->tft.drawRoundRect(x-2, y-2, ICON_SIZE+4, ICON_SIZE+4, 16, theme->BG_COLOR);
+    void drawPressRing(int x, int y, int grow, uint16_t color) {
+        hw->tft.drawRoundRect(x - 2 - grow, y - 2 - grow, ICON_SIZE + 4 + 2 * grow, ICON_SIZE + 4 + 2 * grow, 16 + grow, color);
     }
 
-    void handleTouch() {
-        if (!hw->isTouching) return;
-        delay(150); 
-        
-        int x = hw->touchX;
-        int y = hw->touchY;
-
-        // Ignore clicks on Status Bar
-        if (y < 40) return;
+    // Non-blocking: the ring animates from the kernel loop, then the item opens
+    void highlightApp(int index) {
+        int x = HOME_ICONS[index].x;
+        int y = HOME_ICONS[index].y;
+
+        pressTween = system->getAnimations()->start(0, PRESS_GROW, PRESS_MS, EASE_OUT_BACK,
+            [this, x, y, index](int32_t grow, int32_t prev, bool last) {
+                drawPressRing(x, y, prev, theme->BG_COLOR);
+                if (!last) { drawPressRing(x, y, grow, theme->ACCENT_PRIMARY); return; }
+                pressTween = -1;
+                openItem(index);
+            });
+        if (pressTween < 0) openItem(index);
+    }
 
+    void openItem(int index) {
         auto& apps = system->registry.getApps();
-        int totalItems = apps.size() + 1;
+        if (index >= (int)apps.size()) {
+            sysLog(LOG_HOME_FILES);
+            needsRedraw = true; // Ring erased over the tile shadow
+            return;
+        }
 
-        for (int i = 0; i < totalItems; i++) {
-            int col = i % COLS;
-            int row = i / COLS;
-            
-            int iconX = START_X + (col * (ICON_SIZE + GAP));
-            int iconY = START_Y + (row * (ICON_SIZE + 35));
-
-            // Check collision
-            if (x >= iconX && x <= iconX + ICON_SIZE &&
-                y >= iconY && y <= iconY + ICON_SIZE) {
-                
-                highlightApp(i);
-
-                if (i == apps.size()) {
-                    Serial.println("Launch File Browser");
-                } else {
-                    AppShortcut &app = apps[i];
-                    Serial.print("Launching: "); Serial.println(app.name);
-                    
-                    if (app.type == APP_INTERNAL) {
-                        if (app.execPath == "SYS_SETTINGS") {
-                            system->launchApp((u8_t)1);
-                        }
-                        else if (app.execPath == "SYS_CHAT") {
-                            system->launchApp((u8_t)2);
-                        }
-                    }
-                }
-                return;
+        AppShortcut &app = apps[index];
+        sysLog(LOG_HOME_LAUNCH, app.name);
+
+        if (app.type == APP_INTERNAL) {
+            if (app.execPath == "SYS_SETTINGS") {
+                system->launchApp((u8_t)1);
+            }
+            else if (app.execPath == "SYS_CHAT") {
+                system->launchApp((u8_t)2);
             }
         }
     }
+
+    void handleTouch() {
+        // One action per press, none while the previous one animates
+        if (!hw->touchPressed || system->getAnimations()->isRunning(pressTween)) return;
+        
+        // Same table as drawGrid: the status bar is not in it
+        int i = UI_HIT(HOME_ICONS, hw->touchX, hw->touchY);
+        int totalItems = system->registry.getApps().size() + 1;
+        if (i >= 0 && i < totalItems) highlightApp(i);
+    }
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <os/modules/toastmessages.hpp>
+#include <os/modules/layout.hpp>
 
 
 // Stati interni dell'App Settings
@@ -11,39 +12,99 @@ enum SettingsState {
     PAGE_WIFI_SCAN,
     PAGE_WIFI_KEYBOARD,
     PAGE_DAAS,
-    PAGE_STATS
+    PAGE_STATS,
+    PAGE_BENCH,
+    PAGE_LATENCY,
+    PAGE_HEAP
 };
 
+// --- LAYOUT (drawn and hit-tested from the same tables) ---
+#define SET_ITEM_H 50
+#define SET_WIFI_ROWS 5
+
+constexpr UiRect SET_BACK = {0, 0, 50, 50};      // "<" in the header
+
+// Dashboard: 2x2 tiles
+constexpr UiGrid SET_TILE_GRID = {10, 60, uiSplit(UI_SCREEN_W - 20, 2, 10), 90, 10, 10, 2};
+constexpr UiRect SET_TILES[4] = { UI_TABLE_4(SET_TILE_GRID.at, 0) };
+#define SET_TILE_HIT(i) uiGrow(SET_TILES[i], 5, 5, 5, 5)
+constexpr UiRect SET_TILES_HIT[4] = { UI_TABLE_4(SET_TILE_HIT, 0) };
+
+// Wi-Fi list: rows own the gap under them, the footer holds the scroll arrows
+constexpr UiGrid SET_LIST_GRID = {5, 50, UI_SCREEN_W - 10, SET_ITEM_H - 5, 0, 5, 1};
+constexpr UiRect SET_WIFI_LIST[SET_WIFI_ROWS] = { UI_TABLE_5(SET_LIST_GRID.at, 0) };
+#define SET_ROW_HIT(i) uiGrow(SET_WIFI_LIST[i], 5, 0, 5, 5)
+constexpr UiRect SET_WIFI_ROWS_HIT[SET_WIFI_ROWS] = { UI_TABLE_5(SET_ROW_HIT, 0) };
+constexpr UiRect SET_WIFI_FOOTER = uiRect(0, 50 + SET_WIFI_ROWS * SET_ITEM_H, UI_SCREEN_W, UI_SCREEN_H - 50 - SET_WIFI_ROWS * SET_ITEM_H);
+constexpr UiRect SET_WIFI_UP = uiRect(UI_SCREEN_W - 80, SET_WIFI_FOOTER.y, 40, SET_WIFI_FOOTER.h);
+constexpr UiRect SET_WIFI_DOWN = uiRect(UI_SCREEN_W - 40, SET_WIFI_FOOTER.y, 40, SET_WIFI_FOOTER.h);
+
+// DaaS page
+constexpr UiRect SET_DAAS_CARD = {10, 60, UI_SCREEN_W - 20, 90};
+constexpr UiRect SET_DAAS_DRIVER = {10, 170, UI_SCREEN_W - 20, 45};
+constexpr UiGrid SET_DAAS_ACTIONS = {10, 230, uiSplit(UI_SCREEN_W - 20, 2, 10), 45, 10, 0, 2};
+constexpr UiRect SET_DAAS_UNBIND = SET_DAAS_ACTIONS.at(0);
+constexpr UiRect SET_DAAS_DISCOVER = SET_DAAS_ACTIONS.at(1);
+constexpr UiRect SET_DAAS_BENCH = {10, 285, UI_SCREEN_W - 20, 30};
+
+// Link bench page
+constexpr UiRect SET_BENCH_TARGET = {10, 60, UI_SCREEN_W - 20, 35};
+constexpr UiRect SET_BENCH_RUN = {10, 102, UI_SCREEN_W - 20, 38};
+
+// Stats page: touch latency and heap summaries under the sparklines, open their pages
+constexpr UiRect SET_STATS_TOUCH = {0, 296, UI_SCREEN_W / 2, UI_SCREEN_H - 296};
+constexpr UiRect SET_STATS_HEAP = {UI_SCREEN_W / 2, 296, UI_SCREEN_W / 2, UI_SCREEN_H - 296};
+
+// Latency page: one row per app, then the actions
+#define SET_LAT_ROW_Y 82
+#define SET_LAT_ROW_H 20
+constexpr UiGrid SET_LAT_ACTIONS = {10, 270, uiSplit(UI_SCREEN_W - 20, 2, 10), 40, 10, 0, 2};
+constexpr UiRect SET_LAT_RESET = SET_LAT_ACTIONS.at(0);
+constexpr UiRect SET_LAT_EXPORT = SET_LAT_ACTIONS.at(1);
+
+// Heap page: one row per tag, then the actions
+#define SET_HEAP_ROW_Y 82
+#define SET_HEAP_ROW_H 15
+constexpr UiRect SET_HEAP_LEAK = SET_LAT_ACTIONS.at(0);
+constexpr UiRect SET_HEAP_PEAKS = SET_LAT_ACTIONS.at(1);
+
 class SettingsApp : public Application {
 private:
     SettingsState currentState = PAGE_MAIN;
-    bool currentSessionSaved = true;
+    uint32_t netDrawnVersion = 0;  // NetworkState version shown by the link indicators
 
 
     // --- State Data ---
     bool btEnabled = false;       
     uint64_t currentDIN = 123456789; 
     String targetSSID = "";       
+    WifiNetwork targetNet;         // Scanner entry of targetSSID (BSSID/channel)
+    bool targetKnown = false;
+    int wifiScroll = 0;            // First visible row of the network list
+    uint32_t wifiDrawnVersion = 0;
     String inputBuffer = "";      
     
-    unsigned long lastStatsUpdate = 0;
-
-    // Layout Constants
-    const int ITEM_H = 50;
+    // Stats page: sparkline geometry and per-series scale
+    const int STATS_ROW_Y = 56;
+    const int STATS_ROW_H = 17;
+    const int SPARK_X = 160;
+    const int SPARK_W = 72;
+    uint32_t sparkScale[METRIC_COUNT] = {0};
+    uint32_t statsDrawnSamples = 0;
+    uint32_t latencyDrawnVersion = 0;
+    uint32_t heapDrawnSamples = 0;
+
+    // Benchmark page: -1 = loopback, otherwise n-th node of the directory
+    int benchTargetIdx = -1;
+    din_t benchTarget = 0;
+    uint32_t benchDrawnVersion = 0;
 
     // --- GRAPHIC HELPERS ---
     
     void drawTile(int index, const char* label, const char* status, uint16_t accentColor) {
-        // Grid Logic: 2 Columns. 
         // Index 0: Top Left, 1: Top Right, 2: Bottom Left, 3: Bottom Right
-        int col = index % 2;
-        int row = index / 2;
-
-        int margin = 10;
-        int w = (hw->tft.width() - (margin * 3)) / 2; // Calculate width dynamically
-        int h = 90; // Fixed height for tiles
-        int x = margin + (col * (w + margin));
-        int y = 60 + (row * (h + margin)); // Start Y at 60
+        const UiRect& t = SET_TILES[index];
+        int x = t.x, y = t.y, w = t.w, h = t.h;
 
         // 1. Shadow
         hw->tft.fillRoundRect(x, y+4, w, h, 8, theme->PANEL_SHADOW);
@@ -64,29 +125,28 @@ private:
         hw->tft.drawString(status, x + 10, y + 25);
     }
 
-    void drawListItem(int index, const char* label, const char* value, bool isToggle = false, bool toggleState = false) {
-        int y = 50 + (index * ITEM_H);
-        int w = hw->tft.width();
+    void drawListItem(const UiRect& row, const char* label, const char* value, bool isToggle = false, bool toggleState = false) {
+        int y = row.y;
         
         // Background
-        hw->tft.fillRect(5, y, w - 10, ITEM_H - 5, theme->PANEL_BG);
-        hw->tft.drawRect(5, y, w - 10, ITEM_H - 5, theme->BORDER_COLOR);
+        hw->tft.fillRect(row.x, row.y, row.w, row.h, theme->PANEL_BG);
+        hw->tft.drawRect(row.x, row.y, row.w, row.h, theme->BORDER_COLOR);
         
         // Label
         hw->tft.setTextColor(theme->TEXT_MAIN, theme->PANEL_BG);
         hw->tft.setTextDatum(textdatum_t::middle_left);
-        hw->tft.drawString(label, 15, y + (ITEM_H/2) - 2);
+        hw->tft.drawString(label, row.x + 10, y + (SET_ITEM_H/2) - 2);
 
         // Value or Toggle
         if (isToggle) {
-            int toggleX = w - 50; 
+            int toggleX = row.right() - 45;
             uint16_t tColor = toggleState ? theme->ACCENT_PRIMARY : theme->TEXT_MUTED;
             hw->tft.fillRoundRect(toggleX, y + 10, 35, 20, 10, tColor);
             hw->tft.fillCircle(toggleState ? toggleX + 25 : toggleX + 10, y + 20, 8, theme->TEXT_MAIN);
         } else {
             hw->tft.setTextColor(theme->TEXT_MAIN, theme->PANEL_BG);
             hw->tft.setTextDatum(textdatum_t::middle_right);
-            hw->tft.drawString(value, w - 15, y + (ITEM_H/2) - 2);
+            hw->tft.drawString(value, row.right() - 10, y + (SET_ITEM_H/2) - 2);
         }
     }
 
@@ -122,8 +182,13 @@ private:
         hw->tft.setTextDatum(textdatum_t::top_left);
     }
 
+    void drawButton(const UiRect& r, const char* label, uint16_t bgCol, uint16_t txtCol) {
+        drawButton(r.x, r.y, r.w, r.h, label, bgCol, txtCol);
+    }
+
 public:
     SettingsApp() : Application(1) {} // ID 1
+    const char* getName() const override { return "Settings"; }
     
     void onStart() override {
         currentState = PAGE_MAIN;
@@ -131,11 +196,11 @@ public:
     }
 
     void onUpdate() override {
-        // --- Auto-Save Logic ---
-        // If we are connected successfully but haven't saved this session yet
-        if (WiFi.status() == WL_CONNECTED && !currentSessionSaved) {
-            currentSessionSaved = system->getHW()->saveCurrentWifi();
-            needsRedraw = true; // Refresh UI to show connection status
+        // Link indicators follow the network service (saving the network
+        // on success is done by HardwareManager::serviceWifi)
+        if (!needsRedraw && netDrawnVersion != system->getNetwork()->version()) {
+            if (currentState == PAGE_MAIN) drawWifiTile();
+            else if (currentState == PAGE_DAAS) drawDaasStatus();
         }
 
         switch (currentState) {
@@ -145,6 +210,7 @@ public:
                 break;
             case PAGE_WIFI_SCAN:
                 if (needsRedraw) { drawWifiPage(); needsRedraw = false; }
+                else if (wifiDrawnVersion != system->getWifiScanner()->version()) drawWifiList();
                 handleWifiTouch();
                 break;
             case PAGE_WIFI_KEYBOARD:
@@ -157,13 +223,9 @@ public:
                     if (!system->getKeyboard()->wasCancelled()) {
                         String password = system->getKeyboard()->getResult();
                         
-                        // Initiate connection
-                        WiFi.disconnect(); // Start fresh each time
-                        WiFi.begin(targetSSID.c_str(), password.c_str());
-
-                        
-                        // Reset save flag so onUpdate knows to save when connection succeeds
-                        currentSessionSaved = false; 
+                        // Initiate connection, directed to the AP we just scanned
+                        if (targetKnown) system->getHW()->connectWifi(targetSSID, password, targetNet.channel, targetNet.bssid);
+                        else system->getHW()->connectWifi(targetSSID, password);
                     }
                     currentState = PAGE_MAIN;
                     needsRedraw = true;
@@ -176,13 +238,26 @@ public:
                 handleDaasTouch();
                 break;
             case PAGE_STATS:
-                if (millis() - lastStatsUpdate > 1000 || needsRedraw) {
-                    drawStatsPage();
-                    needsRedraw = false;
-                    lastStatsUpdate = millis();
-                }
+                if (needsRedraw) { drawStatsPage(); needsRedraw = false; }
+                else if (statsDrawnSamples != system->getMetrics()->sampleCount()) drawStatsUpdate();
+                if (latencyDrawnVersion != system->getLatency()->version()) drawStatsLatency();
                 handleStatsTouch();
                 break;
+            case PAGE_HEAP:
+                if (needsRedraw) { drawHeapPage(); needsRedraw = false; }
+                else if (heapDrawnSamples != system->getMetrics()->sampleCount()) drawHeapRows();
+                handleHeapTouch();
+                break;
+            case PAGE_LATENCY:
+                if (needsRedraw) { drawLatencyPage(); needsRedraw = false; }
+                else if (latencyDrawnVersion != system->getLatency()->version()) drawLatencyRows();
+                handleLatencyTouch();
+                break;
+            case PAGE_BENCH:
+                if (needsRedraw) { drawBenchPage(); needsRedraw = false; }
+                else if (benchDrawnVersion != system->getBenchmark()->version()) drawBenchProgress();
+                handleBenchTouch();
+                break;
         }
     }
 
@@ -193,8 +268,7 @@ public:
         drawHeader("DASHBOARD");
 
         // 1. Wi-Fi Tile
-        bool wifiCon = (WiFi.status() == WL_CONNECTED);
-        drawTile(0, "Wi-Fi", wifiCon ? "Online" : "Offline", wifiCon ? theme->ACCENT_PRIMARY : theme->TEXT_MUTED);
+        drawWifiTile();
 
         // 2. Bluetooth Tile
         drawTile(1, "Bluetooth", btEnabled ? "Active" : "Disabled", btEnabled ? theme->ACCENT_PRIMARY : theme->TEXT_MUTED);
@@ -206,35 +280,71 @@ public:
         drawTile(3, "System", "View Stats", theme->ACCENT_ALERT);
     }
 
+    void drawWifiTile() {
+        const NetworkStatus& net = system->getNetwork()->get();
+        netDrawnVersion = system->getNetwork()->version();
+        drawTile(0, "Wi-Fi", net.wifiUp ? "Online" : "Offline", net.wifiUp ? theme->ACCENT_PRIMARY : theme->TEXT_MUTED);
+    }
+
     void drawWifiPage() {
-        drawHeader("SCANNING...");
-        int n = WiFi.scanNetworks();
-        hw->tft.fillScreen(theme->BG_COLOR);
         drawHeader("WI-FI");
-        
-        for (int i = 0; i < n && i < 5; ++i) {
-             String ssid = WiFi.SSID(i);
-             // Truncate long SSIDs
-             if(ssid.length() > 10) ssid = ssid.substring(0, 9) + ".";
-             String label = ssid + " (" + String(WiFi.RSSI(i)) + ")";
-             drawListItem(i, label.c_str(), ">");
+        wifiDrawnVersion = 0;
+        drawWifiList();
+    }
+
+    // Repaints the visible rows and the footer from the scanner cache
+    void drawWifiList() {
+        WifiScanner* scanner = system->getWifiScanner();
+        wifiDrawnVersion = scanner->version();
+
+        if (wifiScroll > scanner->size() - SET_WIFI_ROWS) wifiScroll = max(0, scanner->size() - SET_WIFI_ROWS);
+
+        for (int i = 0; i < SET_WIFI_ROWS; i++) {
+            const UiRect& row = SET_WIFI_LIST[i];
+            const WifiNetwork* net = scanner->get(wifiScroll + i);
+            if (!net) {
+                hw->tft.fillRect(row.x, row.y, row.w, row.h, theme->BG_COLOR);
+                continue;
+            }
+            String ssid = net->ssid;
+            // Truncate long SSIDs
+            if (ssid.length() > 14) ssid = ssid.substring(0, 13) + ".";
+            String label = ssid + " (" + String(net->rssi) + ")";
+            drawListItem(row, label.c_str(), ">");
         }
-        if (n == 0) hw->tft.drawString("No AP Found", 20, 60);
+
+        // Footer: scan status and scroll arrows
+        const UiRect& f = SET_WIFI_FOOTER;
+        int fy = f.y;
+        hw->tft.fillRect(f.x, f.y, f.w, f.h, theme->BG_COLOR);
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_left);
+        String status = scanner->isScanning() ? "Scanning ch " + String(scanner->getChannel()) : String(scanner->size()) + " networks";
+        if (scanner->size() == 0 && !scanner->isScanning()) status = "No AP Found";
+        hw->tft.drawString(status, 10, fy + 10);
+
+        hw->tft.setTextDatum(textdatum_t::middle_center);
+        hw->tft.setTextColor(wifiScroll > 0 ? theme->TEXT_MAIN : theme->PANEL_SHADOW, theme->BG_COLOR);
+        hw->tft.drawString("^", SET_WIFI_UP.cx(), fy + 10);
+        hw->tft.setTextColor(wifiScroll + SET_WIFI_ROWS < scanner->size() ? theme->TEXT_MAIN : theme->PANEL_SHADOW, theme->BG_COLOR);
+        hw->tft.drawString("v", SET_WIFI_DOWN.cx(), fy + 10);
+        hw->tft.setTextDatum(textdatum_t::top_left);
     }
 
-    void drawDaasPage() {
-        drawHeader("DaaS CONFIG", true); // showBack = true
-        int w = hw->tft.width();
+    // Connection card and driver button, repainted on network changes
+    void drawDaasStatus() {
+        const NetworkStatus& net = system->getNetwork()->get();
+        netDrawnVersion = system->getNetwork()->version();
 
         // --- 1. CONNECTION STATUS CARD ---
-        int cardY = 60;
-        int cardH = 90;
+        const UiRect& card = SET_DAAS_CARD;
+        int cardY = card.y;
         
-        hw->tft.fillRoundRect(10, cardY, w - 20, cardH, 8, theme->PANEL_BG);
-        hw->tft.drawRoundRect(10, cardY, w - 20, cardH, 8, theme->BORDER_COLOR);
+        hw->tft.fillRoundRect(card.x, card.y, card.w, card.h, 8, theme->PANEL_BG);
+        hw->tft.drawRoundRect(card.x, card.y, card.w, card.h, 8, theme->BORDER_COLOR);
 
         // Determine active technology
-        bool wifiReady = (WiFi.status() == WL_CONNECTED);
+        bool wifiReady = net.wifiUp;
         bool btReady = btEnabled; 
 
         // Status Indicator Circle
@@ -247,155 +357,342 @@ public:
 
         // URI Display
         String uri = "Unavailable";
-        if (wifiReady) uri = WiFi.localIP().toString() + ":9909";
+        if (wifiReady) uri = system->getNetwork()->uri();
         else if (btReady) uri = "BT: " + String(currentDIN); // Example BT URI
 
         hw->tft.setTextColor(theme->TEXT_MUTED, theme->PANEL_BG);
         hw->tft.drawString(uri, 30, cardY + 55);
 
 
-        if (wifiReady || btReady) {
-            drawButton(10, 170, w - 20, 45, "ENABLE DRIVER", theme->ACCENT_PRIMARY, theme->TEXT_MAIN);
+        if (wifiReady && net.daasDriver) {
+            // Bound automatically by the network service
+            drawButton(SET_DAAS_DRIVER, "DRIVER ENABLED", theme->PANEL_BG, theme->ACCENT_PRIMARY);
+        } else if (wifiReady || btReady) {
+            drawButton(SET_DAAS_DRIVER, "ENABLE DRIVER", theme->ACCENT_PRIMARY, theme->TEXT_MAIN);
         } else {
             // Disabled state visual
-             drawButton(10, 170, w - 20, 45, "No Link Available", theme->PANEL_SHADOW, theme->TEXT_MUTED);
+             drawButton(SET_DAAS_DRIVER, "No Link Available", theme->PANEL_SHADOW, theme->TEXT_MUTED);
         }
+    }
+
+    void drawDaasPage() {
+        drawHeader("DaaS CONFIG", true); // showBack = true
+        drawDaasStatus();
 
         // --- 3. NETWORK MANAGEMENT ---
-        int bottomY = 230;
-        int btnW = (w - 30) / 2;
-        
-        drawButton(10, bottomY, btnW, 45, "UNBIND", theme->ACCENT_ALERT, theme->TEXT_MAIN);
-        drawButton(20 + btnW, bottomY, btnW, 45, "DISCOVER", theme->ACCENT_WARN, theme->TEXT_MAIN); // Changed to WARN for contrast
+        drawButton(SET_DAAS_UNBIND, "UNBIND", theme->ACCENT_ALERT, theme->TEXT_MAIN);
+        drawButton(SET_DAAS_DISCOVER, "DISCOVER", theme->ACCENT_WARN, theme->TEXT_MAIN); // Changed to WARN for contrast
+
+        // --- 4. DIAGNOSTICS ---
+        drawButton(SET_DAAS_BENCH, "LINK BENCHMARK", theme->PANEL_BG, theme->TEXT_MAIN);
     }
 
-    void drawStatsPage() {
-        drawHeader("SYSTEM STATS", true, needsRedraw); // Title with Back button
+    // --- LINK BENCHMARK ---
+
+    void selectBenchTarget(int idx) {
+        // Cycle: loopback, then every known node
+        NodeDirectory& dir = system->getNodeDirectory();
+        if (idx >= dir.size()) idx = -1;
+        benchTargetIdx = idx;
+        benchTarget = 0;
+        if (idx < 0) return;
+
+        int n = 0;
+        dir.forEach([&](const NodeRecord& rec) {
+            if (n++ == idx) benchTarget = rec.din;
+        });
+    }
+
+    void drawBenchPage() {
+        drawHeader("LINK BENCH", true);
         int w = hw->tft.width();
-        int m = 10; // Margin
 
-        // --- SECTION 1: TRAFFIC DASHBOARD (Card) ---
-        int yTraffic = 60;
-        int hTraffic = 80;
-        
-        // Card Background
-        hw->tft.fillRoundRect(m, yTraffic, w - 2*m, hTraffic, 8, theme->PANEL_BG);
-        hw->tft.drawRoundRect(m, yTraffic, w - 2*m, hTraffic, 8, theme->BORDER_COLOR); // Subtle border
+        // Target selector
+        const UiRect& target = SET_BENCH_TARGET;
+        hw->tft.fillRoundRect(target.x, target.y, target.w, target.h, 8, theme->PANEL_BG);
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->PANEL_BG);
+        hw->tft.setTextDatum(textdatum_t::middle_left);
+        hw->tft.drawString("Target", target.x + 10, target.cy());
+        hw->tft.setTextColor(theme->TEXT_MAIN, theme->PANEL_BG);
+        hw->tft.setTextDatum(textdatum_t::middle_right);
+        hw->tft.drawString(benchTargetIdx < 0 ? String("Loopback") : String(benchTarget), target.right() - 10, target.cy());
 
-        // Section Label
-        hw->tft.setTextColor(theme->ACCENT_PRIMARY, theme->PANEL_BG);
+        // Table header
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
         hw->tft.setTextDatum(textdatum_t::top_left);
-        hw->tft.drawString("MESSAGE TRAFFIC", m + 10, yTraffic + 5);
+        hw->tft.drawString("Blk  Pkt   KB/s  Lat  Jit", 15, 150);
+        hw->tft.drawFastHLine(10, 168, w - 20, theme->BORDER_COLOR);
 
-        // 3 Columns: Sent | Recv | Routed
-        int colW = (w - 2*m) / 3;
-        
-        auto drawStatItem = [&](int idx, const char* label, uint32_t val, uint16_t color) {
-            int x = m + (idx * colW);
-            int center = x + (colW / 2);
-            int yVal = yTraffic + 30;
-            
-            // Value (Big Number)
-            hw->tft.setTextColor(color, theme->PANEL_BG);
-            hw->tft.setTextDatum(textdatum_t::top_center);
-            hw->tft.drawString(String(val), center, yVal);
-            
-            // Label (Small Text)
-            hw->tft.setTextColor(theme->TEXT_MUTED, theme->PANEL_BG);
-            hw->tft.drawString(label, center, yVal + 20);
-            
-            // Vertical Divider line (except for last item)
-            if(idx < 2) hw->tft.drawFastVLine(x + colW, yVal, 30, theme->BORDER_COLOR);
-        };
+        benchDrawnVersion = 0;
+        drawBenchProgress();
+    }
 
-        drawStatItem(0, "SENT", system->getNode()->getSystemStatistics(_cor_dme_sended), theme->TEXT_MAIN);
-        drawStatItem(1, "RECV", system->getNode()->getSystemStatistics(_cor_dme_received), theme->ACCENT_PRIMARY);
-        drawStatItem(2, "ROUT", system->getNode()->getSystemStatistics(_cor_dme_routed), theme->ACCENT_WARN);
+    // Repaints the run button, status line and results, not the page chrome
+    void drawBenchProgress() {
+        BenchmarkRunner* bench = system->getBenchmark();
+        benchDrawnVersion = bench->version();
+        int w = hw->tft.width();
 
+        bool running = bench->getState() == BENCH_RUNNING;
+        drawButton(SET_BENCH_RUN, running ? "STOP" : "RUN", running ? theme->ACCENT_ALERT : theme->ACCENT_PRIMARY, theme->TEXT_MAIN);
 
-        // --- SECTION 2: SYSTEM HEALTH (2x2 Grid) ---
-        int ySys = 150;
-        int hSys = 90;
-        
-        hw->tft.fillRoundRect(m, ySys, w - 2*m, hSys, 8, theme->PANEL_BG);
-        
-        auto drawSysRow = [&](int row, const char* l1, String v1, const char* l2, String v2) {
-            int y = ySys + 20 + (row * 35);
-            int mid = w / 2;
-            
-            // Left Column
-            hw->tft.setTextColor(theme->TEXT_MUTED, theme->PANEL_BG);
-            hw->tft.setTextDatum(textdatum_t::top_left);
-            hw->tft.drawString(l1, m + 15, y);
-            
+        // Status line, under the table header
+        hw->tft.fillRect(10, 172, w - 20, 16, theme->BG_COLOR);
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::top_left);
+        String status;
+        switch (bench->getState()) {
+            case BENCH_IDLE:    status = "Idle"; break;
+            case BENCH_RUNNING: status = "Case " + String(bench->getCaseIndex() + 1) + "/" + String(bench->getCaseCount()); break;
+            case BENCH_DONE:    status = hw->sdAvailable ? "Done, saved to " BENCH_CSV_FILE : "Done (no SD)"; break;
+            case BENCH_FAILED:  status = "Failed: " + String(bench->getError()); break;
+        }
+        hw->tft.drawString(status, 15, 172);
+
+        // One row per finished case
+        int done = bench->getState() == BENCH_RUNNING ? bench->getCaseIndex() : bench->getCaseCount();
+        if (bench->getState() == BENCH_IDLE) done = 0;
+        for (int c = 0; c < bench->getCaseCount(); c++) {
+            int y = 190 + c * 16;
+            hw->tft.fillRect(10, y, w - 20, 16, theme->BG_COLOR);
+            if (c >= done) continue;
+
+            const BenchResult& r = bench->getResult(c);
+            char row[40];
+            if (r.runs == 0) snprintf(row, sizeof(row), "%-4u %-4u  lost", r.blockSize, r.packets);
+            else snprintf(row, sizeof(row), "%-4u %-4u %6u %4d %4u", r.blockSize, r.packets, r.goodput / 1024, r.latency, r.jitter);
+            hw->tft.setTextColor(r.runs ? theme->TEXT_MAIN : theme->ACCENT_ALERT, theme->BG_COLOR);
+            hw->tft.drawString(row, 15, y);
+        }
+    }
 
-            
-            if (row == 1) {
-                // clear area for UP text to avoid artifacts
-                hw->tft.drawRect(mid - 5, y, (w/2) - m - 10, 20, theme->PANEL_BG);
-            }
+    // --- SYSTEM STATS (sparklines) ---
 
-            hw->tft.setTextColor(theme->TEXT_MAIN, theme->PANEL_BG);
-            hw->tft.setTextDatum(textdatum_t::top_right);
-            hw->tft.drawString(v1, mid - 5, y);
-            
+    int statsRowY(int id) { return STATS_ROW_Y + id * STATS_ROW_H; }
 
-            // Right Column
-            hw->tft.setTextColor(theme->TEXT_MUTED, theme->PANEL_BG);
-            hw->tft.setTextDatum(textdatum_t::top_left);
-            hw->tft.drawString(l2, mid + 10, y);
-            
-            hw->tft.setTextColor(theme->TEXT_MAIN, theme->PANEL_BG);
-            hw->tft.setTextDatum(textdatum_t::top_right);
-            hw->tft.drawString(v2, w - m - 15, y);
-        };
+    void drawStatsValue(MetricId id) {
+        MetricsSampler* m = system->getMetrics();
+        int y = statsRowY(id);
 
-        String heap = String(ESP.getFreeHeap()/1024) + "k";
-        String blk = String(ESP.getMaxAllocHeap()/1024) + "k";
-        String up = String(millis()/1000) + "s";
-        
-        drawSysRow(0, "Free:", heap, "Max:", blk);
-        drawSysRow(1, "Up:", up, "Ver:", system->getNode()->getVersion());
-        
-        // Vertical Split Line
-        hw->tft.drawFastVLine(w/2, ySys + 15, hSys - 30, theme->BORDER_COLOR);
+        String v;
+        if (m->available() == 0 || (id == MET_WIFI_RSSI && m->at(id, 0) == 0)) v = "--";
+        else if (METRIC_INFO[id].counter) v = String(m->at(id, 0)) + " " + String(m->plotAt(id, 0)) + "/s";
+        else if (id == MET_HEAP_FREE || id == MET_HEAP_MAX_BLOCK) v = String(m->at(id, 0) / 1024) + "k";
+        else v = String(m->valueAt(id, 0));
+
+        hw->tft.fillRect(62, y, SPARK_X - 66, STATS_ROW_H - 2, theme->BG_COLOR);
+        hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_right);
+        hw->tft.drawString(v, SPARK_X - 6, y + STATS_ROW_H / 2);
+    }
 
+    // Sweep-style sparkline: sample n always lands in column n % SPARK_W,
+    // so a new sample costs one column plus the cursor gap in front of it.
+    void drawSparkColumn(MetricId id, uint16_t age) {
+        MetricsSampler* m = system->getMetrics();
+        uint32_t n = m->sampleCount() - 1 - age;
+        int x = SPARK_X + (n % SPARK_W);
+        int y = statsRowY(id) + 2;
+        int h = STATS_ROW_H - 4;
 
-        // --- SECTION 3: SIGNAL VISUALIZER ---
-        int ySig = 250;
-        int hSig = 50;
-        hw->tft.fillRoundRect(m, ySig, w - 2*m, hSig, 8, theme->PANEL_BG);
-        
-        // Calculate Signal Bars (0 to 4)
-        int rssi = WiFi.RSSI();
-        int bars = 0;
-        if (WiFi.status() == WL_CONNECTED) {
-            if (rssi > -55) bars = 4;
-            else if (rssi > -65) bars = 3;
-            else if (rssi > -75) bars = 2;
-            else if (rssi > -85) bars = 1;
+        uint32_t v = m->plotAt(id, age);
+        int bar = sparkScale[id] ? (int)((uint64_t)v * h / sparkScale[id]) : 0;
+        if (bar > h) bar = h;
+
+        hw->tft.drawFastVLine(x, y, h - bar, theme->PANEL_BG);
+        if (bar > 0) hw->tft.drawFastVLine(x, y + h - bar, bar, METRIC_INFO[id].counter ? theme->ACCENT_PRIMARY : theme->ACCENT_WARN);
+
+        // Cursor gap ahead of the newest column
+        if (age == 0) hw->tft.drawFastVLine(SPARK_X + ((n + 1) % SPARK_W), y, h, theme->BG_COLOR);
+    }
+
+    // Power-of-two scale with hysteresis so the plot is not rescaled every sample
+    bool updateSparkScale(MetricId id) {
+        MetricsSampler* m = system->getMetrics();
+        uint32_t peak = 1;
+        for (uint16_t a = 0; a < m->available() && a < SPARK_W; a++) {
+            uint32_t v = m->plotAt(id, a);
+            if (v > peak) peak = v;
         }
+        uint32_t scale = sparkScale[id];
+        if (scale >= peak && (scale <= 1 || peak > scale / 4)) return false;
 
-        // Label
-        hw->tft.setTextColor(theme->TEXT_MAIN, theme->PANEL_BG);
+        scale = 1;
+        while (scale < peak) scale <<= 1;
+        sparkScale[id] = scale;
+        return true;
+    }
+
+    void drawSparkline(MetricId id) {
+        MetricsSampler* m = system->getMetrics();
+        hw->tft.fillRect(SPARK_X, statsRowY(id) + 2, SPARK_W, STATS_ROW_H - 4, theme->PANEL_BG);
+        uint16_t n = m->available() < SPARK_W - 1 ? m->available() : SPARK_W - 1;
+        for (int a = n - 1; a >= 0; a--) drawSparkColumn(id, a);
+    }
+
+    void drawStatsHeader() {
+        int w = hw->tft.width();
+        hw->tft.fillRect(w - 80, 14, 75, 32, theme->BG_COLOR);
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_right);
+        hw->tft.drawString(system->getNode()->getVersion(), w - 10, 22);
+        hw->tft.drawString("up " + String(millis() / 1000) + "s", w - 10, 40);
+    }
+
+    void drawStatsPage() {
+        drawHeader("SYSTEM STATS", true); // Title with Back button
+        drawStatsHeader();
+
+        for (int id = 0; id < METRIC_COUNT; id++) {
+            hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+            hw->tft.setTextDatum(textdatum_t::middle_left);
+            hw->tft.drawString(METRIC_INFO[id].label, 8, statsRowY(id) + STATS_ROW_H / 2);
+
+            sparkScale[id] = 0;
+            updateSparkScale((MetricId)id);
+            drawStatsValue((MetricId)id);
+            drawSparkline((MetricId)id);
+        }
+        statsDrawnSamples = system->getMetrics()->sampleCount();
+        drawStatsLatency();
+        drawStatsHeap();
+    }
+
+    // Worst app by p95, the latency page has the rest
+    void drawStatsLatency() {
+        LatencyTracker* lat = system->getLatency();
+        latencyDrawnVersion = lat->version();
+        const UiRect& r = SET_STATS_TOUCH;
+        hw->tft.fillRect(r.x, r.y, r.w, r.h, theme->BG_COLOR);
+        hw->tft.drawFastHLine(r.x + 8, r.y, r.w - 16, theme->BORDER_COLOR);
+
+        const LatencyHistogram* worst = nullptr;
+        for (int i = 0; i < lat->size(); i++) {
+            const LatencyHistogram* h = lat->get(i);
+            if (!worst || h->percentile(95) > worst->percentile(95)) worst = h;
+        }
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
         hw->tft.setTextDatum(textdatum_t::middle_left);
-        hw->tft.drawString("Wi-Fi Signal", m + 15, ySig + hSig/2);
-        
-        // Draw Bars
-        int barStart = w - m - 70;
-        int barBottom = ySig + 35;
-        
-        for(int i=0; i<4; i++) {
-            int h = 8 + (i*6); // Ascending height
-            bool active = (i < bars);
-            uint16_t color = active ? (bars < 2 ? theme->ACCENT_ALERT : theme->ACCENT_PRIMARY) : theme->PANEL_SHADOW;
-            hw->tft.fillRect(barStart + (i*12), barBottom - h, 8, h, color);
+        hw->tft.drawString("Touch", 8, r.cy());
+        hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_right);
+        String v = worst ? String(worst->percentile(95)) + "ms >" : String("-- >");
+        hw->tft.drawString(v, r.right() - 8, r.cy());
+        hw->tft.setTextDatum(textdatum_t::top_left);
+    }
+
+    // App holding the most memory, the heap page has the rest
+    void drawStatsHeap() {
+        const UiRect& r = SET_STATS_HEAP;
+        hw->tft.fillRect(r.x, r.y, r.w, r.h, theme->BG_COLOR);
+        hw->tft.drawFastHLine(r.x, r.y, r.w - 8, theme->BORDER_COLOR);
+
+        const HeapTagStats* top = HeapAccounting::get().largestApp();
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_left);
+        hw->tft.drawString("Heap", r.x + 4, r.cy());
+        hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::middle_right);
+        String v = top ? String(top->name).substring(0, 5) + " " + String((top->liveBytes + 512) / 1024) + "k >" : String("-- >");
+        hw->tft.drawString(v, r.right() - 8, r.cy());
+        hw->tft.setTextDatum(textdatum_t::top_left);
+    }
+
+    // --- HEAP PER APP ---
+
+    void drawHeapPage() {
+        drawHeader("HEAP PER APP", true);
+
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::top_left);
+        hw->tft.drawString("Tag        live  peak  kept", 10, SET_HEAP_ROW_Y - 22);
+        hw->tft.drawFastHLine(10, SET_HEAP_ROW_Y - 4, UI_SCREEN_W - 20, theme->BORDER_COLOR);
+
+        drawHeapLeakButton();
+        drawButton(SET_HEAP_PEAKS, "RESET PEAKS", theme->ACCENT_PRIMARY, theme->TEXT_MAIN);
+        drawHeapRows();
+    }
+
+    void drawHeapLeakButton() {
+        bool on = HeapAccounting::get().isLeakCheck();
+        drawButton(SET_HEAP_LEAK, on ? "LEAK CHECK ON" : "LEAK CHECK", on ? theme->ACCENT_WARN : theme->PANEL_BG, theme->TEXT_MAIN);
+    }
+
+    // Bytes in k: one row per tag in use, a leak suspect in the alert color
+    void drawHeapRows() {
+        HeapAccounting& heap = HeapAccounting::get();
+        heapDrawnSamples = system->getMetrics()->sampleCount();
+        hw->tft.setTextDatum(textdatum_t::top_left);
+
+        char row[48];
+        int line = 0;
+        for (uint8_t i = 0; i < heap.size(); i++) {
+            int y = SET_HEAP_ROW_Y + line * SET_HEAP_ROW_H;
+            if (y + SET_HEAP_ROW_H > SET_LAT_ACTIONS.y) break;
+            const HeapTagStats* s = heap.at(i);
+            if (!s) continue;
+            hw->tft.fillRect(10, y, UI_SCREEN_W - 20, SET_HEAP_ROW_H - 1, theme->BG_COLOR);
+            if (s->cycles) snprintf(row, sizeof(row), "%-8.8s %6.1f %5.1f %+5ld", s->name, s->liveBytes / 1024.0f,
+                                    s->peakBytes / 1024.0f, (long)s->lastKeptBytes);
+            else snprintf(row, sizeof(row), "%-8.8s %6.1f %5.1f     -", s->name, s->liveBytes / 1024.0f, s->peakBytes / 1024.0f);
+            hw->tft.setTextColor(s->growing >= HEAP_LEAK_CYCLES ? theme->ACCENT_ALERT : theme->TEXT_MAIN, theme->BG_COLOR);
+            hw->tft.drawString(row, 10, y);
+            line++;
+        }
+    }
+
+    // --- TOUCH LATENCY ---
+
+    void drawLatencyPage() {
+        drawHeader("TOUCH LATENCY", true);
+
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        hw->tft.setTextDatum(textdatum_t::top_left);
+        hw->tft.drawString("App        n  p50  p95  p99", 10, SET_LAT_ROW_Y - 22);
+        hw->tft.drawFastHLine(10, SET_LAT_ROW_Y - 4, UI_SCREEN_W - 20, theme->BORDER_COLOR);
+
+        drawButton(SET_LAT_RESET, "RESET", theme->ACCENT_ALERT, theme->TEXT_MAIN);
+        drawButton(SET_LAT_EXPORT, "EXPORT", theme->ACCENT_PRIMARY, theme->TEXT_MAIN);
+        drawLatencyRows();
+    }
+
+    void drawLatencyRows() {
+        LatencyTracker* lat = system->getLatency();
+        latencyDrawnVersion = lat->version();
+        hw->tft.setTextDatum(textdatum_t::top_left);
+
+        char row[48];
+        for (int i = 0; i < LATENCY_APPS; i++) {
+            int y = SET_LAT_ROW_Y + i * SET_LAT_ROW_H;
+            hw->tft.fillRect(10, y, UI_SCREEN_W - 20, SET_LAT_ROW_H - 2, theme->BG_COLOR);
+            const LatencyHistogram* h = lat->get(i);
+            if (!h) continue;
+            snprintf(row, sizeof(row), "%-9.9s %3u %4u %4u %4u", h->name, h->samples,
+                     h->percentile(50), h->percentile(95), h->percentile(99));
+            hw->tft.setTextColor(theme->TEXT_MAIN, theme->BG_COLOR);
+            hw->tft.drawString(row, 10, y);
+        }
+
+        int y = SET_LAT_ROW_Y + LATENCY_APPS * SET_LAT_ROW_H;
+        hw->tft.fillRect(10, y, UI_SCREEN_W - 20, SET_LAT_ROW_H - 2, theme->BG_COLOR);
+        hw->tft.setTextColor(theme->TEXT_MUTED, theme->BG_COLOR);
+        hw->tft.drawString("No response: " + String(lat->droppedCount()), 10, y);
+    }
+
+    // Draws only the columns sampled since the last frame
+    void drawStatsUpdate() {
+        MetricsSampler* m = system->getMetrics();
+        uint32_t fresh = m->sampleCount() - statsDrawnSamples;
+        if (fresh > SPARK_W) fresh = SPARK_W;
+        statsDrawnSamples = m->sampleCount();
+
+        drawStatsHeader();
+        drawStatsHeap();
+        for (int id = 0; id < METRIC_COUNT; id++) {
+            drawStatsValue((MetricId)id);
+            if (updateSparkScale((MetricId)id)) { drawSparkline((MetricId)id); continue; }
+            for (int a = fresh - 1; a >= 0; a--) drawSparkColumn((MetricId)id, a);
         }
-        
-        // dBm Text (Tiny)
-        hw->tft.setTextColor(theme->TEXT_MUTED, theme->PANEL_BG);
-        hw->tft.setTextDatum(textdatum_t::top_right);
-        hw->tft.drawString(String(rssi) + "dBm", w - m - 10, ySig + 10);
     }
 
     // --- TOUCH LOGIC ---
@@ -404,29 +701,16 @@ public:
         if (!hw->isTouching) return;
         delay(200);
 
-        int tx = hw->touchX;
-        int ty = hw->touchY;
-        
         // Header / Back check (if needed later)
-        if (ty < 50 && tx < 50) { system->launchApp((u8_t)0); return; }
-
-        // Grid Hit Detection
-        // Approx Y range: Row 1 (60-150), Row 2 (160-250)
-        // Approx X range: Col 1 (0-120), Col 2 (120-240)
-        
-        int row = -1;
-        int col = -1;
-
-        if (ty > 60 && ty < 150) row = 0;
-        else if (ty > 160 && ty < 250) row = 1;
-
-        if (tx < 120) col = 0;
-        else col = 1;
+        if (hw->isTouchIn(SET_BACK)) { system->launchApp((u8_t)0); return; }
 
-        if (row != -1 && col != -1) {
-            int index = (row * 2) + col;
-            
-            if (index == 0) { currentState = PAGE_WIFI_SCAN; needsRedraw = true; }
+        int index = UI_HIT(SET_TILES_HIT, hw->touchX, hw->touchY);
+        if (index >= 0) {
+            if (index == 0) {
+                currentState = PAGE_WIFI_SCAN; needsRedraw = true;
+                wifiScroll = 0;
+                system->getWifiScanner()->start();
+            }
             if (index == 1) { btEnabled = !btEnabled; needsRedraw = true; }
             if (index == 2) { currentState = PAGE_DAAS; needsRedraw = true; }
             if (index == 3) { currentState = PAGE_STATS; needsRedraw = true; }
@@ -437,14 +721,29 @@ public:
         if (!hw->isTouching) return;
         delay(200);
 
-        if (hw->isTouchInRect(0, 0, 50, 40)) {
+        WifiScanner* scanner = system->getWifiScanner();
+
+        if (hw->isTouchIn(SET_BACK)) {
+            scanner->stop();
             currentState = PAGE_MAIN; needsRedraw = true; return;
         }
 
-        int index = (hw->touchY - 50) / ITEM_H;
-        if (index >= 0) {
-            targetSSID = WiFi.SSID(index);
+        // Footer scroll arrows
+        if (hw->isTouchIn(SET_WIFI_FOOTER)) {
+            if (hw->isTouchIn(SET_WIFI_UP) && wifiScroll > 0) wifiScroll--;
+            else if (hw->isTouchIn(SET_WIFI_DOWN) && wifiScroll + SET_WIFI_ROWS < scanner->size()) wifiScroll++;
+            drawWifiList();
+            return;
+        }
+
+        int row = UI_HIT(SET_WIFI_ROWS_HIT, hw->touchX, hw->touchY);
+        const WifiNetwork* net = row >= 0 ? scanner->get(wifiScroll + row) : nullptr;
+        if (net) {
+            targetSSID = net->ssid;
+            targetNet = *net;
+            targetKnown = true;
             inputBuffer = "";
+            scanner->stop();
             currentState = PAGE_WIFI_KEYBOARD;
             needsRedraw = true;
         }
@@ -453,23 +752,21 @@ public:
     void handleDaasTouch() {
         if (!hw->isTouching) return;
         delay(200);
-        int w = hw->tft.width();
 
         // Back Button (Top Left)
-        if (hw->touchY < 50 && hw->touchX < 50) {
+        if (hw->isTouchIn(SET_BACK)) {
             currentState = PAGE_MAIN; needsRedraw = true; return;
         }
 
-        bool wifiReady = (WiFi.status() == WL_CONNECTED);
+        bool wifiReady = system->getNetwork()->get().wifiUp;
         bool btReady = btEnabled;
 
-        // ENABLE DRIVER BUTTON (Y: 170, H: 45)
-        if (hw->isTouchInRect(10, 170, w - 20, 45)) {
+        // ENABLE DRIVER BUTTON
+        if (hw->isTouchIn(SET_DAAS_DRIVER)) {
             if (wifiReady) {
-                String uri = WiFi.localIP().toString() + ":9909";
-                system->getNode()->enableDriver(_LINK_INET4, uri.c_str());
-                ToastManager::getInstance()->show("Driver Enabled (Wi-Fi)", TOAST_INFO, 2500);
-                // Optional: Show visual feedback
+                // Manual retry, e.g. after the automatic bind failed
+                if (system->getNetwork()->enableDaasDriver()) ToastManager::getInstance()->show("Driver Enabled (Wi-Fi)", TOAST_INFO, 2500);
+                else ToastManager::getInstance()->show("Driver Failed (Wi-Fi)", TOAST_ERROR, 2500);
             } 
             else if (btReady) {
                 // Assuming you have a specific driver constant for BT, e.g., _LINK_BLUETOOTH
@@ -480,9 +777,7 @@ public:
         }
 
         // UNBIND (Bottom Left)
-        int bottomY = 230;
-        int btnW = (w - 30) / 2;
-        if (hw->isTouchInRect(10, bottomY, btnW, 45)) {
+        if (hw->isTouchIn(SET_DAAS_UNBIND)) {
             system->getNode()->unbindNetwork();
             system->daasNetworkConnected = false;
             needsRedraw = true;
@@ -490,17 +785,85 @@ public:
         }
 
         // DISCOVER (Bottom Right)
-        if (hw->isTouchInRect(20 + btnW, bottomY, btnW, 45)) {
+        if (hw->isTouchIn(SET_DAAS_DISCOVER)) {
             system->getNode()->discovery();
             ToastManager::getInstance()->show("Discovery Started", TOAST_INFO, 1000);
         }
+
+        // LINK BENCHMARK
+        if (hw->isTouchIn(SET_DAAS_BENCH)) {
+            currentState = PAGE_BENCH; needsRedraw = true;
+        }
+    }
+
+    void handleBenchTouch() {
+        if (!hw->isTouching) return;
+        delay(200);
+        BenchmarkRunner* bench = system->getBenchmark();
+
+        if (hw->isTouchIn(SET_BACK)) {
+            currentState = PAGE_DAAS; needsRedraw = true; return;
+        }
+
+        // Target selector (locked while running)
+        if (hw->isTouchIn(SET_BENCH_TARGET) && bench->getState() != BENCH_RUNNING) {
+            selectBenchTarget(benchTargetIdx + 1);
+            needsRedraw = true;
+        }
+
+        // RUN / STOP
+        if (hw->isTouchIn(SET_BENCH_RUN)) {
+            if (bench->getState() == BENCH_RUNNING) bench->stop();
+            else bench->start(benchTarget, benchTargetIdx < 0);
+            drawBenchProgress();
+        }
     }
 
     void handleStatsTouch() {
         if (!hw->isTouching) return;
         delay(200);
-        if (hw->isTouchInRect(0, 0, 100, 40)) { 
+        if (hw->isTouchIn(SET_BACK)) {
             currentState = PAGE_MAIN; needsRedraw = true;
         }
+        else if (hw->isTouchIn(SET_STATS_TOUCH)) {
+            currentState = PAGE_LATENCY; needsRedraw = true;
+        }
+        else if (hw->isTouchIn(SET_STATS_HEAP)) {
+            currentState = PAGE_HEAP; needsRedraw = true;
+        }
+    }
+
+    void handleHeapTouch() {
+        if (!hw->touchPressed) return;
+        HeapAccounting& heap = HeapAccounting::get();
+
+        if (hw->isTouchIn(SET_BACK)) {
+            currentState = PAGE_STATS; needsRedraw = true;
+        }
+        else if (hw->isTouchIn(SET_HEAP_LEAK)) {
+            heap.setLeakCheck(!heap.isLeakCheck());
+            drawHeapLeakButton();
+        }
+        else if (hw->isTouchIn(SET_HEAP_PEAKS)) {
+            heap.resetPeaks();
+            drawHeapRows();
+        }
+    }
+
+    void handleLatencyTouch() {
+        if (!hw->touchPressed) return;
+        LatencyTracker* lat = system->getLatency();
+
+        if (hw->isTouchIn(SET_BACK)) {
+            currentState = PAGE_STATS; needsRedraw = true;
+        }
+        else if (hw->isTouchIn(SET_LAT_RESET)) {
+            lat->reset();
+        }
+        else if (hw->isTouchIn(SET_LAT_EXPORT)) {
+            lat->exportCsv(system->getStorage());
+            lat->print(Serial);
+            ToastManager::getInstance()->show(hw->sdAvailable ? "Saved to " LATENCY_CSV_FILE : "Saved to flash", TOAST_SUCCESS);
+        }
     }
 };
\ No newline at end of file
@@ -16,4 +16,22 @@ void daas_node_event::dinAccepted(din_t din) {
 }
 
 void daas_node_event::ddoReceived(int payload_size, typeset_t typeset, din_t din) {
-}
\ No newline at end of file
+    system->getTrace()->record(TRACE_DDO, system->currentAppID(), typeset);
+    system->addNode(din);
+    system->postEvent({APP_EVENT_DDO, typeset, din});
+}
+
+void daas_node_event::frisbeeReceived(din_t din) {
+    system->getLiveness()->onReply(din);
+}
+
+void daas_node_event::nodeDiscovered(din_t din, link_t link) {
+    system->getTrace()->record(TRACE_NODE, system->currentAppID(), (uint32_t)din);
+    system->addNode(din, link);
+    system->postEvent({APP_EVENT_NODE, 0, din});
+}
+
+void daas_node_event::frisbeeDperfCompleted(din_t din, uint32_t packets_sent, uint32_t block_size) {
+    system->getBenchmark()->onCompleted(din, packets_sent, block_size);
+    system->onDperfCompleted(din);
+}
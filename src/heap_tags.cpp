@@ -0,0 +1,26 @@
+#include <new>
+#include "os/modules/heap_tags.hpp"
+
+// Global operator new/delete, counted per app (see HeapAccounting)
+
+static void* taggedNew(size_t size) {
+    void* p = HeapAccounting::get().alloc(size);
+    if (p) return p;
+#if __cpp_exceptions
+    throw std::bad_alloc();
+#else
+    abort();
+#endif
+}
+
+void* operator new(size_t size) { return taggedNew(size); }
+void* operator new[](size_t size) { return taggedNew(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return HeapAccounting::get().alloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return HeapAccounting::get().alloc(size); }
+
+void operator delete(void* p) noexcept { HeapAccounting::get().release(p); }
+void operator delete[](void* p) noexcept { HeapAccounting::get().release(p); }
+void operator delete(void* p, size_t) noexcept { HeapAccounting::get().release(p); }
+void operator delete[](void* p, size_t) noexcept { HeapAccounting::get().release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { HeapAccounting::get().release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { HeapAccounting::get().release(p); }
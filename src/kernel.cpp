@@ -2,6 +2,25 @@
 #include "themes/default_theme.hpp"
 #include "os/modules/toastmessages.hpp"
 
+#define NODE_AGING_PERIOD_MS 30000
+#define NODE_MAX_AGE_MS (15UL * 60 * 1000) // Drop nodes silent for 15 minutes
+#define PAGE_TRANSITION_MS 180
+#define BOOT_FRAME_MS 16
+#define SLOW_LOOP_US 50000         // Loops slower than this land in the trace
+#define DPERF_TIMEOUT_MS 30000     // One-shot dperf from the console
+#define CONSOLE_MAX_TASKS 24
+#define CONSOLE_SHOT_PIXELS 24     // Per step: 96 hex chars, fits CONSOLE_JOB_ROOM
+#define BACKGROUND_PERIOD_MS 100   // Each background app ticks at most this often
+#define BACKGROUND_BUDGET_US 4000  // Per loop, for all background ticks together
+#define APP_EVENTS_PER_LOOP 8
+
+#define LOG_FILE "/system.mlog"            // Binary records, tools/decode_log.py
+#define LOG_FILE_HEADER "MLOG1\n"
+#define LOG_FILE_MAX (512UL * 1024)        // Then rotated to LOG_FILE.1
+
+#define FONT_FULL_PATH "/fonts/full14.mfnt"        // subset_fonts.py --full output, on SD
+#define FONT_FULL_LARGE_PATH "/fonts/full24.mfnt"
+
 ThemePalette DEFAULT_THEME = {
     0x1082, // Deep Dark Slate (Background)
     0x2124, // Lighter Slate (Key/Tile surface)
@@ -17,14 +36,31 @@ ThemePalette DEFAULT_THEME = {
 
 void Kernel::boot() {
     currentTheme = &DEFAULT_THEME; // Later: Load from JSON
+    HeapAccounting::get().init(); // Allocations of other tasks are counted apart from now on
 
     hardware.init(); // Init SD first
-    registry.init(&hardware); // Then load apps
+    network.init(&node); // Before the saved network comes up
+    storage.begin(&hardware); // SD is only touched by the storage task from now on
+
+    // Boot messages so far wait in the ring, the log task drains them from now on
+    Logger::getInstance()->setFileSink([this](const uint8_t* bytes, size_t len) {
+        storage.append(LOG_FILE, bytes, len, LOG_FILE_HEADER, nullptr, LOG_FILE_MAX);
+    });
+    Logger::getInstance()->begin();
+    registry.init(&hardware, &storage); // Then load apps
+
+    // Read-only assets are mapped, never copied: no storage I/O when drawing
+    if (assets.open()) sysLog(LOG_ASSETS_MAPPED, assets.size());
+    else sysLog(LOG_ASSETS_MISSING);
+    loadFonts();
+
+    uint32_t lexiconLen = 0;
+    const uint8_t* lexicon = assets.lexicon("lexicon/en", &lexiconLen);
+    if (!predictor.begin(lexicon, lexiconLen, &storage)) sysLog(LOG_LEXICON_MISSING);
     
     bootAnimation();
     
-    discoveredNodes.clear();
-    discoveredNodes.reserve(10);
+    nodeDirectory.clear();
     
     node.doInit(0x0, 0x0); // Dummy DIN/SID for now
     
@@ -32,41 +68,458 @@ void Kernel::boot() {
     node.setDDOPolicy(ddo_policy_skip_on_failure);
     node.setDiscoveryState(discovery_sender_only);
     node.setATSMaxError(250);
+
+    liveness.init(&nodeDirectory, &node);
+    benchmark.init(&node, &storage, &network);
+    metrics.init(&node, &hardware, &network);
     
-    keyboard.init(&hardware, currentTheme);
-    ToastManager::getInstance()->init(&hardware, currentTheme);
+    mirror.init(&hardware, &node);
+    screenshots.init(&hardware, &storage);
+    watchdog.init(&storage, &trace, &screenshots); // Stalls from before the reset go to the file
+    keyboard.init(&hardware, currentTheme, &predictor);
+    ToastManager::getInstance()->init(&hardware, currentTheme, &animations);
+    initConsole();
 
     delay(500);
 }
 
 void Kernel::run() 
  {
-    static bool wasToastActive = false;
-    bool isToastActive = ToastManager::getInstance()->isActive();
-    
+    uint32_t loopStart = micros();
+    // Phases are attributed to the foreground app, the budgets of the app phase are per app
+    uint8_t appId = currentAppID();
+    const char* appName = currentApp ? currentApp->getName() : "system";
+    watchdog.enter(PHASE_DAAS, appId, appName);
     node.doPerform(PERFORM_CORE_NO_THREAD);
 
+    watchdog.enter(PHASE_SERVICES, appId, appName);
+    network.update();
+    storage.update();
+
+    if (millis() - lastNodeAging > NODE_AGING_PERIOD_MS) {
+        nodeDirectory.age(node.getSyncedTimestamp(), NODE_MAX_AGE_MS);
+        lastNodeAging = millis();
+    }
+    liveness.update();
+    benchmark.update();
+    metrics.loopTick();
+    metrics.update();
+    wifiScanner.update();
+    predictor.update();
+
+    watchdog.enter(PHASE_CONSOLE, appId, appName);
+    console.update();
+    trace.echoPending(Serial);
+    if (dperfTarget != 0 && millis() - dperfStart > DPERF_TIMEOUT_MS) {
+        Serial.println("DPERF timeout");
+        dperfTarget = 0;
+        benchmark.holdDperf(false);
+    }
+
+    watchdog.enter(PHASE_INPUT, appId, appName);
     hardware.updateInput();
+    hardware.serviceWifi();
+
+    // The touch belongs to the app it is dispatched to (none mid-transition)
+    if (hardware.touchPressed && currentApp) {
+        latency.touch(hardware.touchMicros, hardware.tft.panelWrites(), currentApp->getAppID(), currentApp->getName());
+        trace.record(TRACE_TOUCH, currentApp->getAppID(), (uint32_t)hardware.touchX << 16 | hardware.touchY);
+    }
 
+    watchdog.enter(PHASE_APP, appId, appName);
     if (currentApp) {
+        // A full repaint would bury the toast: lift it first, it comes back on top
+        if (currentApp->redrawPending()) ToastManager::getInstance()->invalidate();
+        HeapScope tag(appId, appName);
         currentApp->onUpdate();
     }
 
+    watchdog.enter(PHASE_UI, appId, appName);
     ToastManager::getInstance()->update();
+    animations.update();
+
+    // First loop that drew since the touch: closed once the transfer drained
+    if (latency.responded(hardware.tft.panelWrites())) {
+        hardware.tft.waitDMA();
+        latency.close(micros());
+    } else {
+        latency.expire(micros());
+    }
+
+    // After the latency sample: reading the panel back waits for the flush
+    watchdog.enter(PHASE_DIAG, appId, appName);
+    mirror.update();
+    screenshots.update();
+
+    // Fallback glyphs landed: text drawn with placeholders is stale
+    uint32_t fontVersion = uiFont.fallbackVersion() + uiFontLarge.fallbackVersion();
+    if (fontVersion != fontDrawnVersion) {
+        fontDrawnVersion = fontVersion;
+        if (currentApp) currentApp->forceRedraw();
+    }
+
+    runBackground();
+    watchdog.idle();
+
+    uint32_t loopUs = micros() - loopStart;
+    if (loopUs > SLOW_LOOP_US) trace.record(TRACE_SLOW_LOOP, currentAppID(), loopUs);
+}
 
-    if (wasToastActive && !isToastActive) {
-        if (currentApp) {
-            currentApp->forceRedraw(); 
+static const char* const SYSCODE_NAMES[] = {
+    "dme_sended", "dme_received", "dme_routed", "rx_buffer", "tx_buffer",
+    "ats_delta_avg", "ats_sync_counter", "ats_msg_decoded", "ats_msg_encoded"
+};
+#define SYSCODE_COUNT (sizeof(SYSCODE_NAMES) / sizeof(SYSCODE_NAMES[0]))
+
+static const char* const TASK_STATES[] = {"run", "ready", "block", "susp", "del", "?"};
+
+void Kernel::initConsole() {
+    console.init(&Serial);
+
+    console.add("tasks", "FreeRTOS tasks: state, priority, stack left, CPU share", [this](const String&, Print& out) {
+#if configUSE_TRACE_FACILITY
+        // Snapshot now, printed a line per step
+        static TaskStatus_t status[CONSOLE_MAX_TASKS];
+        if (console.jobRunning()) {
+            out.println("ERR console busy");
+            return;
+        }
+        uint32_t total = 0;
+        UBaseType_t n = uxTaskGetSystemState(status, CONSOLE_MAX_TASKS, &total);
+        if (n == 0) out.printf("ERR more than %d tasks\n", CONSOLE_MAX_TASKS);
+        total /= 100;   // Percent
+        console.startLines(n + 1, [this, n, total](uint16_t i, Print& o) {
+            if (i == n) {
+                o.printf("app: %s id=%u\n", currentApp ? currentApp->getName() : "-", currentAppID());
+                return;
+            }
+            const TaskStatus_t& t = status[i];
+#if configGENERATE_RUN_TIME_STATS
+            unsigned cpu = total ? t.ulRunTimeCounter / total : 0;
+#else
+            unsigned cpu = 0;
+#endif
+            o.printf("%-16s %-5s prio=%-2u stack=%-5u cpu=%u%%\n", t.pcTaskName, TASK_STATES[t.eCurrentState < 5 ? t.eCurrentState : 5],
+                     (unsigned)t.uxCurrentPriority, (unsigned)t.usStackHighWaterMark, cpu);
+        });
+#else
+        out.printf("tasks: %u (trace facility disabled)\n", (unsigned)uxTaskGetNumberOfTasks());
+        out.printf("app: %s id=%u\n", currentApp ? currentApp->getName() : "-", currentAppID());
+#endif
+    });
+
+    // heap | heap leak on|off | heap peaks
+    console.add("heap", "free, fragmentation, per-app use: heap [leak on|off | peaks]", [](const String& args, Print& out) {
+        HeapAccounting& tags = HeapAccounting::get();
+        if (args.startsWith("leak")) tags.setLeakCheck(args.endsWith("on"));
+        else if (args == "peaks") tags.resetPeaks();
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+        unsigned frag = info.total_free_bytes ? 100 - (100 * info.largest_free_block) / info.total_free_bytes : 0;
+        out.printf("free=%u min=%u largest=%u frag=%u%% used=%u blocks=%u/%u\n", (unsigned)info.total_free_bytes,
+                   (unsigned)info.minimum_free_bytes, (unsigned)info.largest_free_block, frag,
+                   (unsigned)info.total_allocated_bytes, (unsigned)info.allocated_blocks, (unsigned)info.total_blocks);
+        tags.print(out);
+    });
+
+    // A node per step: the directory may change between lines
+    console.add("nodes", "node directory", [this](const String&, Print& out) {
+        uint16_t slot = 0;
+        bool started = console.startJob([this, slot](Print& o) mutable {
+            while (slot < NODE_DIR_SLOTS && !nodeDirectory.slotAt(slot)) slot++;
+            if (slot == NODE_DIR_SLOTS) {
+                o.printf("%u nodes\n", nodeDirectory.size());
+                return true;
+            }
+            const NodeRecord* r = nodeDirectory.slotAt(slot++);
+            stime_t now = node.getSyncedTimestamp();
+            o.printf("%016llx link=%u rtt=", (unsigned long long)r->din, r->link);
+            if (r->rtt == NODE_RTT_UNKNOWN) o.print("-");
+            else o.printf("%u", r->rtt);
+            o.printf(" loss=%u%% seen=%lus ago\n", (r->loss * 100) / 255, (unsigned long)((now - r->lastSeen) / 1000));
+            return false;
+        });
+        if (!started) out.println("ERR console busy");
+    });
+
+    // syscode <n> | syscode all
+    console.add("syscode", "DaaS counter: syscode <1-9|all>", [this](const String& args, Print& out) {
+        long id = args.toInt();
+        bool all = args == "all" || args.length() == 0;
+        if (!all && (id < 1 || id > (long)SYSCODE_COUNT)) {
+            out.printf("ERR syscode 1-%u\n", (unsigned)SYSCODE_COUNT);
+            return;
+        }
+        unsigned first = all ? 1 : id;
+        bool started = console.startLines(all ? SYSCODE_COUNT : 1, [this, first](uint16_t i, Print& o) {
+            unsigned c = first + i;
+            o.printf("%u %-16s %llu\n", c, SYSCODE_NAMES[c - 1], (unsigned long long)node.getSystemStatistics((syscode_t)c));
+        });
+        if (!started) out.println("ERR console busy");
+    });
+
+    console.add("discovery", "start a discovery on every link", [this](const String&, Print& out) {
+        out.printf("discovery: %s\n", node.discovery() == ERROR_NONE ? "started" : "failed");
+    });
+
+    // dperf <din> [packets] [block]: one frisbeeDPERF, result printed when it completes
+    console.add("dperf", "one frisbeeDPERF run: dperf <din> [packets] [block]", [this](const String& args, Print& out) {
+        unsigned long long din = 0;
+        unsigned packets = 10, block = 1024;
+        if (sscanf(args.c_str(), "%lli %u %u", &din, &packets, &block) < 1 || din == 0) {
+            out.println("ERR dperf <din> [packets] [block]");
+            return;
+        }
+        if (dperfTarget != 0 || benchmark.getState() == BENCH_RUNNING) {
+            out.println("ERR a benchmark is running");
+            return;
+        }
+        if (node.frisbeeDPERF(din, packets, block, 0) != ERROR_NONE) {
+            out.println("ERR dperf failed");
+            return;
+        }
+        dperfTarget = din;
+        dperfStart = millis();
+        benchmark.holdDperf(true);
+    });
+
+    // bench <din> | bench loop | bench stop
+    console.add("bench", "frisbeeDPERF sweep to CSV: bench <din>|loop|stop", [this](const String& args, Print& out) {
+        if (args == "stop") {
+            benchmark.stop();
+            return;
+        }
+        if (benchmark.getState() == BENCH_RUNNING) {
+            out.println("ERR a benchmark is running");
+            return;
+        }
+        bool started = args == "loop" ? benchmark.start(0, true, true) : benchmark.start(strtoull(args.c_str(), nullptr, 0), false, true);
+        if (!started) out.printf("ERR bench: %s\n", benchmark.getError());
+    });
+
+    // shot: the framebuffer as hex RGB565 rows, streamed while the TX buffer has room
+    // shot sd: BMP file on storage | shot trigger <console|gesture|watchdog> on|off
+    console.add("shot", "screenshot: shot (hex on Serial) | shot sd | shot trigger <kind> on|off", [this](const String& args, Print& out) {
+        static const char* const TRIGGERS[] = {"console", "gesture", "watchdog"};
+        if (args == "sd") {
+            if (screenshots.capture(SHOT_TRIGGER_CONSOLE)) out.println("shot: capturing");
+            else out.println("ERR shot: disabled, busy or no storage");
+            return;
+        }
+        if (args.startsWith("trigger")) {
+            uint8_t t = screenshots.getTriggers();
+            for (uint8_t i = 0; i < 3; i++) {
+                if (args.indexOf(TRIGGERS[i]) < 0) continue;
+                if (args.endsWith("on")) t |= 1 << i;
+                else if (args.endsWith("off")) t &= ~(1 << i);
+            }
+            screenshots.setTriggers(t);
+            for (uint8_t i = 0; i < 3; i++) out.printf("shot trigger %s %s\n", TRIGGERS[i], (t >> i) & 1 ? "on" : "off");
+            return;
+        }
+        if (console.jobRunning()) {
+            out.println("ERR console busy");
+            return;
+        }
+        shotRow = 0;
+        shotCol = 0;
+        console.startJob([this](Print& o) {
+            uint16_t px[CONSOLE_SHOT_PIXELS];
+            int w = hardware.tft.width();
+            if (shotRow == 0 && shotCol == 0) o.printf("SHOT %d %d\n", w, hardware.tft.height());
+            int n = min(CONSOLE_SHOT_PIXELS, w - shotCol);
+            hardware.tft.readRect(shotCol, shotRow, n, 1, px);
+            for (int i = 0; i < n; i++) o.printf("%04x", __builtin_bswap16(px[i]));   // Read back byte-swapped
+            shotCol += n;
+            if (shotCol < w) return false;
+            o.print("\n");
+            shotCol = 0;
+            if (++shotRow < hardware.tft.height()) return false;
+            o.println("SHOT end");
+            shotRow = -1;
+            return true;
+        });
+    });
+
+    // trace on | trace off | trace dump | trace mark <n>
+    console.add("trace", "event trace: trace on|off|dump|mark <n>", [this](const String& args, Print& out) {
+        if (args == "on" || args == "off") trace.setEcho(args == "on");
+        else if (args.startsWith("mark")) trace.record(TRACE_MARK, currentAppID(), args.substring(4).toInt());
+        else if (!trace.dump(console)) out.println("ERR console busy");
+        out.printf("trace echo %s\n", trace.isEchoing() ? "on" : "off");
+    });
+
+    // mirror serial [fps] [B/s] | mirror ddo <din> [fps] [B/s] | mirror key | mirror stop
+    console.add("mirror", "screen mirror: serial|ddo <din> [fps] [B/s], key, stop", [this](const String& args, Print& out) {
+        unsigned long long din = 0;
+        unsigned fps = 0, rate = 0;
+        if (args.startsWith("serial")) {
+            sscanf(args.c_str() + 6, "%u %u", &fps, &rate);
+            mirror.start(MIRROR_SERIAL, 0, fps, rate);
+        } else if (args.startsWith("ddo")) {
+            if (sscanf(args.c_str() + 3, "%lli %u %u", &din, &fps, &rate) < 1 || !mirror.start(MIRROR_DDO, din, fps, rate)) {
+                out.println("ERR mirror ddo <din> [fps] [B/s]");
+            }
+        } else if (args == "key") {
+            mirror.keyframe();
+        } else if (args == "stop") {
+            mirror.stop();
+        }
+        static const char* const MODES[] = {"off", "serial", "ddo"};
+        out.printf("mirror %s fps=%u rate=%u frames=%u bytes=%u last=%u busy=%ums\n", MODES[mirror.getTransport()],
+                   mirror.getFps(), mirror.getByteRate(), mirror.getFrames(), mirror.getBytes(),
+                   mirror.getLastFrameBytes(), mirror.getBusyUs() / 1000);
+    });
+
+    // font full on | font full off
+    console.add("font", "SD glyph fallback: font full on|off", [this](const String& args, Print& out) {
+        if (args.startsWith("full")) setFullFont(args.endsWith("on"));
+        out.printf("FONT: full fallback %s\n", isFullFont() ? "on" : "off");
+    });
+
+    // tap <x> <y> [hold ms]: scripted touch (tools/latency_check.py)
+    console.add("tap", "scripted touch: tap <x> <y> [hold ms]", [this](const String& args, Print&) {
+        int x = 0, y = 0, hold = 80;
+        if (sscanf(args.c_str(), "%d %d %d", &x, &y, &hold) >= 2) hardware.injectTap(x, y, hold);
+    });
+
+    // log | log level <debug|info|warn|error|off> | log serial on|off | log sd on|off
+    console.add("log", "log level <debug..off>, log serial|sd on|off", [](const String& args, Print& out) {
+        static const char* const LEVELS[] = {"debug", "info", "warn", "error", "off"};
+        Logger* log = Logger::getInstance();
+        if (args.startsWith("level ")) {
+            String name = args.substring(6);
+            for (uint8_t l = LOG_LEVEL_DEBUG; l <= LOG_LEVEL_OFF; l++) {
+                if (name == LEVELS[l]) log->setLevel((LogLevel)l);
+            }
+        } else if (args.startsWith("serial")) {
+            log->setSerial(args.endsWith("on"));
+        } else if (args.startsWith("sd")) {
+            log->setFile(args.endsWith("on"));
+        }
+        out.printf("log level=%s serial=%s sd=%s pending=%u dropped=%u\n", LEVELS[log->getLevel()],
+                   log->isSerial() ? "on" : "off", log->isFile() ? "on" : "off", log->pending(), log->droppedCount());
+    });
+
+    // latency | latency reset | latency export
+    console.add("latency", "touch-to-photon per app: latency [reset|export]", [this](const String& args, Print& out) {
+        if (args == "reset") latency.reset();
+        else if (args == "export") latency.exportCsv(&storage);
+        latency.print(out);
+    });
+
+    console.add("apps", "launched apps: state, pending events", [this](const String&, Print& out) {
+        static const char* const STATES[] = {"stopped", "front", "background", "suspended"};
+        for (int i = 0; i < taskManager.appSlots(); i++) {
+            Application* app = taskManager.appAt(i);
+            if (app) out.printf("%3u %-12s %s\n", app->getAppID(), app->getName(), STATES[app->getState()]);
+        }
+        out.printf("events pending=%lu dropped=%lu\n", (unsigned long)appEvents.pending(), (unsigned long)appEvents.droppedCount());
+    });
+
+    // wd | wd phase <name> <ms> | wd app <id> <ms> | wd clear
+    console.add("wd", "loop watchdog: wd [phase <name> <ms> | app <id> <ms> | clear]", [this](const String& args, Print& out) {
+        if (console.jobRunning()) {
+            out.println("ERR console busy");
+            return;
+        }
+        char name[12];
+        unsigned id = 0, ms = 0;
+        if (sscanf(args.c_str(), "phase %11s %u", name, &ms) == 2) {
+            uint8_t p = 0;
+            while (p < PHASE_COUNT && strcmp(name, PHASE_NAMES[p]) != 0) p++;
+            if (p == PHASE_COUNT || ms == 0) out.println("ERR wd phase <daas|services|console|input|app|ui|diag|bg> <ms>");
+            else watchdog.setPhaseBudget((LoopPhase)p, ms * 1000UL);
+        } else if (sscanf(args.c_str(), "app %u %u", &id, &ms) == 2) {
+            if (id > 0xFE || ms == 0 || !watchdog.setAppBudget(id, ms * 1000UL)) out.println("ERR wd app <id> <ms>");
+        } else if (args == "clear") {
+            watchdog.clear();
+        }
+        for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+            out.printf("%s=%lums ", PHASE_NAMES[p], (unsigned long)(watchdog.getPhaseBudget((LoopPhase)p) / 1000));
+        }
+        out.println();
+        // Up to WD_RECORDS records of WD_TRACE_KEEP trace lines: a line per step
+        uint32_t head = watchdog.head();
+        console.startLines(watchdog.lineCount(head), [this, head](uint16_t i, Print& o) { watchdog.printLine(head, i, o); });
+    });
+}
+
+// Event or tick outside onUpdate: time and heap are the app's. Off screen
+// its panel writes are dropped; the app in front draws and is timed
+// against its app-phase budget, not the background one.
+void Kernel::runOffscreen(Application* app, const AppEvent* event) {
+    bool offscreen = app != currentApp;
+    watchdog.enter(offscreen ? PHASE_BACKGROUND : PHASE_APP, app->getAppID(), app->getName());
+    HeapScope tag(app->getAppID(), app->getName());
+    uint32_t dropped = hardware.tft.mutedWrites();
+    if (offscreen) hardware.tft.setMuted(true);
+    if (event) app->onEvent(*event);
+    else app->onBackgroundTick();
+    if (offscreen) hardware.tft.setMuted(false);
+    if (hardware.tft.mutedWrites() != dropped) sysLog(LOG_APP_BG_DRAW, app->getName(), hardware.tft.mutedWrites() - dropped);
+}
+
+// Events to the app in front and the background apps, then a round of
+// background ticks within BACKGROUND_BUDGET_US per loop; a round that does
+// not fit continues in the next loop where it stopped. Suspended apps get
+// neither: they read the kernel's state again when brought back to the front.
+void Kernel::runBackground() {
+    AppEvent event;
+    for (int n = 0; n < APP_EVENTS_PER_LOOP && appEvents.pop(event); n++) {
+        for (int i = 0; i < taskManager.appSlots(); i++) {
+            Application* app = taskManager.appAt(i);
+            if (!app) continue;
+            AppState state = app->getState();
+            if (state == APP_FOREGROUND || state == APP_BACKGROUND) runOffscreen(app, &event);
         }
     }
-    
-    wasToastActive = isToastActive;
+
+    if (backgroundSlot == 0 && millis() - backgroundRound < BACKGROUND_PERIOD_MS) return;
+    if (backgroundSlot == 0) backgroundRound = millis();
+    uint32_t start = micros();
+    for (; backgroundSlot < taskManager.appSlots(); backgroundSlot++) {
+        if (micros() - start > BACKGROUND_BUDGET_US) return;
+        Application* app = taskManager.appAt(backgroundSlot);
+        if (app && app->getState() == APP_BACKGROUND) runOffscreen(app, nullptr);
+    }
+    backgroundSlot = 0;
+}
+
+void Kernel::onDperfCompleted(din_t din) {
+    if (dperfTarget == 0 || din != dperfTarget) return;
+    dperf_info_result d = node.getFrisbeeResultDPERF();
+    uint64_t span = d.remote_last_timestamp - d.remote_first_timestamp;
+    Serial.printf("DPERF din=%llu received=%u bytes=%llu goodput=%llu B/s time=%lu ms\n", (unsigned long long)din,
+                  (unsigned)d.remote_pkt_counter, (unsigned long long)d.remote_data_counter,
+                  (unsigned long long)(span ? d.remote_data_counter * 1000 / span : 0), millis() - dperfStart);
+    dperfTarget = 0;
+    benchmark.holdDperf(false);
 }
 
-// Funzione di Easing Elastico per l'effetto "Snap" magnetico
-float easeOutElastic(float x) {
-    const float c4 = (2 * PI) / 3;
-    return x == 0 ? 0 : x == 1 ? 1 : pow(2, -10 * x) * sin((x * 10 - 0.75) * c4) + 1;
+void Kernel::loadFonts() {
+    uint32_t len = 0;
+    const uint8_t* blob = assets.glyphs("fonts/ui14", &len);
+    if (uiFont.begin(blob, len)) hardware.fontRegular = &uiFont;
+    blob = assets.glyphs("fonts/ui24", &len);
+    if (uiFontLarge.begin(blob, len)) hardware.fontLarge = &uiFontLarge;
+
+    if (!uiFont.isLoaded() || !uiFontLarge.isLoaded()) sysLog(LOG_FONTS_MISSING);
+    hardware.tft.setFont(hardware.fontRegular);
+
+    if (hardware.loadFullFontPref()) setFullFont(true, false);
+}
+
+void Kernel::setFullFont(bool on, bool persist) {
+    // Only the packed fonts can fall back, the built-in ones are ASCII only
+    if (on && uiFont.isLoaded()) {
+        uiFont.enableFallback(&storage, FONT_FULL_PATH);
+        if (uiFontLarge.isLoaded()) uiFontLarge.enableFallback(&storage, FONT_FULL_LARGE_PATH);
+    } else {
+        uiFont.disableFallback();
+        uiFontLarge.disableFallback();
+    }
+    if (persist) hardware.saveFullFontPref(on);
 }
 
 void Kernel::bootAnimation() {
@@ -128,18 +581,21 @@ void Kernel::bootAnimation() {
     delay(200);
 
     // --- FASE 3: L'ASSEMBLAGGIO (I moduli arrivano) ---
-    // Usiamo l'elastic easing per un effetto di aggancio magnetico soddisfacente
-    int steps = 90;
+    // Usiamo l'elastic easing per un effetto di aggancio magnetico soddisfacente.
+    // Time based: same length whatever the SPI speed, frames paced by the clock
+    const uint32_t duration = 900;
     Rect prev[4];
     for(int i=0; i<4; i++) prev[i] = s[i];
 
-    for (int step = 0; step <= steps; step++) {
-        float t_lin = (float)step / steps;
-        float progress = easeOutElastic(t_lin); // Effetto rimbalzo/magnete
+    uint32_t start = millis();
+    for (bool last = false; !last; ) {
+        uint32_t frame = millis();
+        uint32_t elapsed = frame - start;
+        last = elapsed >= duration;
 
         for (int i = 0; i < 4; i++) {
-            int curX = s[i].x + (t[i].x - s[i].x) * progress;
-            int curY = s[i].y + (t[i].y - s[i].y) * progress;
+            int curX = tweenValue(s[i].x, t[i].x, elapsed, duration, EASE_OUT_ELASTIC);
+            int curY = tweenValue(s[i].y, t[i].y, elapsed, duration, EASE_OUT_ELASTIC);
 
             // Cancella scia (Wipe pulito)
             if (curX != prev[i].x || curY != prev[i].y) {
@@ -154,7 +610,8 @@ void Kernel::bootAnimation() {
             
             prev[i].x = curX; prev[i].y = curY;
         }
-        delay(5);
+        uint32_t spent = millis() - frame;
+        if (!last && spent < BOOT_FRAME_MS) delay(BOOT_FRAME_MS - spent);
     }
 
     // --- FASE 4: ATTIVAZIONE (Il sistema prende vita) ---
@@ -179,11 +636,11 @@ void Kernel::bootAnimation() {
 
     // Titolo principale
     hardware.tft.setTextColor(currentTheme->TEXT_MAIN, bg);
-    hardware.tft.setFont(&fonts::efontCN_24); // Font più grande se possibile
+    hardware.tft.setFont(hardware.fontLarge); // Font più grande se possibile
     hardware.tft.drawString("MODULAR", w/2, textY);
 
     // Sottotitolo (che esprime il concetto)
-    hardware.tft.setFont(&fonts::efontCN_14); // Font più piccolo
+    hardware.tft.setFont(hardware.fontRegular); // Font più piccolo
     hardware.tft.setTextColor(currentTheme->TEXT_MUTED, bg);
     // Dissolvenza simulata per il sottotitolo
     const char* sub = "Powered By DaaS";
@@ -201,13 +658,50 @@ void Kernel::bootAnimation() {
     delay(2000); // Pausa finale per ammirare il risultato
 }
 void Kernel::launchApp(u8_t appID) {
+    HeapScope tag(appID, ""); // onStart and the first draw are charged to the app
     const auto sys_app = taskManager.openRegisteredApplication(appID);
 
-    if (sys_app != nullptr) {
-        sys_app->inject(&hardware, this, currentTheme);
+    if (sys_app == nullptr) return;
+    trace.record(TRACE_LAUNCH, appID, appID);
+
+    // The app in front (or about to be) goes to the background
+    Application* leaving = pendingApp ? pendingApp : currentApp;
+    if (leaving && leaving != sys_app) leaving->setState(leaving->runsInBackground() ? APP_BACKGROUND : APP_SUSPENDED);
+    sys_app->setState(APP_FOREGROUND);
+    sys_app->inject(&hardware, this, currentTheme);
+
+    if (currentApp == nullptr || pendingApp != nullptr) {
+        // First app (or a launch mid-transition): no page to wipe
+        animations.cancel(pageTransition);
+        pendingApp = nullptr;
         hardware.resetScreen(currentTheme->BG_COLOR);
         sys_app->onDraw();
-
         currentApp = sys_app;
+        HeapAccounting::get().foreground(appID, sys_app->getName());
+        return;
+    }
+
+    // Page transition: a background wipe, each frame fills only the rows it
+    // advanced. The old app stops drawing now, the new one starts at the end.
+    pendingApp = sys_app;
+    currentApp = nullptr;
+    pageTransition = animations.start(0, hardware.tft.height(), PAGE_TRANSITION_MS, EASE_IN_OUT_CUBIC,
+        [this](int32_t value, int32_t prev, bool last) {
+            hardware.tft.fillRect(0, prev, hardware.tft.width(), value - prev, currentTheme->BG_COLOR);
+            if (!last) return;
+            ToastManager::getInstance()->invalidate(); // Wiped: comes back over the new page
+            hardware.resetTextState();
+            HeapScope tag(pendingApp->getAppID(), pendingApp->getName());
+            pendingApp->onDraw();
+            currentApp = pendingApp;
+            HeapAccounting::get().foreground(currentApp->getAppID(), currentApp->getName());
+            pendingApp = nullptr;
+        });
+    if (pageTransition < 0) {
+        hardware.resetScreen(currentTheme->BG_COLOR);
+        pendingApp->onDraw();
+        currentApp = pendingApp;
+        HeapAccounting::get().foreground(appID, currentApp->getName());
+        pendingApp = nullptr;
     }
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+# PlatformIO pre-build step (extra_scripts = pre:tools/build_assets.py).
+#
+# Regenerates the subsetted UI fonts from fonts/ui.ttf and the keyboard
+# lexicon from lexicon/words.txt, then packs assets/ into
+# $BUILD_DIR/assets.bin. Upload it with:
+#
+#     pio run -t uploadassets
+#
+# fonts/ui.ttf is not in the repository: put the TTF the UI should use
+# there (same 14/24 px metrics as efont). When the subset is built the
+# firmware is compiled with -DUI_PACKED_FONTS and no longer links the
+# efontCN_14/efontCN_24 faces of LovyanGFX. Skipped with a warning when
+# Pillow or the source font is missing: efont then stays the UI font.
+#
+# lexicon/words.txt is not in the repository either (a frequency list
+# such as a trimmed wordfreq or SUBTLEX export, one word per line, most
+# frequent first). Without it no lexicon is packed and the keyboard only
+# suggests the words learned from sent messages.
+
+import os
+import subprocess
+import sys
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+PROJECT = env.subst("$PROJECT_DIR")  # noqa: F821
+BUILD = env.subst("$BUILD_DIR")      # noqa: F821
+TTF = os.path.join(PROJECT, "fonts", "ui.ttf")
+WORDS = os.path.join(PROJECT, "lexicon", "words.txt")
+ASSETS = os.path.join(PROJECT, "assets")
+PACK = os.path.join(BUILD, "assets.bin")
+ASSETS_OFFSET = "0x3A0000"           # "assets" partition in huge_app.csv
+
+
+def tool(name, *args):
+    return subprocess.call([sys.executable, os.path.join(PROJECT, "tools", name)] + list(args), cwd=PROJECT) == 0
+
+
+try:
+    import PIL  # noqa: F401
+    have_pillow = True
+except ImportError:
+    have_pillow = False
+
+if not os.path.isfile(TTF):
+    print("build_assets: %s missing, UI fonts not regenerated" % TTF)
+elif not have_pillow:
+    print("build_assets: Pillow missing (pip install pillow), UI fonts not regenerated")
+elif tool("subset_fonts.py", "--ttf", TTF, "--root", PROJECT, "--out-dir", os.path.join(ASSETS, "fonts")):
+    env.Append(CPPDEFINES=["UI_PACKED_FONTS"])  # noqa: F821 (see HardwareManager::fontRegular)
+
+if not os.path.isfile(WORDS):
+    print("build_assets: %s missing, keyboard suggests learned words only" % WORDS)
+else:
+    tool("build_lexicon.py", WORDS, "--out", os.path.join(ASSETS, "lexicon", "en.mlex"))
+
+if os.path.isdir(ASSETS):
+    os.makedirs(BUILD, exist_ok=True)
+    if tool("pack_assets.py", ASSETS, PACK):
+        env.AddCustomTarget(  # noqa: F821
+            "uploadassets", PACK,
+            '"$PYTHONEXE" "$UPLOADER" --chip esp32 --port "$UPLOAD_PORT" write_flash %s "%s"' % (ASSETS_OFFSET, PACK),
+            title="Upload assets", description="Flash the asset pack to the assets partition")
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""Builds the word prediction lexicon read by include/os/modules/word_predictor.hpp.
+
+    python3 tools/build_lexicon.py words.txt
+        -> assets/lexicon/en.mlex (packed by pack_assets.py as "lexicon/en")
+
+The word list has one word per line, optionally followed by a count
+("hello 51234"). Without counts the line order is the rank, most frequent
+first. Words are lowercased; anything outside a-z and the apostrophe is
+dropped. The list is not shipped in the repository: see
+tools/build_assets.py.
+
+Each word gets a frequency class 1..15 and the trie is minimized into a
+DAWG: identical subtrees (same letters, same classes) are stored once.
+
+    header   <IBBHII  magic "MLEX", version, max length, reserved, edge count, root
+    edges    uint32   bits 0-7 char, 8 last sibling, 9 ends a word,
+                      10-31 first edge of the child node (0 = leaf)
+    info     uint8    high nibble: class of the word ending here,
+                      low nibble: best class in the subtree
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import sys
+
+MAGIC = 0x58454C4D  # "MLEX"
+VERSION = 1
+WORD_MAX = 24       # WORD_MAX in word_predictor.hpp, terminator included
+MAX_EDGES = 1 << 22
+
+HEADER = struct.Struct("<IBBHII")
+WORD_RE = re.compile(r"^[a-z']+$")
+
+
+def read_words(path, limit):
+    counts = {}
+    ranked = []
+    with open(path, encoding="utf-8", errors="ignore") as fh:
+        for line in fh:
+            parts = line.split()
+            if not parts:
+                continue
+            word = parts[0].lower()
+            if not WORD_RE.match(word) or len(word) >= WORD_MAX or word in counts:
+                continue
+            count = None
+            if len(parts) > 1:
+                try:
+                    count = float(parts[1])
+                except ValueError:
+                    pass
+            counts[word] = count
+            ranked.append(word)
+            if limit and len(ranked) >= limit:
+                break
+    return ranked, counts
+
+
+def classes(ranked, counts):
+    """Frequency class 1..15: log of the count, or of the rank without counts."""
+    out = {}
+    if ranked and all(counts[w] is not None for w in ranked):
+        top = math.log(max(max(counts[w] for w in ranked), 1) + 1)
+        for w in ranked:
+            out[w] = max(1, min(15, 1 + int(14 * math.log(max(counts[w], 0) + 1) / top)))
+    else:
+        total = math.log(len(ranked) + 1)
+        for rank, w in enumerate(ranked):
+            out[w] = max(1, min(15, 15 - int(14 * math.log(rank + 1) / total)))
+    return out
+
+
+class Node:
+    __slots__ = ("edges",)
+
+    def __init__(self):
+        self.edges = {}   # char -> [child Node, class of the word ending there or 0]
+
+
+def build_trie(word_class):
+    root = Node()
+    for word, cls in word_class.items():
+        node = root
+        for i, ch in enumerate(word):
+            edge = node.edges.setdefault(ch, [Node(), 0])
+            if i == len(word) - 1:
+                edge[1] = cls
+            node = edge[0]
+    return root
+
+
+def minimize(root):
+    """Merges equal subtrees bottom-up; returns the unique nodes, children first."""
+    registry = {}
+    order = []
+    best = {}
+
+    def visit(node):
+        sig = []
+        for ch in sorted(node.edges):
+            edge = node.edges[ch]
+            edge[0] = visit(edge[0])
+            sig.append((ch, edge[1], id(edge[0])))
+        sig = tuple(sig)
+        found = registry.get(sig)
+        if found is not None:
+            return found
+        registry[sig] = node
+        best[id(node)] = max([max(cls, best[id(child)]) for child, cls in node.edges.values()] or [0])
+        order.append(node)
+        return node
+
+    visit(root)
+    return order, best
+
+
+def serialize(root, order, best):
+    # Edge 0 is the sentinel; every node is a contiguous run of edges
+    first = {}
+    count = 1
+    for node in order:
+        if node.edges:
+            first[id(node)] = count
+            count += len(node.edges)
+    if count > MAX_EDGES:
+        sys.exit("build_lexicon: %d edges, the format holds %d" % (count, MAX_EDGES))
+
+    edges = [0] * count
+    info = [0] * count
+    for node in order:
+        if not node.edges:
+            continue
+        at = first[id(node)]
+        keys = sorted(node.edges)
+        for i, ch in enumerate(keys):
+            child, cls = node.edges[ch]
+            value = ord(ch) | (first.get(id(child), 0) << 10)
+            if i == len(keys) - 1:
+                value |= 0x100
+            if cls:
+                value |= 0x200
+            edges[at + i] = value
+            info[at + i] = (cls << 4) | max(cls, best[id(child)])
+    return edges, info, first.get(id(root), 0)
+
+
+def lookup(blob, word):
+    """Class of word in a built lexicon, 0 if absent (self-check)."""
+    _, _, _, _, count, node = HEADER.unpack_from(blob)
+    edges = struct.unpack_from("<%dI" % count, blob, HEADER.size)
+    info = blob[HEADER.size + count * 4:]
+    cls = 0
+    for ch in word:
+        e = node
+        while e:
+            if edges[e] & 0xFF == ord(ch):
+                break
+            e = 0 if edges[e] & 0x100 else e + 1
+        if not e:
+            return 0
+        cls = info[e] >> 4 if edges[e] & 0x200 else 0
+        node = edges[e] >> 10
+    return cls
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("words", help="word list, \"word [count]\" per line")
+    parser.add_argument("--out", default=os.path.join("assets", "lexicon", "en.mlex"))
+    parser.add_argument("--limit", type=int, default=20000, help="keep the first N words (0: all)")
+    args = parser.parse_args()
+
+    ranked, counts = read_words(args.words, args.limit)
+    if not ranked:
+        sys.exit("build_lexicon: no usable words in %s" % args.words)
+    word_class = classes(ranked, counts)
+
+    root = build_trie(word_class)
+    order, best = minimize(root)
+    edges, info, root_edge = serialize(root, order, best)
+
+    max_len = max(len(w) for w in ranked)
+    blob = HEADER.pack(MAGIC, VERSION, max_len, 0, len(edges), root_edge)
+    blob += struct.pack("<%dI" % len(edges), *edges) + bytes(info)
+
+    for w in ranked[:200]:
+        if lookup(blob, w) != word_class[w]:
+            sys.exit("build_lexicon: self-check failed on '%s'" % w)
+
+    os.makedirs(os.path.dirname(args.out) or ".", exist_ok=True)
+    with open(args.out, "wb") as fh:
+        fh.write(blob)
+    print("build_lexicon: %s, %d words, %d edges, %d bytes" % (args.out, len(ranked), len(edges), len(blob)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Expands the binary system log written by include/os/modules/log.hpp.
+
+    python3 tools/decode_log.py system.mlog
+    python3 tools/decode_log.py system.mlog --level warn
+
+The file (copied from the SD card, or the flash tier) starts with the text
+line "MLOG1" followed by fixed 32-byte records. Past 512 KB the firmware
+moves it to system.mlog.1 and starts a new one: decode that first for
+the older part. Without a card the log is kept in flash, capped at
+64 KB; when the card returns it is appended with its own "MLOG1" line.
+
+    <IHBB24s   ms since boot, format id, level, payload length, payload
+
+Numbers are packed as uint32 LE, strings as a length byte and the chars.
+The format strings come from include/os/modules/log_formats.hpp: ids are
+positions in LOG_CATALOG. Every boot starts with a LOG_BOOT record holding
+the catalog hash; records of a boot whose hash does not match the catalog
+read here are printed raw instead of expanded.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = b"MLOG1\n"
+RECORD = struct.Struct("<IHBB24s")
+LEVELS = ["debug", "info", "warn", "error"]
+CATALOG = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "os", "modules", "log_formats.hpp")
+
+ENTRY_RE = re.compile(r'X\(\s*(\w+)\s*,\s*LOG_LEVEL_(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+SPEC_RE = re.compile(r"%([-+ #0-9.]*)[hlzjt]*([a-zA-Z%])")
+
+
+def load_catalog(path):
+    with open(path) as fh:
+        text = fh.read()
+    entries = []
+    for name, level, fmt in ENTRY_RE.findall(text):
+        fmt = bytes(fmt, "utf-8").decode("unicode_escape")
+        entries.append((name, level.lower(), fmt))
+    if not entries or entries[0][0] != "LOG_BOOT":
+        sys.exit("decode_log: %s does not look like the log catalog" % path)
+    return entries
+
+
+def catalog_hash(entries):
+    """LOG_CATALOG_HASH in log.hpp: xor of FNV-1a(format) seeded by basis + id."""
+    total = 0
+    for i, (_, _, fmt) in enumerate(entries):
+        h = (2166136261 + i) & 0xFFFFFFFF
+        for b in fmt.encode():
+            h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+        total ^= h
+    return total
+
+
+def expand(fmt, payload):
+    """Same rules as Logger::format on the device."""
+    pos = [0]
+
+    def take_u32():
+        if pos[0] + 4 > len(payload):
+            pos[0] = len(payload)
+            return 0
+        (v,) = struct.unpack_from("<I", payload, pos[0])
+        pos[0] += 4
+        return v
+
+    def take_str():
+        if pos[0] >= len(payload):
+            return ""
+        n = payload[pos[0]]
+        s = payload[pos[0] + 1:pos[0] + 1 + n]
+        pos[0] += 1 + n
+        return s.decode(errors="replace")
+
+    def conv(m):
+        flags, c = m.group(1), m.group(2)
+        if c == "%":
+            return "%"
+        if c == "s":
+            return ("%" + flags + "s") % take_str()
+        v = take_u32()
+        if c in "di":
+            v = v - (1 << 32) if v & 0x80000000 else v
+            c = "d"
+        elif c == "u":
+            c = "d"
+        elif c == "c":
+            return ("%" + flags + "c") % chr(v & 0xFF)
+        return ("%" + flags + c) % v
+
+    return SPEC_RE.sub(conv, fmt)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", help="binary log (system.mlog)")
+    parser.add_argument("--catalog", default=CATALOG, help="log_formats.hpp of the firmware that wrote the log")
+    parser.add_argument("--level", choices=LEVELS, default="debug", help="lowest level shown")
+    args = parser.parse_args()
+
+    entries = load_catalog(args.catalog)
+    expected = catalog_hash(entries)
+    floor = LEVELS.index(args.level)
+
+    with open(args.log, "rb") as fh:
+        blob = fh.read()
+    if not blob.startswith(MAGIC):
+        sys.exit("decode_log: %s is not a binary log" % args.log)
+
+    body = blob[len(MAGIC):]
+    matches = True
+    off = 0
+    while off + RECORD.size <= len(body):
+        # Part written to flash without the card: appended with its own header
+        if body.startswith(MAGIC, off):
+            off += len(MAGIC)
+            continue
+        ms, fid, level, length, payload = RECORD.unpack_from(body, off)
+        off += RECORD.size
+        payload = payload[:length]
+        if fid == 0:
+            (found,) = struct.unpack_from("<I", payload.ljust(4, b"\0"))
+            matches = found == expected
+            if not matches:
+                print("---- boot with catalog %08x, this catalog is %08x: raw records follow" % (found, expected))
+        if level < floor:
+            continue
+        stamp = "[%6d.%03d] %s" % (ms // 1000, ms % 1000, "DIWE"[level & 3])
+        if matches and fid < len(entries):
+            print("%s %s" % (stamp, expand(entries[fid][2], payload)))
+        else:
+            print("%s #%d %s" % (stamp, fid, payload.hex()))
+    if off != len(body):
+        print("decode_log: %d trailing bytes ignored" % (len(body) - off), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
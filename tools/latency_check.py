@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Scripted touch-latency check against a board on a serial port.
+
+Replays a tap script through the firmware's Serial console, then reads the
+per-app touch-to-photon histograms and fails (exit 1) when an app is over
+budget. Meant for a CI runner with the board attached:
+
+    python3 tools/latency_check.py --port /dev/ttyUSB0 --script taps.txt --p95 60 --budget Settings=250
+
+Script lines:
+    tap <x> <y> [hold ms]    press at (x, y), default hold 80 ms
+    wait <ms>                pause (let the UI settle, e.g. after a page change)
+    # ...                    comment
+
+Each tap is followed by a pause of at least its hold time plus --gap ms,
+so every tap is a fresh press edge. Needs pyserial.
+"""
+
+import argparse
+import re
+import sys
+import time
+
+LINE_RE = re.compile(r"LAT app=(\d+) name=(\S*) n=(\d+) p50=(\d+) p95=(\d+) p99=(\d+) max=(\d+)")
+DROPPED_RE = re.compile(r"LAT dropped=(\d+)")
+
+
+def send(port, line):
+    port.write((line + "\n").encode())
+    port.flush()
+
+
+def run_script(port, path, gap):
+    with open(path) as fh:
+        for n, raw in enumerate(fh, 1):
+            line = raw.split("#", 1)[0].strip()
+            if not line:
+                continue
+            parts = line.split()
+            if parts[0] == "tap" and len(parts) in (3, 4):
+                hold = int(parts[3]) if len(parts) == 4 else 80
+                send(port, "tap %d %d %d" % (int(parts[1]), int(parts[2]), hold))
+                time.sleep((hold + gap) / 1000.0)
+            elif parts[0] == "wait" and len(parts) == 2:
+                time.sleep(int(parts[1]) / 1000.0)
+            else:
+                sys.exit("latency_check: %s:%d: cannot parse '%s'" % (path, n, line))
+
+
+def read_report(port, timeout=3.0):
+    send(port, "latency")
+    apps, dropped = [], None
+    end = time.time() + timeout
+    while time.time() < end and dropped is None:
+        line = port.readline().decode(errors="ignore").strip()
+        m = LINE_RE.search(line)
+        if m:
+            app_id, name, n, p50, p95, p99, peak = m.groups()
+            apps.append({"id": int(app_id), "name": name, "n": int(n), "p50": int(p50),
+                         "p95": int(p95), "p99": int(p99), "max": int(peak)})
+            continue
+        m = DROPPED_RE.search(line)
+        if m:
+            dropped = int(m.group(1))
+    if dropped is None:
+        sys.exit("latency_check: no report from the board")
+    return apps, dropped
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--script", required=True, help="tap script")
+    parser.add_argument("--gap", type=int, default=250, help="ms between taps (default 250)")
+    parser.add_argument("--p95", type=int, default=100, help="default p95 budget in ms (default 100)")
+    parser.add_argument("--p99", type=int, help="optional p99 budget in ms for every app")
+    parser.add_argument("--budget", action="append", default=[], metavar="APP=MS",
+                        help="p95 budget for one app, by name (repeatable)")
+    parser.add_argument("--max-dropped", type=int, default=0, help="taps allowed to draw nothing")
+    args = parser.parse_args()
+
+    try:
+        import serial
+    except ImportError:
+        sys.exit("latency_check: pyserial is required (pip install pyserial)")
+
+    budgets = {}
+    for b in args.budget:
+        name, _, ms = b.partition("=")
+        budgets[name] = int(ms)
+
+    with serial.Serial(args.port, args.baud, timeout=0.5) as port:
+        time.sleep(0.2)
+        port.reset_input_buffer()
+        send(port, "latency reset")
+        time.sleep(0.2)
+        run_script(port, args.script, args.gap)
+        time.sleep(0.5)
+        port.reset_input_buffer()
+        apps, dropped = read_report(port)
+
+    failed = False
+    for a in apps:
+        budget = budgets.get(a["name"], args.p95)
+        over = a["p95"] > budget or (args.p99 is not None and a["p99"] > args.p99)
+        failed |= over
+        print("%-10s n=%-4d p50=%-4d p95=%-4d p99=%-4d max=%-4d budget p95<=%d  %s" %
+              (a["name"], a["n"], a["p50"], a["p95"], a["p99"], a["max"], budget, "FAIL" if over else "ok"))
+    if dropped > args.max_dropped:
+        print("%d taps drew nothing (allowed %d)  FAIL" % (dropped, args.max_dropped))
+        failed = True
+    if not apps:
+        print("no tap was measured  FAIL")
+        failed = True
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
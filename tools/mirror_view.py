@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Viewer for the screen mirror of include/os/modules/mirror.hpp.
+
+    python3 tools/mirror_view.py --port /dev/ttyUSB0 --start
+    python3 tools/mirror_view.py --input dump.bin --save frames/
+
+With --port the packets are read from the board's Serial console; --start
+sends "mirror serial" first and every mode asks for a keyframe
+("mirror key") so the picture is complete right away. Console and log
+lines interleaved with the packets are passed through to stderr.
+
+With --input the packets are read from a file or "-" (stdin): the payloads
+of the DDOs received on typeset 0x4D52 by a DaaS node on the host,
+concatenated, are exactly this stream.
+
+The window needs tkinter; without a display use --save DIR, which writes
+one PPM per completed frame. Needs pyserial for --port.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+SYNC = b"\xA5\x5A"
+MIR_FRAME, MIR_FILLS, MIR_PIXELS, MIR_END = 1, 2, 3, 4
+PAYLOAD_MAX = 232
+
+
+def rgb(c):
+    r, g, b = (c >> 11) & 0x1F, (c >> 5) & 0x3F, c & 0x1F
+    return bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+
+
+class Screen:
+    """Applies mirror packets to an RGB888 framebuffer."""
+
+    def __init__(self, w=240, h=320):
+        self.resize(w, h)
+        self.frames = 0
+        self.bytes = 0
+        self.seq = None
+
+    def resize(self, w, h):
+        self.w, self.h = w, h
+        self.fb = bytearray(w * h * 3)
+
+    def put(self, x, y, color):
+        if 0 <= x < self.w and 0 <= y < self.h:
+            o = (y * self.w + x) * 3
+            self.fb[o:o + 3] = color
+
+    def fill(self, x, y, w, h, c):
+        px = rgb(c)
+        x1, y1 = min(x + w, self.w), min(y + h, self.h)
+        if x >= x1:
+            return
+        row = px * (x1 - x)
+        for yy in range(max(y, 0), y1):
+            o = (yy * self.w + x) * 3
+            self.fb[o:o + len(row)] = row
+
+    def pixels(self, payload):
+        x, y, w, h, index = struct.unpack_from("<HHHHI", payload)
+        p = 12
+        while p < len(payload):
+            head = payload[p]
+            p += 1
+            if head >= 128:
+                (c,) = struct.unpack_from("<H", payload, p)
+                p += 2
+                color = rgb(c)
+                for _ in range(head - 127):
+                    self.put(x + index % w, y + index // w, color)
+                    index += 1
+            else:
+                for _ in range(head + 1):
+                    (c,) = struct.unpack_from("<H", payload, p)
+                    p += 2
+                    self.put(x + index % w, y + index // w, rgb(c))
+                    index += 1
+
+    def apply(self, kind, payload):
+        """True when a frame completed."""
+        if kind == MIR_FRAME:
+            seq, w, h = struct.unpack_from("<HHH", payload)
+            if (w, h) != (self.w, self.h):
+                self.resize(w, h)
+            self.seq = seq
+        elif kind == MIR_FILLS:
+            for off in range(0, len(payload) - 9, 10):
+                self.fill(*struct.unpack_from("<HHHHH", payload, off))
+        elif kind == MIR_PIXELS:
+            self.pixels(payload)
+        elif kind == MIR_END:
+            seq, size = struct.unpack_from("<HI", payload)
+            self.frames += 1
+            self.bytes += size
+            return True
+        return False
+
+    def ppm(self):
+        return b"P6 %d %d 255\n" % (self.w, self.h) + bytes(self.fb)
+
+
+class Parser:
+    """Splits a byte stream into packets; anything else is console text."""
+
+    def __init__(self, text_out):
+        self.buf = bytearray()
+        self.text = bytearray()
+        self.text_out = text_out
+        self.bad = 0
+
+    def _text(self, data):
+        self.text += data
+        while b"\n" in self.text:
+            line, _, rest = bytes(self.text).partition(b"\n")
+            self.text = bytearray(rest)
+            if self.text_out:
+                self.text_out.write(line.decode(errors="replace") + "\n")
+
+    def feed(self, data):
+        self.buf += data
+        packets = []
+        while True:
+            at = self.buf.find(SYNC)
+            if at < 0:
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self._text(self.buf[:len(self.buf) - keep])
+                del self.buf[:len(self.buf) - keep]
+                return packets
+            if at:
+                self._text(self.buf[:at])
+                del self.buf[:at]
+            if len(self.buf) < 5:
+                return packets
+            kind = self.buf[2]
+            (length,) = struct.unpack_from("<H", self.buf, 3)
+            if length > PAYLOAD_MAX or kind not in (MIR_FRAME, MIR_FILLS, MIR_PIXELS, MIR_END):
+                self._text(self.buf[:1])
+                del self.buf[:1]
+                continue
+            if len(self.buf) < 6 + length:
+                return packets
+            sum_ = 0
+            for b in self.buf[2:5 + length]:
+                sum_ ^= b
+            if sum_ != self.buf[5 + length]:
+                self.bad += 1
+                self._text(self.buf[:1])
+                del self.buf[:1]
+                continue
+            packets.append((kind, bytes(self.buf[5:5 + length])))
+            del self.buf[:6 + length]
+
+
+class Window:
+    def __init__(self, screen, scale):
+        import tkinter
+        self.tk = tkinter.Tk()
+        self.tk.title("Modular mirror")
+        self.scale = scale
+        self.label = tkinter.Label(self.tk)
+        self.label.pack()
+        self.status = tkinter.Label(self.tk, anchor="w")
+        self.status.pack(fill="x")
+        self.photo = None
+        self.alive = True
+        self.tk.protocol("WM_DELETE_WINDOW", self.close)
+
+    def close(self):
+        self.alive = False
+
+    def show(self, screen, rate):
+        import tkinter
+        self.photo = tkinter.PhotoImage(data=screen.ppm(), format="PPM")
+        if self.scale > 1:
+            self.photo = self.photo.zoom(self.scale)
+        self.label.configure(image=self.photo)
+        self.status.configure(text="frame %d  %.1f KB/s" % (screen.frames, rate / 1024.0))
+
+    def poll(self):
+        self.tk.update()
+        return self.alive
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    src = parser.add_mutually_exclusive_group(required=True)
+    src.add_argument("--port", help="serial port of the board")
+    src.add_argument("--input", help="packet stream file, - for stdin")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--start", action="store_true", help="send 'mirror serial' on connect")
+    parser.add_argument("--fps", type=int, default=0, help="with --start: frame rate cap")
+    parser.add_argument("--rate", type=int, default=0, help="with --start: byte rate cap (B/s)")
+    parser.add_argument("--save", metavar="DIR", help="write every completed frame as PPM")
+    parser.add_argument("--scale", type=int, default=2, help="window zoom (default 2)")
+    parser.add_argument("--headless", action="store_true", help="no window (with --save)")
+    args = parser.parse_args()
+
+    screen = Screen()
+    packets = Parser(sys.stderr)
+    window = None if args.headless else Window(screen, args.scale)
+    if args.save:
+        os.makedirs(args.save, exist_ok=True)
+
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("mirror_view: pyserial is required (pip install pyserial)")
+        port = serial.Serial(args.port, args.baud, timeout=0.05)
+        if args.start:
+            port.write(b"mirror serial %d %d\n" % (args.fps, args.rate))
+        port.write(b"mirror key\n")
+        read = lambda: port.read(4096)
+    else:
+        stream = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+        read = lambda: stream.read(4096)
+
+    start = time.time()
+    try:
+        while True:
+            data = read()
+            if not data and args.input:
+                break
+            for kind, payload in packets.feed(data):
+                if not screen.apply(kind, payload):
+                    continue
+                if args.save:
+                    with open(os.path.join(args.save, "frame%05d.ppm" % screen.frames), "wb") as fh:
+                        fh.write(screen.ppm())
+                if window:
+                    window.show(screen, screen.bytes / max(time.time() - start, 0.001))
+            if window and not window.poll():
+                break
+    except KeyboardInterrupt:
+        pass
+
+    print("mirror_view: %d frames, %d bytes, %d bad packets" % (screen.frames, screen.bytes, packets.bad),
+          file=sys.stderr)
+    if args.input and window:
+        while window.poll():
+            time.sleep(0.05)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""Builds the read-only asset pack mapped by include/os/modules/asset_pack.hpp.
+
+Every file under the input directory becomes one asset named after its
+path relative to that directory, without the extension:
+
+    assets/icons/chat.png     -> "icons/chat"    ASSET_IMAGE (RGB565, needs Pillow)
+    assets/fonts/ui14.vlw     -> "fonts/ui14"    ASSET_FONT
+    assets/fonts/ui14.mfnt    -> "fonts/ui14"    ASSET_GLYPHS (from subset_fonts.py)
+    assets/lexicon/en.mlex    -> "lexicon/en"    ASSET_LEXICON (from build_lexicon.py)
+    assets/layouts/home.json  -> "layouts/home"  ASSET_LAYOUT
+    anything else             -> full path       ASSET_RAW
+
+Usage:
+    python3 tools/pack_assets.py assets/ assets.bin
+    esptool.py --chip esp32 write_flash 0x3A0000 assets.bin
+
+The offset and the size limit match the "assets" partition in huge_app.csv.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4B504D41  # "AMPK"
+VERSION = 1
+PARTITION_SIZE = 0x60000
+
+ASSET_RAW, ASSET_IMAGE, ASSET_FONT, ASSET_LAYOUT, ASSET_GLYPHS, ASSET_LEXICON = 0, 1, 2, 3, 4, 5
+
+HEADER = struct.Struct("<IHHII")     # magic, version, count, totalSize, crc
+ENTRY = struct.Struct("<IIIIHH")     # hash, nameOffset, offset, size, type, flags
+IMAGE = struct.Struct("<HHI")        # width, height, reserved
+
+
+def fnv1a(name):
+    h = 2166136261
+    for b in name.encode("utf-8"):
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def align4(n):
+    return (n + 3) & ~3
+
+
+def encode_image(path):
+    try:
+        from PIL import Image
+    except ImportError:
+        sys.exit("pack_assets: Pillow is required for images (pip install pillow)")
+
+    img = Image.open(path).convert("RGB")
+    w, h = img.size
+    out = bytearray(IMAGE.pack(w, h, 0))
+    for r, g, b in img.getdata():
+        # Big endian RGB565: the panel byte order, drawn as lgfx::swap565_t
+        out += struct.pack(">H", ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+    return bytes(out)
+
+
+def classify(rel):
+    stem, ext = os.path.splitext(rel)
+    ext = ext.lower()
+    if ext in (".png", ".bmp", ".jpg", ".jpeg"):
+        return stem, ASSET_IMAGE
+    if ext == ".vlw":
+        return stem, ASSET_FONT
+    if ext == ".json":
+        return stem, ASSET_LAYOUT
+    if ext == ".mfnt":
+        return stem, ASSET_GLYPHS
+    if ext == ".mlex":
+        return stem, ASSET_LEXICON
+    return rel, ASSET_RAW
+
+
+def collect(root):
+    assets = {}
+    for dirpath, _, files in os.walk(root):
+        for f in sorted(files):
+            if f.startswith("."):
+                continue
+            path = os.path.join(dirpath, f)
+            rel = os.path.relpath(path, root).replace(os.sep, "/")
+            name, kind = classify(rel)
+            if name in assets:
+                sys.exit("pack_assets: duplicate asset name '%s'" % name)
+            if kind == ASSET_IMAGE:
+                data = encode_image(path)
+            else:
+                with open(path, "rb") as fh:
+                    data = fh.read()
+            assets[name] = (kind, data)
+    return assets
+
+
+def pack(assets):
+    # Sorted by hash for the binary search, ties by name
+    items = sorted(assets.items(), key=lambda kv: (fnv1a(kv[0]), kv[0]))
+    count = len(items)
+
+    names = bytearray()
+    name_offsets = []
+    names_start = HEADER.size + count * ENTRY.size
+    for name, _ in items:
+        name_offsets.append(names_start + len(names))
+        names += name.encode("utf-8") + b"\0"
+
+    blobs = bytearray()
+    blob_start = align4(names_start + len(names))
+    entries = bytearray()
+    for (name, (kind, data)), name_off in zip(items, name_offsets):
+        offset = blob_start + len(blobs)
+        entries += ENTRY.pack(fnv1a(name), name_off, offset, len(data), kind, 0)
+        blobs += data
+        blobs += b"\0" * (align4(len(blobs)) - len(blobs))
+
+    body = bytearray(entries)
+    body += names
+    body += b"\0" * (blob_start - names_start - len(names))
+    body += blobs
+
+    total = HEADER.size + len(body)
+    crc = zlib.crc32(bytes(body)) & 0xFFFFFFFF
+    return HEADER.pack(MAGIC, VERSION, count, total, crc) + bytes(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="asset directory")
+    parser.add_argument("output", help="pack file to write")
+    parser.add_argument("--max-size", type=lambda v: int(v, 0), default=PARTITION_SIZE,
+                        help="partition size (default 0x%X)" % PARTITION_SIZE)
+    args = parser.parse_args()
+
+    assets = collect(args.input)
+    if len(assets) > 0xFFFF:
+        sys.exit("pack_assets: too many assets")
+
+    blob = pack(assets)
+    if len(blob) > args.max_size:
+        sys.exit("pack_assets: pack is %d bytes, partition holds %d" % (len(blob), args.max_size))
+
+    with open(args.output, "wb") as fh:
+        fh.write(blob)
+
+    print("pack_assets: %d assets, %d bytes (%.0f%% of the partition)"
+          % (len(assets), len(blob), 100.0 * len(blob) / args.max_size))
+    for name, (kind, data) in sorted(assets.items()):
+        print("  %-32s %-6s %7d" % (name, ("raw", "image", "font", "layout", "glyphs", "lexicon")[kind], len(data)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+"""Builds the anti-aliased UI fonts read by include/os/modules/packed_font.hpp.
+
+The subset holds every character used by a string literal under include/
+and src/, plus a configurable charset (printable ASCII by default), so the
+UI never needs the full CJK fonts linked into the app image:
+
+    python3 tools/subset_fonts.py --ttf fonts/ui.ttf
+        -> assets/fonts/ui14.mfnt, assets/fonts/ui24.mfnt (packed by pack_assets.py)
+
+With --full every character of the TTF is emitted instead. Copy those to
+/fonts/ on the SD card for the opt-in fallback ("font full on" on Serial):
+
+    python3 tools/subset_fonts.py --ttf fonts/ui.ttf --full --out-dir sd/fonts
+        -> full14.mfnt, full24.mfnt
+
+Glyphs are 4-bit alpha, RLE coded:
+    0x00-0x3F  n+1 transparent pixels
+    0x40-0x7F  n+1 opaque pixels
+    0x80-0xFF  n+1 literal alphas follow, two per byte, high nibble first
+
+Needs Pillow; --full also needs fontTools to list the TTF characters.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+MAGIC = 0x544E464D  # "MFNT"
+VERSION = 1
+PAGES = 256
+MAX_PIXELS = 1600   # PACKED_FONT_MAX_PIXELS
+MAX_RLE = 512       # FONT_FALLBACK_GLYPH_READ minus the glyph header
+
+HEADER = struct.Struct("<IBBBBHHI")  # magic, version, bpp, height, ascent, glyphCount, reserved, totalSize
+GLYPH = struct.Struct("<BBbbBBH")    # width, height, xOffset, yOffset, advance, reserved, size
+
+SOURCE_DIRS = ("include", "src")
+SOURCE_EXTS = (".h", ".hpp", ".c", ".cpp")
+STRING_RE = re.compile(r'"((?:[^"\\\n]|\\.)*)"')
+
+
+def source_chars(root):
+    chars = set()
+    for d in SOURCE_DIRS:
+        for dirpath, _, files in os.walk(os.path.join(root, d)):
+            for f in files:
+                if not f.endswith(SOURCE_EXTS):
+                    continue
+                with open(os.path.join(dirpath, f), encoding="utf-8", errors="ignore") as fh:
+                    for lit in STRING_RE.findall(fh.read()):
+                        # Escapes are control characters or ASCII, covered by the charset
+                        chars.update(re.sub(r"\\.", "", lit))
+    return chars
+
+
+def ttf_chars(path):
+    try:
+        from fontTools.ttLib import TTFont
+    except ImportError:
+        sys.exit("subset_fonts: --full needs fontTools (pip install fonttools)")
+    return {chr(c) for c in TTFont(path).getBestCmap() if c <= 0xFFFF}
+
+
+def quantize(v):
+    return (v * 15 + 127) // 255
+
+
+def rle(alphas):
+    out = bytearray()
+    i, n = 0, len(alphas)
+    while i < n:
+        a = alphas[i]
+        if a in (0, 15):
+            run = 1
+            while i + run < n and alphas[i + run] == a and run < 64:
+                run += 1
+            out.append((0x00 if a == 0 else 0x40) | (run - 1))
+            i += run
+            continue
+
+        # Literal until a run of three transparent/opaque pixels starts
+        j = i
+        while j < n and j - i < 128:
+            if alphas[j] in (0, 15) and alphas[j:j + 3] == [alphas[j]] * 3:
+                break
+            j += 1
+        lit = alphas[i:j]
+        out.append(0x80 | (len(lit) - 1))
+        for k in range(0, len(lit), 2):
+            lo = lit[k + 1] if k + 1 < len(lit) else 0
+            out.append((lit[k] << 4) | lo)
+        i = j
+    return bytes(out)
+
+
+def render(font, ch, ascent):
+    from PIL import Image, ImageDraw
+
+    advance = int(round(font.getlength(ch)))
+    x0, y0, x1, y1 = font.getbbox(ch, anchor="ls")
+    w, h = max(0, x1 - x0), max(0, y1 - y0)
+    if w == 0 or h == 0:
+        return GLYPH.pack(0, 0, 0, 0, min(advance, 255), 0, 0)
+    if w * h > MAX_PIXELS or w > 255 or h > 255:
+        raise ValueError("glyph U+%04X is %dx%d, larger than %d pixels" % (ord(ch), w, h, MAX_PIXELS))
+
+    img = Image.new("L", (w, h), 0)
+    ImageDraw.Draw(img).text((-x0, -y0), ch, font=font, fill=255, anchor="ls")
+    data = rle([quantize(v) for v in img.getdata()])
+    if len(data) > MAX_RLE:
+        raise ValueError("glyph U+%04X needs %d RLE bytes, limit %d" % (ord(ch), len(data), MAX_RLE))
+
+    # Offsets from the pen position and the top of the line
+    x_off = max(-128, min(127, x0))
+    y_off = max(-128, min(127, ascent + y0))
+    return GLYPH.pack(w, h, x_off, y_off, min(advance, 255), 0, len(data)) + data
+
+
+def build(ttf, size, chars):
+    try:
+        from PIL import ImageFont
+    except ImportError:
+        sys.exit("subset_fonts: Pillow is required (pip install pillow)")
+
+    font = ImageFont.truetype(ttf, size)
+    ascent, descent = font.getmetrics()
+    height = ascent + descent
+
+    glyphs = {}
+    for ch in sorted(chars):
+        code = ord(ch)
+        if code < 0x20 or code > 0xFFFF:
+            continue
+        try:
+            glyphs[code] = render(font, ch, ascent)
+        except ValueError as e:
+            print("subset_fonts: skipping, %s" % e)
+
+    # Header, page directory, then one table per used page followed by its glyphs
+    used_pages = sorted({c >> 8 for c in glyphs})
+    pages = [0] * PAGES
+    body = bytearray()
+    offset = HEADER.size + PAGES * 4
+    for page in used_pages:
+        pages[page] = offset
+        table = [0] * 256
+        blob = bytearray()
+        pos = offset + 256 * 4
+        for code in sorted(c for c in glyphs if c >> 8 == page):
+            table[code & 0xFF] = pos + len(blob)
+            blob += glyphs[code]
+        chunk = struct.pack("<256I", *table) + blob
+        body += chunk
+        offset += len(chunk)
+
+    total = HEADER.size + PAGES * 4 + len(body)
+    header = HEADER.pack(MAGIC, VERSION, 4, min(height, 255), min(ascent, 255), len(glyphs), 0, total)
+    return header + struct.pack("<%dI" % PAGES, *pages) + bytes(body), len(glyphs)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--ttf", required=True, help="source TrueType/OpenType font")
+    parser.add_argument("--sizes", default="14,24", help="pixel sizes, comma separated (default 14,24)")
+    parser.add_argument("--chars", default="", help="extra characters to keep")
+    parser.add_argument("--charset", help="file with extra characters to keep (UTF-8)")
+    parser.add_argument("--no-ascii", action="store_true", help="do not add printable ASCII to the subset")
+    parser.add_argument("--full", action="store_true", help="every character of the font (SD fallback)")
+    parser.add_argument("--root", default=".", help="project root scanned for string literals")
+    parser.add_argument("--out-dir", help="default assets/fonts, or sd/fonts with --full")
+    args = parser.parse_args()
+
+    if args.full:
+        chars = ttf_chars(args.ttf)
+        prefix, out_dir = "full", args.out_dir or "sd/fonts"
+    else:
+        chars = source_chars(args.root)
+        chars.update(args.chars)
+        if args.charset:
+            with open(args.charset, encoding="utf-8") as fh:
+                chars.update(fh.read())
+        if not args.no_ascii:
+            chars.update(chr(c) for c in range(0x20, 0x7F))
+        prefix, out_dir = "ui", args.out_dir or os.path.join("assets", "fonts")
+    chars.add("?")  # Placeholder for missing glyphs
+    chars = {c for c in chars if c not in "\r\n\t"}
+
+    os.makedirs(out_dir, exist_ok=True)
+    for size in (int(s) for s in args.sizes.split(",")):
+        blob, count = build(args.ttf, size, chars)
+        path = os.path.join(out_dir, "%s%d.mfnt" % (prefix, size))
+        with open(path, "wb") as fh:
+            fh.write(blob)
+        print("subset_fonts: %s, %d glyphs, %d bytes" % (path, count, len(blob)))
+
+
+if __name__ == "__main__":
+    main()